@@ -1,6 +1,8 @@
 #version 410
 
 layout (location = 0) in vec3 vertex;
+layout (location = 1) in vec3 normal;
+layout (location = 3) in vec4 tangent;
 layout (location = 4) in vec3 binormal;
 
 uniform mat4 vertex_model_to_world;
@@ -12,7 +14,9 @@ out VS_OUT {
 
 void main()
 {
-	vs_out.binormal = binormal;
+	// Packed vertices do not store binormals: rebuild them from the
+	// handedness kept in the tangent.
+	vs_out.binormal = binormal != vec3(0.0) ? binormal : sign(tangent.w) * cross(normal, tangent.xyz);
 
 	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
 }
@@ -4,7 +4,7 @@
 layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec3 texcoord;
-layout (location = 3) in vec3 tangent;
+layout (location = 3) in vec4 tangent;
 layout (location = 4) in vec3 binormal;
 
 uniform mat4 vertex_model_to_world;
@@ -32,8 +32,12 @@ void main()
     vs_out.light_position = (light_position - vs_out.vertex);
     vs_out.camera_position = (camera_position - vs_out.vertex);
     
-    vs_out.tangent = normalize(tangent);
-    vs_out.binormal = normalize(binormal);
+    // Packed vertices do not store binormals: rebuild them from the
+    // handedness kept in the tangent.
+    vec3 full_binormal = binormal != vec3(0.0) ? binormal : sign(tangent.w) * cross(normal, tangent.xyz);
+
+    vs_out.tangent = normalize(tangent.xyz);
+    vs_out.binormal = normalize(full_binormal);
     vs_out.normal = normalize(normal);
     
     gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
@@ -0,0 +1,42 @@
+#version 410
+
+uniform sampler2D diffuse_texture;
+uniform int has_textures;
+
+uniform vec3 light_position;
+uniform vec3 camera_position;
+
+uniform vec3 ambient;
+uniform vec3 diffuse;
+uniform vec3 specular;
+uniform float shininess;
+
+in VS_OUT {
+	vec3 vertex;
+	vec3 normal;
+	vec2 texcoord;
+	vec4 parameters;
+} fs_in;
+
+out vec4 frag_color;
+
+void main()
+{
+	// Textured instances are drawn like default.frag, the others are
+	// lit like phong.frag; the per-instance parameters tint both.
+	if (has_textures != 0) {
+		frag_color = texture(diffuse_texture, fs_in.texcoord) * fs_in.parameters;
+		return;
+	}
+
+	vec3 L = normalize(light_position - fs_in.vertex);
+	vec3 N = normalize(fs_in.normal);
+	vec3 V = normalize(camera_position - fs_in.vertex);
+
+	vec3 R = normalize(reflect(-L, N));
+
+	vec3 kd = diffuse * max(dot(N, L), 0);
+	vec3 ks = specular * pow(max(dot(R, V), 0), shininess);
+
+	frag_color = vec4(ambient + kd + ks, 1) * fs_in.parameters;
+}
@@ -0,0 +1,31 @@
+#version 410
+
+layout (location = 0) in vec3 vertex;
+layout (location = 1) in vec3 normal;
+layout (location = 2) in vec3 texcoord;
+layout (location = 5) in mat4 instance_model_to_world;
+layout (location = 9) in vec4 instance_parameters;
+
+uniform mat4 vertex_world_to_clip;
+
+out VS_OUT {
+	vec3 vertex;
+	vec3 normal;
+	vec2 texcoord;
+	vec4 parameters;
+} vs_out;
+
+
+void main()
+{
+	vec4 world_vertex = instance_model_to_world * vec4(vertex, 1.0);
+
+	// Instances are only scaled uniformly, so the upper 3x3 of their
+	// transform keeps normals perpendicular up to their length.
+	vs_out.vertex = vec3(world_vertex);
+	vs_out.normal = mat3(instance_model_to_world) * normal;
+	vs_out.texcoord = vec2(texcoord.x, texcoord.y);
+	vs_out.parameters = instance_parameters;
+
+	gl_Position = vertex_world_to_clip * world_vertex;
+}
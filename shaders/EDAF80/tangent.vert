@@ -1,7 +1,7 @@
 #version 410
 
 layout (location = 0) in vec3 vertex;
-layout (location = 3) in vec3 tangent;
+layout (location = 3) in vec4 tangent;
 
 uniform mat4 vertex_model_to_world;
 uniform mat4 vertex_world_to_clip;
@@ -13,7 +13,7 @@ out VS_OUT {
 
 void main()
 {
-	vs_out.tangent = normalize(tangent);
+	vs_out.tangent = normalize(tangent.xyz);
 
 	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
 }
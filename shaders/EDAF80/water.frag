@@ -3,8 +3,10 @@
 uniform samplerCube SkyboxTexture;
 uniform sampler2D bump_texture;
 
-uniform vec3 light_position;
-uniform vec3 camera_position;
+layout (std140) uniform PerView {
+    vec3 camera_position;
+    vec3 light_position;
+};
 
 uniform mat4 normal_model_to_world;
 
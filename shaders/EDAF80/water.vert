@@ -10,9 +10,18 @@ uniform mat4 vertex_model_to_world;
 uniform mat4 normal_model_to_world;
 uniform mat4 vertex_world_to_clip;
 
-uniform float time;
-uniform float wave1Params[6];
-uniform float wave2Params[6];
+struct wave {
+    float amplitude;
+    float frequency;
+    float phase;
+    float sharpness;
+    vec2 direction;
+};
+
+layout (std140) uniform PerFrame {
+    wave waves[2];
+    float time;
+};
 
 out VS_OUT {
     vec3 vertex;
@@ -27,8 +36,8 @@ out VS_OUT {
 void main()
 {
     // values for calculating wave shapes: Amplitude, Frequency, Phase, Sharpness, Direction
-    float yA = wave1Params[0], yF = wave1Params[1], yP = wave1Params[2], yS = wave1Params[3], yDx = wave1Params[4], yDz = wave1Params[5];
-    float y2A = wave2Params[0], y2F = wave2Params[1], y2P = wave2Params[2], y2S = wave2Params[3], y2Dx = wave2Params[4], y2Dz = wave2Params[5];
+    float yA = waves[0].amplitude, yF = waves[0].frequency, yP = waves[0].phase, yS = waves[0].sharpness, yDx = waves[0].direction.x, yDz = waves[0].direction.y;
+    float y2A = waves[1].amplitude, y2F = waves[1].frequency, y2P = waves[1].phase, y2S = waves[1].sharpness, y2Dx = waves[1].direction.x, y2Dz = waves[1].direction.y;
     
     // calculating two waves to displace vertices
     float y = yA * pow(sin((yDx * vertex.x + yDz * vertex.z) * yF + time * yP) * 0.5 + 0.5, yS);
@@ -4,19 +4,24 @@ uniform sampler2D depth_texture;
 uniform sampler2D normal_texture;
 uniform sampler2DShadow shadow_texture;
 
-uniform vec2 inv_res;
-
-uniform mat4 view_projection_inverse;
-uniform vec3 camera_position;
-uniform mat4 shadow_view_projection;
-
-uniform vec3 light_color;
-uniform vec3 light_position;
-uniform vec3 light_direction;
-uniform float light_intensity;
-uniform float light_angle_falloff;
-
-uniform vec2 shadowmap_texel_size;
+layout (std140) uniform PerFrame {
+	vec2 inv_res;
+	vec2 shadowmap_texel_size;
+};
+
+layout (std140) uniform PerView {
+	mat4 view_projection_inverse;
+	vec3 camera_position;
+};
+
+layout (std140) uniform PerLight {
+	mat4 shadow_view_projection;
+	vec3 light_color;
+	float light_intensity;
+	vec3 light_position;
+	float light_angle_falloff;
+	vec3 light_direction;
+};
 
 layout (location = 0) out vec4 light_diffuse_contribution;
 layout (location = 1) out vec4 light_specular_contribution;
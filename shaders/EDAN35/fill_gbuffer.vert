@@ -6,7 +6,7 @@ uniform mat4 vertex_world_to_clip;
 layout (location = 0) in vec3 vertex;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec3 texcoord;
-layout (location = 3) in vec3 tangent;
+layout (location = 3) in vec4 tangent;
 layout (location = 4) in vec3 binormal;
 
 out VS_OUT {
@@ -20,8 +20,10 @@ out VS_OUT {
 void main() {
 	vs_out.normal   = normalize(normal);
 	vs_out.texcoord = texcoord.xy;
-	vs_out.tangent  = normalize(tangent);
-	vs_out.binormal = normalize(binormal);
+	vs_out.tangent  = normalize(tangent.xyz);
+	// Packed vertices do not store binormals: rebuild them from the
+	// handedness kept in the tangent.
+	vs_out.binormal = normalize(binormal != vec3(0.0) ? binormal : sign(tangent.w) * cross(normal, tangent.xyz));
 
 	gl_Position = vertex_world_to_clip * vertex_model_to_world * vec4(vertex, 1.0);
 }
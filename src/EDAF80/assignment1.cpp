@@ -1,8 +1,10 @@
 #include "assignment1.hpp"
+#include "interpolation.hpp"
 
 #include "config.hpp"
 #include "external/glad/glad.h"
 #include "core/Bonobo.h"
+#include "core/benchmark.hpp"
 #include "core/FPSCamera.h"
 #include "core/helpers.hpp"
 #include "core/InputHandler.h"
@@ -11,11 +13,12 @@
 #include "core/Misc.h"
 #include "core/node.hpp"
 #include "core/opengl.hpp"
+#include "core/Profiler.h"
+#include "core/render_queue.hpp"
 #include "core/utils.h"
 #include "core/various.hpp"
 #include "core/Window.h"
 #include <imgui.h>
-#include "external/imgui_impl_glfw_gl3.h"
 
 #include <GLFW/glfw3.h>
 #include <glm/gtc/matrix_transform.hpp>
@@ -107,13 +110,19 @@ edaf80::Assignment1::run()
 
 	glEnable(GL_DEPTH_TEST);
 
+	bonobo::render_queue render_queue;
+
+	// Replays a camera path on a fixed timestep when benchmarking.
+	bonobo::benchmark benchmark(window->GetTitle(), interpolation::evalCatmullRom);
+
 	f64 ddeltatime;
 	size_t fpsSamples = 0;
-	double nowTime, lastTime = GetTimeSeconds();
+	double nowTime, lastTime = benchmark.get_time_seconds();
 	double fpsNextTick = lastTime + 1.0;
 
-	while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
-		nowTime = GetTimeSeconds();
+	while (!window->ShouldClose() && !benchmark.is_done()) {
+		benchmark.begin_frame();
+		nowTime = benchmark.get_time_seconds();
 		ddeltatime = nowTime - lastTime;
 		if (nowTime > fpsNextTick) {
 			fpsNextTick += 1.0;
@@ -124,11 +133,14 @@ edaf80::Assignment1::run()
 		auto& io = ImGui::GetIO();
 		inputHandler->SetUICapture(io.WantCaptureMouse, io.WantCaptureMouse);
 
-		glfwPollEvents();
+		window->PollEvents();
 		inputHandler->Advance();
-		mCamera.Update(ddeltatime, *inputHandler);
+		if (benchmark.has_camera_path())
+			benchmark.place_camera(mCamera);
+		else
+			mCamera.Update(ddeltatime, *inputHandler);
 
-		ImGui_ImplGlfwGL3_NewFrame();
+		window->NewImGuiFrame();
 
 
 		// rotating and translating sun
@@ -146,7 +158,10 @@ edaf80::Assignment1::run()
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
-		// Traverse the scene graph and render all the nodes
+		// Traverse the scene graph and queue all the nodes, to render them
+		// sorted by program, textures and geometry
+		render_queue.new_frame();
+		PROFILE_BEGIN("Scene traversal");
 		auto node_stack = std::stack<Node const*>();
 		auto matrix_stack = std::stack<glm::mat4>();
 		node_stack.push(&world);
@@ -164,7 +179,7 @@ edaf80::Assignment1::run()
 			// Todo: Compute the current node's world matrix
 			//
 			auto const current_node_world_matrix = parent_matrix*current_node_matrix;
-			current_node->render(mCamera.GetWorldToClipMatrix(), current_node_world_matrix);
+			render_queue.submit(*current_node, mCamera.GetWorldToClipMatrix(), current_node_world_matrix);
 
 			for (int i = static_cast<int>(current_node->get_children_nb()) - 1; i >= 0; --i) {
                 std::cout << i << std::endl;
@@ -172,21 +187,27 @@ edaf80::Assignment1::run()
 				matrix_stack.push(current_node_world_matrix);
 			}
 		} while (!node_stack.empty());
+		PROFILE_END();
+		render_queue.flush();
 
 		Log::View::Render();
+		window->CaptureScene();
 		ImGui::Render();
 
 		window->Swap();
+		benchmark.end_frame();
 		lastTime = nowTime;
 	}
 
 	glDeleteProgram(shader);
 	shader = 0u;
+
+	bonobo::releaseObjectTextures(objects);
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-	Bonobo::Init();
+	Bonobo::Init(argc, argv);
 	try {
 		edaf80::Assignment1 assignment1;
 		assignment1.run();
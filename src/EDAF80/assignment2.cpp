@@ -4,6 +4,7 @@
 
 #include "config.hpp"
 #include "external/glad/glad.h"
+#include "core/benchmark.hpp"
 #include "core/Bonobo.h"
 #include "core/FPSCamera.h"
 #include "core/InputHandler.h"
@@ -11,10 +12,10 @@
 #include "core/LogView.h"
 #include "core/Misc.h"
 #include "core/node.hpp"
+#include "core/uniform_cache.hpp"
 #include "core/utils.h"
 #include "core/Window.h"
 #include <imgui.h>
-#include "external/imgui_impl_glfw_gl3.h"
 
 #include "external/glad/glad.h"
 #include <GLFW/glfw3.h>
@@ -25,6 +26,11 @@
 #include <cstdlib>
 #include <stdexcept>
 
+namespace uniforms
+{
+	static auto const light_position = bonobo::getUniformID("light_position");
+}
+
 enum class polygon_mode_t : unsigned int {
 	fill = 0u,
 	line,
@@ -68,7 +74,7 @@ edaf80::Assignment2::run()
     
 	// Load the sphere geometry
 	auto const shape = parametric_shapes::createCircleRing(4u, 60u, 1.0f, 2.0f);
-    auto const sphere = parametric_shapes::createSphere(40u, 40u, 1.0f);
+    auto const sphere = parametric_shapes::acquireSphere(40u, 40u, 1.0f);
 	if (shape.vao == 0u)
 		return;
 
@@ -105,7 +111,7 @@ edaf80::Assignment2::run()
 
 	auto const light_position = glm::vec3(-2.0f, 4.0f, 2.0f);
 	auto const set_uniforms = [&light_position](GLuint program){
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
+		glUniform3fv(bonobo::getUniformLocation(program, uniforms::light_position), 1, glm::value_ptr(light_position));
 	};
     
     // set up control points
@@ -132,11 +138,13 @@ edaf80::Assignment2::run()
 	circle_rings.set_program(fallback_shader, set_uniforms);
     
     auto sphereTest = Node();
-    sphereTest.set_geometry(sphere);
+    sphereTest.set_geometry(sphere.mesh);
+    sphereTest.set_scaling(glm::vec3(sphere.scale));
     sphereTest.set_program(fallback_shader, set_uniforms);
     
     auto sphere2 = Node();
-    sphere2.set_geometry(sphere);
+    sphere2.set_geometry(sphere.mesh);
+    sphere2.set_scaling(glm::vec3(sphere.scale));
     sphere2.set_program(fallback_shader, set_uniforms);
 
 	auto polygon_mode = polygon_mode_t::fill;
@@ -148,17 +156,21 @@ edaf80::Assignment2::run()
 //	glCullFace(GL_FRONT);
 //	glCullFace(GL_BACK);
 
+	// Replays a camera path on a fixed timestep when benchmarking.
+	bonobo::benchmark benchmark(window->GetTitle(), interpolation::evalCatmullRom);
+
 	f64 ddeltatime;
 	size_t fpsSamples = 0;
-	double nowTime, lastTime = GetTimeSeconds();
+	double nowTime, lastTime = benchmark.get_time_seconds();
 	double fpsNextTick = lastTime + 1.0;
     
     int i=1, j=2, k=3, l=0;
     int tempTime=0;
     glm::vec3 currentLocation, currentLocation2;
 
-	while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
-		nowTime = GetTimeSeconds();
+	while (!window->ShouldClose() && !benchmark.is_done()) {
+		benchmark.begin_frame();
+		nowTime = benchmark.get_time_seconds();
 		ddeltatime = nowTime - lastTime;
 		if (nowTime > fpsNextTick) {
 			fpsNextTick += 1.0;
@@ -169,11 +181,14 @@ edaf80::Assignment2::run()
 		auto& io = ImGui::GetIO();
 		inputHandler->SetUICapture(io.WantCaptureMouse, io.WantCaptureMouse);
 
-		glfwPollEvents();
+		window->PollEvents();
 		inputHandler->Advance();
-		mCamera.Update(ddeltatime, *inputHandler);
+		if (benchmark.has_camera_path())
+			benchmark.place_camera(mCamera);
+		else
+			mCamera.Update(ddeltatime, *inputHandler);
 
-		ImGui_ImplGlfwGL3_NewFrame();
+		window->NewImGuiFrame();
 
 
 		if (inputHandler->GetKeycodeState(GLFW_KEY_1) & JUST_PRESSED) {
@@ -264,6 +279,11 @@ edaf80::Assignment2::run()
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
+		auto const lod_view = mCamera.GetLodView(static_cast<float>(window_size.y));
+		circle_rings.select_lod(lod_view, circle_rings.get_transform());
+		sphereTest.select_lod(lod_view, sphereTest.get_transform());
+		sphere2.select_lod(lod_view, sphere2.get_transform());
+
 		circle_rings.render(mCamera.GetWorldToClipMatrix(), circle_rings.get_transform());
         sphereTest.render(mCamera.GetWorldToClipMatrix(), sphereTest.get_transform());
         
@@ -283,9 +303,11 @@ edaf80::Assignment2::run()
 
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 		Log::View::Render();
+		window->CaptureScene();
 		ImGui::Render();
 
 		window->Swap();
+		benchmark.end_frame();
 		lastTime = nowTime;
 	}
 
@@ -297,11 +319,13 @@ edaf80::Assignment2::run()
 	diffuse_shader = 0u;
 	glDeleteProgram(fallback_shader);
 	diffuse_shader = 0u;
+
+	parametric_shapes::releaseShape(sphere.mesh);
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-	Bonobo::Init();
+	Bonobo::Init(argc, argv);
 	try {
 		edaf80::Assignment2 assignment2;
 		assignment2.run();
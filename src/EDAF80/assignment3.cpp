@@ -4,6 +4,7 @@
 
 #include "config.hpp"
 #include "external/glad/glad.h"
+#include "core/benchmark.hpp"
 #include "core/Bonobo.h"
 #include "core/FPSCamera.h"
 #include "core/helpers.hpp"
@@ -14,9 +15,9 @@
 #include "core/utils.h"
 #include "core/Window.h"
 #include <imgui.h>
-#include "external/imgui_impl_glfw_gl3.h"
 #include "core/node.cpp"
 #include "core/node.hpp"
+#include "core/uniform_cache.hpp"
 
 #include "external/glad/glad.h"
 #include <GLFW/glfw3.h>
@@ -27,6 +28,16 @@
 #include <cstdlib>
 #include <stdexcept>
 
+namespace uniforms
+{
+	static auto const light_position  = bonobo::getUniformID("light_position");
+	static auto const camera_position = bonobo::getUniformID("camera_position");
+	static auto const ambient         = bonobo::getUniformID("ambient");
+	static auto const diffuse         = bonobo::getUniformID("diffuse");
+	static auto const specular        = bonobo::getUniformID("specular");
+	static auto const shininess       = bonobo::getUniformID("shininess");
+}
+
 enum class polygon_mode_t : unsigned int {
 	fill = 0u,
 	line,
@@ -67,14 +78,14 @@ void
 edaf80::Assignment3::run()
 {
     // load sphere geometry
-    auto const sphere = parametric_shapes::createSphere(40u, 40u, 1.0f);
-    if (sphere.vao == 0u) {
+    auto const sphere = parametric_shapes::acquireSphere(40u, 40u, 1.0f);
+    if (sphere.mesh.vao == 0u) {
         LogError("Failed to retrieve the sphere mesh");
         return;
     }
     
-    // load sky geometry
-    auto const sky = parametric_shapes::createSphere(40u, 40u, 100.0f);
+    // load sky geometry; it shares the sphere's mesh, scaled up
+    auto const sky = parametric_shapes::acquireSphere(40u, 40u, 100.0f);
 
 	// Set up the camera
 	FPSCameraf mCamera(bonobo::pi / 4.0f,
@@ -155,22 +166,24 @@ edaf80::Assignment3::run()
     auto bumpTexture = bonobo::loadTexture2D("fieldstone_bump.png");
     
 	auto const set_uniforms = [&light_position,&camera_position,&ambient,&diffuse,&specular,&shininess](GLuint program){
-		glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-		glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
-		glUniform3fv(glGetUniformLocation(program, "ambient"), 1, glm::value_ptr(ambient));
-		glUniform3fv(glGetUniformLocation(program, "diffuse"), 1, glm::value_ptr(diffuse));
-		glUniform3fv(glGetUniformLocation(program, "specular"), 1, glm::value_ptr(specular));
-		glUniform1f(glGetUniformLocation(program, "shininess"), shininess);
+		glUniform3fv(bonobo::getUniformLocation(program, uniforms::light_position), 1, glm::value_ptr(light_position));
+		glUniform3fv(bonobo::getUniformLocation(program, uniforms::camera_position), 1, glm::value_ptr(camera_position));
+		glUniform3fv(bonobo::getUniformLocation(program, uniforms::ambient), 1, glm::value_ptr(ambient));
+		glUniform3fv(bonobo::getUniformLocation(program, uniforms::diffuse), 1, glm::value_ptr(diffuse));
+		glUniform3fv(bonobo::getUniformLocation(program, uniforms::specular), 1, glm::value_ptr(specular));
+		glUniform1f(bonobo::getUniformLocation(program, uniforms::shininess), shininess);
 	};
 
 	auto polygon_mode = polygon_mode_t::fill;
 
 	auto testShape = Node();
-	testShape.set_geometry(sphere);
+	testShape.set_geometry(sphere.mesh);
+	testShape.set_scaling(glm::vec3(sphere.scale));
     testShape.set_program(reflection_shader, set_uniforms);
     
     auto skyBox = Node();
-    skyBox.set_geometry(sky);
+    skyBox.set_geometry(sky.mesh);
+    skyBox.set_scaling(glm::vec3(sky.scale));
     skyBox.set_program(skybox_shader, set_uniforms);
     skyBox.add_texture("diffuse_texture", cubeTexture, GL_TEXTURE_CUBE_MAP);
 
@@ -181,13 +194,17 @@ edaf80::Assignment3::run()
 //    glCullFace(GL_FRONT);
 //    glCullFace(GL_BACK);
 
+	// Replays a camera path on a fixed timestep when benchmarking.
+	bonobo::benchmark benchmark(window->GetTitle(), interpolation::evalCatmullRom);
+
 	f64 ddeltatime;
 	size_t fpsSamples = 0;
-	double nowTime, lastTime = GetTimeMilliseconds();
+	double nowTime, lastTime = benchmark.get_time_milliseconds();
 	double fpsNextTick = lastTime + 1000.0;
 
-	while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
-		nowTime = GetTimeMilliseconds();
+	while (!window->ShouldClose() && !benchmark.is_done()) {
+		benchmark.begin_frame();
+		nowTime = benchmark.get_time_milliseconds();
 		ddeltatime = nowTime - lastTime;
 		if (nowTime > fpsNextTick) {
 			fpsNextTick += 1000.0;
@@ -198,11 +215,14 @@ edaf80::Assignment3::run()
 		auto& io = ImGui::GetIO();
 		inputHandler->SetUICapture(io.WantCaptureMouse, io.WantCaptureMouse);
 
-		glfwPollEvents();
+		window->PollEvents();
 		inputHandler->Advance();
-		mCamera.Update(ddeltatime, *inputHandler);
+		if (benchmark.has_camera_path())
+			benchmark.place_camera(mCamera);
+		else
+			mCamera.Update(ddeltatime, *inputHandler);
 
-		ImGui_ImplGlfwGL3_NewFrame();
+		window->NewImGuiFrame();
 
 		if (inputHandler->GetKeycodeState(GLFW_KEY_1) & JUST_PRESSED) {
 			testShape.set_program(fallback_shader, set_uniforms);
@@ -253,8 +273,9 @@ edaf80::Assignment3::run()
 		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 		glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 
+		testShape.select_lod(mCamera.GetLodView(static_cast<float>(window_size.y)), testShape.get_transform());
         testShape.render(mCamera.GetWorldToClipMatrix(), testShape.get_transform());
-        skyBox.render(mCamera.GetWorldToClipMatrix(), testShape.get_transform());
+        skyBox.render(mCamera.GetWorldToClipMatrix(), skyBox.get_transform());
 
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
@@ -275,9 +296,11 @@ edaf80::Assignment3::run()
 			ImGui::Text("%.3f ms", ddeltatime);
 		ImGui::End();
 
+		window->CaptureScene();
 		ImGui::Render();
 
 		window->Swap();
+		benchmark.end_frame();
 		lastTime = nowTime;
 	}
 
@@ -291,11 +314,14 @@ edaf80::Assignment3::run()
 	diffuse_shader = 0u;
     glDeleteProgram(phong_shader);
     phong_shader = 0u;
+
+    parametric_shapes::releaseShape(sky.mesh);
+    parametric_shapes::releaseShape(sphere.mesh);
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-	Bonobo::Init();
+	Bonobo::Init(argc, argv);
 	try {
 		edaf80::Assignment3 assignment3;
 		assignment3.run();
@@ -5,6 +5,7 @@
 
 #include "config.hpp"
 #include "external/glad/glad.h"
+#include "core/benchmark.hpp"
 #include "core/Bonobo.h"
 #include "core/FPSCamera.h"
 #include "core/helpers.hpp"
@@ -15,15 +16,58 @@
 #include "core/utils.h"
 #include "core/Window.h"
 #include <imgui.h>
-#include "external/imgui_impl_glfw_gl3.h"
 #include "core/node.cpp"
 #include "core/node.hpp"
+#include "core/uniform_buffer.hpp"
+#include "core/uniform_cache.hpp"
 
 #include "external/glad/glad.h"
 #include <GLFW/glfw3.h>
 
 #include <stdexcept>
 
+namespace uniforms
+{
+    static auto const light_position  = bonobo::getUniformID("light_position");
+    static auto const camera_position = bonobo::getUniformID("camera_position");
+    static auto const ambient         = bonobo::getUniformID("ambient");
+    static auto const diffuse         = bonobo::getUniformID("diffuse");
+    static auto const specular        = bonobo::getUniformID("specular");
+    static auto const shininess       = bonobo::getUniformID("shininess");
+}
+
+// Mirrors of the std140 blocks declared by water.vert and water.frag
+namespace blocks
+{
+    struct wave {
+        float amplitude;
+        float frequency;
+        float phase;
+        float sharpness;
+        glm::vec2 direction;
+        glm::vec2 padding;
+    };
+
+    struct per_frame {
+        wave waves[2];
+        float time;
+        float padding[3];
+    };
+
+    struct per_view {
+        glm::vec3 camera_position;
+        float padding0;
+        glm::vec3 light_position;
+        float padding1;
+    };
+
+    // Amplitude, Frequency, Phase, Sharpness, DirectionX, DirectionZ
+    static wave make_wave(float const params[6])
+    {
+        return { params[0], params[1], params[2], params[3], glm::vec2(params[4], params[5]), glm::vec2(0.0f) };
+    }
+}
+
 enum class polygon_mode_t : unsigned int {
     fill = 0u,
     line,
@@ -67,7 +111,7 @@ edaf80::Assignment4::run()
     auto const quad = parametric_shapes::createQuad(50, 50, 200);
 
     // load sky geometry
-    auto const sky = parametric_shapes::createSphere(40u, 40u, 150.0f);
+    auto const sky = parametric_shapes::acquireSphere(40u, 40u, 150.0f);
 
     // Set up the camera
     FPSCameraf mCamera(bonobo::pi / 4.0f,
@@ -103,19 +147,20 @@ edaf80::Assignment4::run()
     //
     // Setting uniform values for shader
     //
-    auto const set_uniforms = [&light_position, &camera_position, &ambient, &diffuse, &specular, &shininess, &time, &wave1Params, &wave2Params](GLuint program)
+    auto const set_uniforms = [&light_position, &camera_position, &ambient, &diffuse, &specular, &shininess](GLuint program)
     {
-        glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-        glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
-        glUniform3fv(glGetUniformLocation(program, "ambient"), 1, glm::value_ptr(ambient));
-        glUniform3fv(glGetUniformLocation(program, "diffuse"), 1, glm::value_ptr(diffuse));
-        glUniform3fv(glGetUniformLocation(program, "specular"), 1, glm::value_ptr(specular));
-        glUniform1f(glGetUniformLocation(program, "shininess"), shininess);
-        glUniform1f(glGetUniformLocation(program, "time"), time);
-        glUniform1fv(glGetUniformLocation(program, "wave1Params"), 6, wave1Params);
-        glUniform1fv(glGetUniformLocation(program, "wave2Params"), 6, wave2Params);
+        glUniform3fv(bonobo::getUniformLocation(program, uniforms::light_position), 1, glm::value_ptr(light_position));
+        glUniform3fv(bonobo::getUniformLocation(program, uniforms::camera_position), 1, glm::value_ptr(camera_position));
+        glUniform3fv(bonobo::getUniformLocation(program, uniforms::ambient), 1, glm::value_ptr(ambient));
+        glUniform3fv(bonobo::getUniformLocation(program, uniforms::diffuse), 1, glm::value_ptr(diffuse));
+        glUniform3fv(bonobo::getUniformLocation(program, uniforms::specular), 1, glm::value_ptr(specular));
+        glUniform1f(bonobo::getUniformLocation(program, uniforms::shininess), shininess);
     };
 
+    // Time, waves and positions are read by the water shader from blocks
+    // written once per frame, rather than being sent again on each draw.
+    bonobo::uniform_ring uniform_ring(sizeof(blocks::per_frame) + sizeof(blocks::per_view) + 2u * 256u);
+
     auto polygon_mode = polygon_mode_t::fill;
 
     //
@@ -169,7 +214,8 @@ edaf80::Assignment4::run()
     waves.add_texture("bump_texture", bumpTexture, GL_TEXTURE_2D);
 
     auto skyBox = Node();
-    skyBox.set_geometry(sky);
+    skyBox.set_geometry(sky.mesh);
+    skyBox.set_scaling(glm::vec3(sky.scale));
     skyBox.set_program(skybox_shader, set_uniforms);
     skyBox.add_texture("diffuse_texture", cubeTexture, GL_TEXTURE_CUBE_MAP);
 
@@ -180,13 +226,17 @@ edaf80::Assignment4::run()
 //    glCullFace(GL_FRONT);
 //    glCullFace(GL_BACK);
 
+    // Replays a camera path on a fixed timestep when benchmarking.
+    bonobo::benchmark benchmark(window->GetTitle(), interpolation::evalCatmullRom);
+
     f64 ddeltatime;
     size_t fpsSamples = 0;
-    double nowTime, lastTime = GetTimeMilliseconds();
+    double nowTime, lastTime = benchmark.get_time_milliseconds();
     double fpsNextTick = lastTime + 1000.0;
 
-    while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
-        nowTime = GetTimeMilliseconds();
+    while (!window->ShouldClose() && !benchmark.is_done()) {
+        benchmark.begin_frame();
+        nowTime = benchmark.get_time_milliseconds();
         ddeltatime = nowTime - lastTime;
         if (nowTime > fpsNextTick) {
             fpsNextTick += 1000.0;
@@ -199,11 +249,14 @@ edaf80::Assignment4::run()
         auto& io = ImGui::GetIO();
         inputHandler->SetUICapture(io.WantCaptureMouse, io.WantCaptureMouse);
 
-        glfwPollEvents();
+        window->PollEvents();
         inputHandler->Advance();
-        mCamera.Update(ddeltatime, *inputHandler);
+        if (benchmark.has_camera_path())
+            benchmark.place_camera(mCamera);
+        else
+            mCamera.Update(ddeltatime, *inputHandler);
 
-        ImGui_ImplGlfwGL3_NewFrame();
+        window->NewImGuiFrame();
 
         //
         // Inputs
@@ -249,6 +302,17 @@ edaf80::Assignment4::run()
 
         camera_position = mCamera.mWorld.GetTranslation();
 
+        uniform_ring.begin_frame();
+        blocks::per_frame frame_block = {};
+        frame_block.waves[0] = blocks::make_wave(wave1Params);
+        frame_block.waves[1] = blocks::make_wave(wave2Params);
+        frame_block.time = time;
+        auto const frame_offset = uniform_ring.write(frame_block);
+        auto const view_offset = uniform_ring.write(blocks::per_view{ camera_position, 0.0f, light_position, 0.0f });
+        uniform_ring.end_frame();
+        uniform_ring.bind<blocks::per_frame>(bonobo::uniform_block_binding::per_frame, frame_offset);
+        uniform_ring.bind<blocks::per_view>(bonobo::uniform_block_binding::per_view, view_offset);
+
         auto const window_size = window->GetDimensions();
         glViewport(0, 0, window_size.x, window_size.y);
         glClearDepthf(1.0f);
@@ -291,9 +355,11 @@ edaf80::Assignment4::run()
         }
         ImGui::End();
 
+        window->CaptureScene();
         ImGui::Render();
 
         window->Swap();
+        benchmark.end_frame();
         lastTime = nowTime;
     }
 
@@ -312,11 +378,13 @@ edaf80::Assignment4::run()
 
     glDeleteProgram(texcoord_shader);
     texcoord_shader = 0u;
+
+    parametric_shapes::releaseShape(sky.mesh);
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-    Bonobo::Init();
+    Bonobo::Init(argc, argv);
     try {
         edaf80::Assignment4 assignment4;
         assignment4.run();
@@ -5,9 +5,11 @@
 
 #include "config.hpp"
 #include "external/glad/glad.h"
+#include "core/benchmark.hpp"
 #include "core/Bonobo.h"
 #include "core/FPSCamera.h"
 #include "core/helpers.hpp"
+#include "core/instanced_node.hpp"
 #include "core/InputHandler.h"
 #include "core/Log.h"
 #include "core/LogView.h"
@@ -15,17 +17,30 @@
 #include "core/utils.h"
 #include "core/Window.h"
 #include <imgui.h>
-#include "external/imgui_impl_glfw_gl3.h"
 #include "core/node.cpp"
 #include "core/node.hpp"
+#include "core/uniform_cache.hpp"
 
 #include "external/glad/glad.h"
 #include <GLFW/glfw3.h>
+#include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <stack>
 #include <stdexcept>
 #include <cstdlib>
 #include <iostream>
+#include <vector>
+
+namespace uniforms
+{
+    static auto const light_position  = bonobo::getUniformID("light_position");
+    static auto const camera_position = bonobo::getUniformID("camera_position");
+    static auto const ambient         = bonobo::getUniformID("ambient");
+    static auto const diffuse         = bonobo::getUniformID("diffuse");
+    static auto const specular        = bonobo::getUniformID("specular");
+    static auto const shininess       = bonobo::getUniformID("shininess");
+}
 
 enum class polygon_mode_t : unsigned int {
     fill = 0u,
@@ -67,11 +82,18 @@ enum class polygon_mode_t : unsigned int {
     edaf80::Assignment5::run()
     {
         // load ship
-        bonobo::mesh_data const ship = bonobo::loadObjects("spaceship.obj")[0];
+        auto const ship_objects = bonobo::loadObjects("spaceship.obj");
+        if (ship_objects.empty())
+            return;
+        bonobo::mesh_data const ship = ship_objects.front();
         
         // load sphere geometry
         auto const sphere = parametric_shapes::createSphere(10u, 10u, 0.4f);
         
+        // comets only differ by their radius, so they all share a unit
+        // sphere scaled per instance
+        auto const comet_sphere = parametric_shapes::createSphere(30u, 30u, 1.0f);
+        
         
         // load quad geometry
         auto const quad = parametric_shapes::createQuad(500, 500, 10);
@@ -99,6 +121,12 @@ enum class polygon_mode_t : unsigned int {
             return;
         }
         
+        auto instanced_shader = bonobo::createProgram("instanced.vert", "instanced.frag");
+        if (instanced_shader == 0u) {
+            LogError("Failed to load instanced shader");
+            return;
+        }
+        
         auto light_position = glm::vec3(0.0f, 20.0f, 0.0f);
         auto camera_position = mCamera.mWorld.GetTranslation();
         auto ambient = glm::vec3(0.1f, 0.1f, 0.1f);
@@ -109,25 +137,17 @@ enum class polygon_mode_t : unsigned int {
         auto spaceTexture = bonobo::loadTexture2D("space.png");
         auto sun_texture = bonobo::loadTexture2D("sunmap.png");
         
-        // setting defaults for wave parameters
-        // Amplitude, Frequency, Phase, Sharpness, DirectionX, DirectionZ
-        float wave1Params[6] = {3.0, 0.05, 0.5, 1.3, -1.0, 0.0};
-        float wave2Params[6] = {2.1, 0.15, 1.3, 1.3, -0.7, 0.7};
-        
         //
         // Setting uniform values for shader
         //
-        auto const set_uniforms = [&light_position, &camera_position, &ambient, &diffuse, &specular, &shininess, &time, &wave1Params, &wave2Params](GLuint program)
+        auto const set_uniforms = [&light_position, &camera_position, &ambient, &diffuse, &specular, &shininess](GLuint program)
         {
-            glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(light_position));
-            glUniform3fv(glGetUniformLocation(program, "camera_position"), 1, glm::value_ptr(camera_position));
-            glUniform3fv(glGetUniformLocation(program, "ambient"), 1, glm::value_ptr(ambient));
-            glUniform3fv(glGetUniformLocation(program, "diffuse"), 1, glm::value_ptr(diffuse));
-            glUniform3fv(glGetUniformLocation(program, "specular"), 1, glm::value_ptr(specular));
-            glUniform1f(glGetUniformLocation(program, "shininess"), shininess);
-            glUniform1f(glGetUniformLocation(program, "time"), time);
-            glUniform1fv(glGetUniformLocation(program, "wave1Params"), 6, wave1Params);
-            glUniform1fv(glGetUniformLocation(program, "wave2Params"), 6, wave2Params);
+            glUniform3fv(bonobo::getUniformLocation(program, uniforms::light_position), 1, glm::value_ptr(light_position));
+            glUniform3fv(bonobo::getUniformLocation(program, uniforms::camera_position), 1, glm::value_ptr(camera_position));
+            glUniform3fv(bonobo::getUniformLocation(program, uniforms::ambient), 1, glm::value_ptr(ambient));
+            glUniform3fv(bonobo::getUniformLocation(program, uniforms::diffuse), 1, glm::value_ptr(diffuse));
+            glUniform3fv(bonobo::getUniformLocation(program, uniforms::specular), 1, glm::value_ptr(specular));
+            glUniform1f(bonobo::getUniformLocation(program, uniforms::shininess), shininess);
         };
         
         auto polygon_mode = polygon_mode_t::fill;
@@ -182,10 +202,32 @@ enum class polygon_mode_t : unsigned int {
         //
         // Create geometry, set up nodes
         //
-        Node projectiles[20];
-        Node comets[10];
-        float cometradius[10];
-        float speedcomets[10];
+        constexpr int projectiles_nb = 20;
+        constexpr int comets_nb = 10;
+        
+        struct comet {
+            glm::vec3 position;
+            float radius;
+            float speed;
+            bool visible;
+        };
+        
+        Node projectiles[projectiles_nb];
+        auto comets = std::vector<comet>(comets_nb);
+        
+        // projectiles and comets are each drawn with a single instanced
+        // draw call, refilled every frame
+        InstancedNode projectile_instances;
+        projectile_instances.set_geometry(sphere);
+        projectile_instances.set_program(instanced_shader, set_uniforms);
+        
+        InstancedNode comet_instances;
+        comet_instances.set_geometry(comet_sphere);
+        comet_instances.set_program(instanced_shader, [](GLuint /*program*/){});
+        comet_instances.add_texture("diffuse_texture", sun_texture, GL_TEXTURE_2D);
+        
+        auto instances = std::vector<InstancedNode::instance>();
+        instances.reserve(std::max(projectiles_nb, comets_nb));
         
         auto player = Node();
         player.set_geometry(ship);
@@ -203,25 +245,20 @@ enum class polygon_mode_t : unsigned int {
         world.add_child(&player);
         world.add_child(&space);
         
-        for(int i=0; i<20; i++)
+        for(int i=0; i<projectiles_nb; i++)
         {
-            projectiles[i].set_geometry(sphere);
-            projectiles[i].set_program(fallback_shader, set_uniforms);
             world.add_child(&projectiles[i]);
         }
         
-        for (int i = 0; i<10; i++)
+        for (auto& comet : comets)
         {
             float r = 10 + (rand() % 30);
             r = r / 10;
-            auto const cometsphere = parametric_shapes::createSphere(30u, 30u,r);
-            comets[i].set_geometry(cometsphere);
-            comets[i].set_program(shader, [](GLuint /*program*/) {});
-            comets[i].add_texture("diffuse_texture", sun_texture, GL_TEXTURE_2D);
-            world.add_child(&comets[i]);
-            cometradius[i] = r;
-            speedcomets[i] = (-rand() % 50) ;
-            speedcomets[i] = speedcomets[i] / 100;
+            comet.position = glm::vec3(0.0f);
+            comet.radius = r;
+            comet.speed = (-rand() % 50) ;
+            comet.speed = comet.speed / 100;
+            comet.visible = false;
         }
         int counter = 0;
         int lives = 8;
@@ -233,9 +270,12 @@ enum class polygon_mode_t : unsigned int {
         //            glCullFace(GL_FRONT);
         //            glCullFace(GL_BACK);
         
+        // Replays a camera path on a fixed timestep when benchmarking.
+        bonobo::benchmark benchmark(window->GetTitle(), interpolation::evalCatmullRom);
+
         f64 ddeltatime;
         size_t fpsSamples = 0;
-        double nowTime, lastTime = GetTimeMilliseconds();
+        double nowTime, lastTime = benchmark.get_time_milliseconds();
         double fpsNextTick = lastTime + 1000.0;
         
         float x=-200, y=-10, z=-200;
@@ -258,11 +298,12 @@ enum class polygon_mode_t : unsigned int {
         bool up=false, down=false, left=false, right=false;
         glm::vec2 dir;
         
-        while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
+        while (!window->ShouldClose() && !benchmark.is_done()) {
+            benchmark.begin_frame();
             mCamera.mWorld.SetTranslate(glm::vec3(player.get_transform()[3]) + glm::vec3(-7, 2, 0));
             mCamera.mWorld.LookAt(player.get_transform()[3], glm::vec3(0, 1, 0));
             
-            nowTime = GetTimeMilliseconds();
+            nowTime = benchmark.get_time_milliseconds();
             ddeltatime = nowTime - lastTime;
             if (nowTime > fpsNextTick) {
                 fpsNextTick += 1000.0;
@@ -275,12 +316,15 @@ enum class polygon_mode_t : unsigned int {
             auto& io = ImGui::GetIO();
             inputHandler->SetUICapture(io.WantCaptureMouse, io.WantCaptureMouse);
             
-            glfwPollEvents();
+            window->PollEvents();
             inputHandler->Advance();
             
-            mCamera.Update(ddeltatime, *inputHandler);
+            if (benchmark.has_camera_path())
+                benchmark.place_camera(mCamera);
+            else
+                mCamera.Update(ddeltatime, *inputHandler);
             
-            ImGui_ImplGlfwGL3_NewFrame();
+            window->NewImGuiFrame();
             
             //
             // Inputs and Movement
@@ -353,7 +397,7 @@ enum class polygon_mode_t : unsigned int {
             // projectiles
             if (inputHandler->GetKeycodeState(GLFW_KEY_SPACE) & JUST_PRESSED)
             {
-                for(int i=0; i<20; i++)
+                for(int i=0; i<projectiles_nb; i++)
                 {
                     if(!projectiles[i].visible)
                     {
@@ -365,7 +409,7 @@ enum class polygon_mode_t : unsigned int {
                 }
             }
             
-            for(int i=0; i<20; i++)
+            for(int i=0; i<projectiles_nb; i++)
             {
                 if(projectiles[i].visible)
                 {
@@ -378,36 +422,36 @@ enum class polygon_mode_t : unsigned int {
             }
             
             //comets
-            for (int i = 0; i<10; i++)
+            for (auto& comet : comets)
             {
-                if (!comets[i].visible)
+                if (!comet.visible)
                 {
-                    comets[i].visible = true;
-                    comets[i].set_translation(glm::vec3(99,0, -40.0 + rand() % 80 + 1));
+                    comet.visible = true;
+                    comet.position = glm::vec3(99,0, -40.0 + rand() % 80 + 1);
                     break;
                 }
             }
             
-            for (int i = 0; i<10; i++)
+            for (auto& comet : comets)
             {
-                if (comets[i].visible)
+                if (comet.visible)
                 {
-                    comets[i].translate(glm::vec3(speedcomets[i], 0, 0) * (static_cast<float>(ddeltatime)/15));
-                    comets[i].set_rotation_z(nowTime);
+                    comet.position += glm::vec3(comet.speed, 0, 0) * (static_cast<float>(ddeltatime)/15);
                     
                     // checking if out of bounds
-                    if (comets[i].get_transform()[3].x < -100 || comets[i].get_transform()[3].x > 100 || comets[i].get_transform()[3].z > 200 || comets[i].get_transform()[3].z < -200)
-                        comets[i].visible = false;
+                    if (comet.position.x < -100 || comet.position.x > 100 || comet.position.z > 200 || comet.position.z < -200)
+                        comet.visible = false;
                     
                     // checking for collision with projectiles
-                    for (int j = 1; j < 20; j++)
+                    for (int j = 1; j < projectiles_nb; j++)
                     {
                          if (projectiles[j].visible)
                          {
-                             if (sqrt((projectiles[j].get_transform()[3].x - comets[i].get_transform()[3].x)*(projectiles[j].get_transform()[3].x - comets[i].get_transform()[3].x)
-                                      + (projectiles[j].get_transform()[3].z - comets[i].get_transform()[3].z)*(projectiles[j].get_transform()[3].z - comets[i].get_transform()[3].z)) <= projectileradius + cometradius[i])
+                             auto const projectile_position = glm::vec3(projectiles[j].get_transform()[3]);
+                             if (sqrt((projectile_position.x - comet.position.x)*(projectile_position.x - comet.position.x)
+                                      + (projectile_position.z - comet.position.z)*(projectile_position.z - comet.position.z)) <= projectileradius + comet.radius)
                              {
-                                 comets[i].visible = false;
+                                 comet.visible = false;
                                  projectiles[j].visible = false;
                                  counter++;
                              }
@@ -415,16 +459,17 @@ enum class polygon_mode_t : unsigned int {
                     }
                     
                     // checking collision with player
-                    if (sqrt((player.get_transform()[3].x - comets[i].get_transform()[3].x)*(player.get_transform()[3].x - comets[i].get_transform()[3].x)
-                             + (player.get_transform()[3].z - comets[i].get_transform()[3].z)*(player.get_transform()[3].z - comets[i].get_transform()[3].z)) <= playerradius + cometradius[i])
+                    auto const player_position = glm::vec3(player.get_transform()[3]);
+                    if (sqrt((player_position.x - comet.position.x)*(player_position.x - comet.position.x)
+                             + (player_position.z - comet.position.z)*(player_position.z - comet.position.z)) <= playerradius + comet.radius)
                     {
                         lives--;
-                        comets[i].visible = false;
+                        comet.visible = false;
                     }
                     
-                    if (comets[i].get_transform()[3].x <= -90) {
+                    if (comet.position.x <= -90) {
                         counter--;
-                        comets[i].visible = false;
+                        comet.visible = false;
                     }
                 }
             }
@@ -463,20 +508,29 @@ enum class polygon_mode_t : unsigned int {
             
             if(lives > 0)
             {
+                player.select_lod(mCamera.GetLodView(static_cast<float>(window_size.y)), player.get_transform());
                 player.render(mCamera.GetWorldToClipMatrix(), player.get_transform());
                 
                 space.render(mCamera.GetWorldToClipMatrix(), space.get_transform());
                 
-                for(int i=0; i<20; i++)
+                instances.clear();
+                for(int i=0; i<projectiles_nb; i++)
                 {
                     if(projectiles[i].visible)
-                        projectiles[i].render(mCamera.GetWorldToClipMatrix(), projectiles[i].get_transform());
+                        instances.push_back({ projectiles[i].get_transform(), glm::vec4(1.0f) });
                 }
-                for (int i = 0; i<10; i++)
+                projectile_instances.set_instances(instances);
+                projectile_instances.render(mCamera.GetWorldToClipMatrix());
+                
+                instances.clear();
+                auto const comet_rotation = glm::rotate(glm::mat4(), static_cast<float>(nowTime), glm::vec3(0.0f, 0.0f, 1.0f));
+                for (auto const& comet : comets)
                 {
-                    if (comets[i].visible)
-                        comets[i].render(mCamera.GetWorldToClipMatrix(), comets[i].get_transform());
+                    if (comet.visible)
+                        instances.push_back({ glm::scale(glm::translate(glm::mat4(), comet.position), glm::vec3(comet.radius)) * comet_rotation, glm::vec4(1.0f) });
                 }
+                comet_instances.set_instances(instances);
+                comet_instances.render(mCamera.GetWorldToClipMatrix());
             }
             
             bool opened = ImGui::Begin("Scoreboard", &opened, ImVec2(300, 100), -1.0f, 0);
@@ -526,9 +580,11 @@ enum class polygon_mode_t : unsigned int {
             //       here
             //
             
+            window->CaptureScene();
             ImGui::Render();
             
             window->Swap();
+            benchmark.end_frame();
             lastTime = nowTime;
         }
         
@@ -547,11 +603,16 @@ enum class polygon_mode_t : unsigned int {
         
         glDeleteProgram(texcoord_shader);
         texcoord_shader = 0u;
+        
+        glDeleteProgram(instanced_shader);
+        instanced_shader = 0u;
+        
+        bonobo::releaseObjectTextures(ship_objects);
     }
     
-    int main()
+    int main(int argc, char* argv[])
     {
-        Bonobo::Init();
+        Bonobo::Init(argc, argv);
         try {
             edaf80::Assignment5 Assignment5;
             Assignment5.run();
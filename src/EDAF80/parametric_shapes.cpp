@@ -1,428 +1,316 @@
 
 #include "parametric_shapes.hpp"
+#include "core/gl_state.hpp"
 #include "core/Log.h"
+#include "core/Misc.h"
+#include "core/parametric_grid.hpp"
 #include "core/utils.h"
+#include "core/vertex_format.hpp"
 
 #include <glm/glm.hpp>
 
-#include <array>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <iostream>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
-bonobo::mesh_data
-parametric_shapes::createQuad(unsigned int width, unsigned int height, unsigned int res)
-{
-    auto vertices_nb = res * res;
-
-    auto vertices  = std::vector<glm::vec3>(vertices_nb);
-    auto normals   = std::vector<glm::vec3>(vertices_nb);
-    auto texcoords = std::vector<glm::vec3>(vertices_nb);
-    auto tangents  = std::vector<glm::vec3>(vertices_nb);
-    auto binormals = std::vector<glm::vec3>(vertices_nb);
+// Every shape is a parameterisation of the same grid kernel, which
+// spreads rows over the thread pool; angles are read from tables rather
+// than calling std::cos() and std::sin() per vertex. Rows are drawn as
+// restarted strips, which need a third of the indices of a list.
+// Curved shapes also carry coarser levels of detail, sampled again at
+// about half the resolution each, with the error of their chords.
 
-    // variables to step through x and y
-    float x = 0.0f, dx = width / static_cast<float>(res);
-    float z = 0.0f, dz = height / static_cast<float>(res);
-
-    int index = 0;
+namespace local
+{
+    constexpr size_t max_lods_nb = 4u;
 
-    // assign vertices and texture coordinates
-    for(int i=0; i<res; i++)
+    // Halving the number of steps keeps every other sample, so coarser
+    // levels stay on the same points as long as the steps divide evenly.
+    static unsigned int coarser_resolution(unsigned int res, unsigned int min_res)
     {
-        for(int j=0; j<res; j++)
-        {
-            vertices[index] = glm::vec3(x, 0, z);
-
-            texcoords[index] = glm::vec3(static_cast<float>(j) / (static_cast<float>(res) - 1.0f),
-                                         static_cast<float>(i) / (static_cast<float>(res) - 1.0f),
-                                         0.0f);
-
-            index++;
-            x += dx;
-        }
-        z += dz;
-        x = 0;
+        if (res <= min_res)
+            return res;
+        return std::max((res - 1u) / 2u + 1u, min_res);
     }
 
-    auto indices = std::vector<glm::uvec3>(2u * (res - 1u) * (res - 1u));
+    // Largest distance between an arc of a given radius and the chord
+    // cutting it over an angle.
+    static float sagitta(float radius, float angle)
+    {
+        return radius * (1.0f - std::cos(0.5f * angle));
+    }
 
-    index = 0u;
-    for (unsigned int i = 0u; i < res - 1u; ++i)
+    // `sample(res_u, res_v)` returns the grid_geometry of one level,
+    // with its error set.
+    template<typename Sample>
+    static bonobo::mesh_data create_levels(unsigned int res_u, unsigned int res_v,
+                                           unsigned int min_res_u, unsigned int min_res_v,
+                                           Sample const& sample, bonobo::vertex_format format)
     {
-        for (unsigned int j = 0u; j < res - 1u; ++j)
-        {
-            indices[index] = glm::uvec3(res * i + j,
-                                        res * i + j + 1u,
-                                        res * i + j + 1u + res);
-            ++index;
-
-            indices[index] = glm::uvec3(res * i + j,
-                                        res * i + j + res + 1u,
-                                        res * i + j + res );
-            ++index;
+        auto levels = std::vector<bonobo::grid_geometry>();
+        levels.push_back(sample(res_u, res_v));
+        while (levels.size() <= max_lods_nb) {
+            auto const next_res_u = coarser_resolution(res_u, min_res_u);
+            auto const next_res_v = coarser_resolution(res_v, min_res_v);
+            if (next_res_u == res_u && next_res_v == res_v)
+                break;
+            res_u = next_res_u;
+            res_v = next_res_v;
+            levels.push_back(sample(res_u, res_v));
         }
+        return bonobo::uploadGridSurface(levels, format);
     }
+}
 
-    bonobo::mesh_data data;
-    glGenVertexArrays(1, &data.vao);
-    assert(data.vao != 0u);
-    glBindVertexArray(data.vao);
-
-    auto const vertices_offset = 0u;
-    auto const vertices_size = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
-    auto const normals_offset = vertices_size;
-    auto const normals_size = static_cast<GLsizeiptr>(normals.size() * sizeof(glm::vec3));
-    auto const texcoords_offset = normals_offset + normals_size;
-    auto const texcoords_size = static_cast<GLsizeiptr>(texcoords.size() * sizeof(glm::vec3));
-    auto const tangents_offset = texcoords_offset + texcoords_size;
-    auto const tangents_size = static_cast<GLsizeiptr>(tangents.size() * sizeof(glm::vec3));
-    auto const binormals_offset = tangents_offset + tangents_size;
-    auto const binormals_size = static_cast<GLsizeiptr>(binormals.size() * sizeof(glm::vec3));
-    auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-                                                 + normals_size
-                                                 + texcoords_size
-                                                 + tangents_size
-                                                 + binormals_size
-                                                 );
-    glGenBuffers(1, &data.bo);
-    assert(data.bo != 0u);
-    glBindBuffer(GL_ARRAY_BUFFER, data.bo);
-    glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-    glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(vertices.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
-
-    glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(normals.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::normals));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(texcoords.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(tangents.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::tangents));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(binormals.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::binormals));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0u);
-
-    data.indices_nb = indices.size() * 3u;
-    glGenBuffers(1, &data.ibo);
-    assert(data.ibo != 0u);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(glm::uvec3)), reinterpret_cast<GLvoid const*>(indices.data()), GL_STATIC_DRAW);
-
-    glBindVertexArray(0u);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
-
-    return data;
+bonobo::mesh_data
+parametric_shapes::createQuad(unsigned int width, unsigned int height, unsigned int res,
+                               bonobo::vertex_format const format)
+{
+    // x follows u and z follows v, from 0 to width and height
+    auto const dx = static_cast<float>(width) / (static_cast<float>(res) - 1.0f);
+    auto const dz = static_cast<float>(height) / (static_cast<float>(res) - 1.0f);
+
+    return bonobo::createGridSurface(res, res, [dx, dz](unsigned int u, unsigned int v) {
+        return bonobo::surface_point{ glm::vec3(static_cast<float>(u) * dx, 0.0f, static_cast<float>(v) * dz),
+                                      glm::vec3(0.0f, 1.0f, 0.0f),
+                                      glm::vec3(1.0f, 0.0f, 0.0f),
+                                      glm::vec3(0.0f, 0.0f, 1.0f) };
+    }, format, GL_TRIANGLE_STRIP);
 }
 
 bonobo::mesh_data
 parametric_shapes::createSphere(unsigned int const res_theta,
-                                unsigned int const res_phi, float const radius)
+                                unsigned int const res_phi, float const radius,
+                                bonobo::vertex_format const format)
 {
-    auto const vertices_nb = res_theta * res_phi;
-
-    auto vertices  = std::vector<glm::vec3>(vertices_nb);
-    auto normals   = std::vector<glm::vec3>(vertices_nb);
-    auto texcoords = std::vector<glm::vec3>(vertices_nb);
-    auto tangents  = std::vector<glm::vec3>(vertices_nb);
-    auto binormals = std::vector<glm::vec3>(vertices_nb);
-
-    // variables to step through theta, 0-2PI stepping by dtheta
-    float theta = 0.0f,
-          dtheta = 2.0f * bonobo::pi / (static_cast<float>(res_theta) - 1.0f);
-
-    // variables to step through phi
-    float phi = 0.0f,
-          dphi = bonobo::pi / (static_cast<float>(res_phi) - 1.0f);
-
-    // generate vertices
-    size_t index = 0u;
-    for(unsigned int i = 0u; i < res_phi; ++i)
-    {
-        float cos_phi = std::cos(phi), sin_phi = std::sin(phi);
-
-        for (unsigned int j = 0u; j < res_theta; ++j)
-        {
-
-            float cos_theta = std::cos(theta), sin_theta = std::sin(theta);
-
-
-            // vertices
-            vertices[index] = glm::vec3(radius * sin_theta * sin_phi,
-                                        -radius * cos_phi,
-                                        radius * cos_theta * sin_phi
-                                        );
-
-            // texture coordinates
-            texcoords[index] = glm::vec3(static_cast<float>(j) / (static_cast<float>(res_phi) - 1.0f),
-                                         static_cast<float>(i) / (static_cast<float>(res_theta)  - 1.0f),
-                                         0.0f);
-
-            // tangents
-            auto t = glm::vec3(cos_theta,
-                               0.0f,
-                               -sin_theta);
-
-            tangents[index] = t;
-
-            // binormals
-            auto b = glm::vec3(radius * sin_theta * cos_phi,
-                               radius * sin_phi,
-                               radius * cos_theta * cos_phi);
-
-            b = glm::normalize(b);
-            binormals[index] = b;
-
-            // normals
-            auto const n = glm::cross(t, b);
-            normals[index] = n;
-
-            ++index;
-            theta += dtheta;
-        }
-        phi += dphi;
-        theta=0;
-    }
-
-
-    // create index array
-    auto indices = std::vector<glm::uvec3>(2u * (res_theta - 1u) * (res_phi - 1u));
-
-    // generate indices
-    index = 0u;
-    for (unsigned int i = 0u; i < res_phi - 1u; ++i)
-    {
-        for (unsigned int j = 0u; j < res_theta - 1u; ++j)
-        {
-            indices[index] = glm::uvec3(res_theta * i + j,
-                                        res_theta * i + j + 1u,
-                                        res_theta * i + j + 1u + res_theta);
-            ++index;
-
-            indices[index] = glm::uvec3(res_theta * i + j,
-                                        res_theta * i + j + res_theta + 1u,
-                                        res_theta * i + j + res_theta );
-            ++index;
-        }
-    }
-
-    bonobo::mesh_data data;
-    glGenVertexArrays(1, &data.vao);
-    assert(data.vao != 0u);
-    glBindVertexArray(data.vao);
-
-    auto const vertices_offset = 0u;
-    auto const vertices_size = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
-    auto const normals_offset = vertices_size;
-    auto const normals_size = static_cast<GLsizeiptr>(normals.size() * sizeof(glm::vec3));
-    auto const texcoords_offset = normals_offset + normals_size;
-    auto const texcoords_size = static_cast<GLsizeiptr>(texcoords.size() * sizeof(glm::vec3));
-    auto const tangents_offset = texcoords_offset + texcoords_size;
-    auto const tangents_size = static_cast<GLsizeiptr>(tangents.size() * sizeof(glm::vec3));
-    auto const binormals_offset = tangents_offset + tangents_size;
-    auto const binormals_size = static_cast<GLsizeiptr>(binormals.size() * sizeof(glm::vec3));
-    auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-                                                 + normals_size
-                                                 + texcoords_size
-                                                 + tangents_size
-                                                 + binormals_size
-                                                 );
-    glGenBuffers(1, &data.bo);
-    assert(data.bo != 0u);
-    glBindBuffer(GL_ARRAY_BUFFER, data.bo);
-    glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-    glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(vertices.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
-
-    glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(normals.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::normals));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(texcoords.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(tangents.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::tangents));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(binormals.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::binormals));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0u);
-
-    data.indices_nb = indices.size() * 3u;
-    glGenBuffers(1, &data.ibo);
-    assert(data.ibo != 0u);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(glm::uvec3)), reinterpret_cast<GLvoid const*>(indices.data()), GL_STATIC_DRAW);
-
-    glBindVertexArray(0u);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
-
-    return data;
+    // theta goes around the vertical axis along u, 0-2PI, and phi from
+    // the south pole to the north one along v, 0-PI
+    auto const sample = [radius](unsigned int res_theta, unsigned int res_phi) {
+        auto const thetas = bonobo::computeAngleTable(res_theta, 0.0f, bonobo::two_pi);
+        auto const phis = bonobo::computeAngleTable(res_phi, 0.0f, bonobo::pi);
+
+        auto geometry = bonobo::sampleGridSurface(res_theta, res_phi, [&thetas, &phis, radius](unsigned int u, unsigned int v) {
+            auto const cos_theta = thetas[u].x, sin_theta = thetas[u].y;
+            auto const cos_phi = phis[v].x, sin_phi = phis[v].y;
+
+            auto const t = glm::vec3(cos_theta, 0.0f, -sin_theta);
+            auto const b = glm::vec3(sin_theta * cos_phi, sin_phi, cos_theta * cos_phi);
+            return bonobo::surface_point{ glm::vec3(radius * sin_theta * sin_phi,
+                                                    -radius * cos_phi,
+                                                    radius * cos_theta * sin_phi),
+                                          glm::cross(t, b), t, b };
+        }, GL_TRIANGLE_STRIP);
+        auto const step = std::max(bonobo::two_pi / static_cast<float>(res_theta - 1u),
+                                   bonobo::pi / static_cast<float>(res_phi - 1u));
+        geometry.error = local::sagitta(radius, step);
+        return geometry;
+    };
+    return local::create_levels(res_theta, res_phi, 8u, 5u, sample, format);
 }
 
 bonobo::mesh_data
 parametric_shapes::createTorus(unsigned int const res_theta,
                                unsigned int const res_phi, float const rA,
-                               float const rB)
+                               float const rB, bonobo::vertex_format const format)
 {
-    //! \todo (Optional) Implement this function
-    return bonobo::mesh_data();
+    // theta goes around the tube along u, and phi around the vertical
+    // axis along v, both 0-2PI; the tube is centred between both borders
+    auto const major_radius = 0.5f * (rA + rB);
+    auto const minor_radius = 0.5f * (rB - rA);
+
+    auto const sample = [major_radius, minor_radius](unsigned int res_theta, unsigned int res_phi) {
+        auto const thetas = bonobo::computeAngleTable(res_theta, 0.0f, bonobo::two_pi);
+        auto const phis = bonobo::computeAngleTable(res_phi, 0.0f, bonobo::two_pi);
+
+        auto geometry = bonobo::sampleGridSurface(res_theta, res_phi, [&thetas, &phis, major_radius, minor_radius](unsigned int u, unsigned int v) {
+            auto const cos_theta = thetas[u].x, sin_theta = thetas[u].y;
+            auto const cos_phi = phis[v].x, sin_phi = phis[v].y;
+            auto const distance = major_radius + minor_radius * cos_theta;
+
+            auto const t = glm::vec3(-sin_theta * cos_phi, cos_theta, -sin_theta * sin_phi);
+            auto const b = glm::vec3(-sin_phi, 0.0f, cos_phi);
+            return bonobo::surface_point{ glm::vec3(distance * cos_phi,
+                                                    minor_radius * sin_theta,
+                                                    distance * sin_phi),
+                                          glm::cross(t, b), t, b };
+        }, GL_TRIANGLE_STRIP);
+        // Chords cut across the tube and around the axis, the latter
+        // widest on the outer border.
+        geometry.error = local::sagitta(minor_radius, bonobo::two_pi / static_cast<float>(res_theta - 1u))
+                       + local::sagitta(major_radius + minor_radius, bonobo::two_pi / static_cast<float>(res_phi - 1u));
+        return geometry;
+    };
+    return local::create_levels(res_theta, res_phi, 8u, 8u, sample, format);
 }
 
 bonobo::mesh_data
 parametric_shapes::createCircleRing(unsigned int const res_radius,
                                     unsigned int const res_theta,
                                     float const inner_radius,
-                                    float const outer_radius)
+                                    float const outer_radius,
+                                    bonobo::vertex_format const format)
 {
-    auto const vertices_nb = res_radius * res_theta;
-
-    auto vertices  = std::vector<glm::vec3>(vertices_nb);
-    auto normals   = std::vector<glm::vec3>(vertices_nb);
-    auto texcoords = std::vector<glm::vec3>(vertices_nb);
-    auto tangents  = std::vector<glm::vec3>(vertices_nb);
-    auto binormals = std::vector<glm::vec3>(vertices_nb);
-
-    float theta = 0.0f,                                                        // 'stepping'-variable for theta: will go 0 - 2PI
-          dtheta = 2.0f * bonobo::pi / (static_cast<float>(res_theta) - 1.0f); // step size, depending on the resolution
-
-    float radius = 0.0f,                                                                     // 'stepping'-variable for radius: will go inner_radius - outer_radius
-          dradius = (outer_radius - inner_radius) / (static_cast<float>(res_radius) - 1.0f); // step size, depending on the resolution
-
-    // generate vertices iteratively
-    size_t index = 0u;
-    for (unsigned int i = 0u; i < res_theta; ++i) {
-        float cos_theta = std::cos(theta),
-              sin_theta = std::sin(theta);
-
-        radius = inner_radius;
-
-        for (unsigned int j = 0u; j < res_radius; ++j) {
-            // vertex
-            vertices[index] = glm::vec3(radius * cos_theta,
-                                        radius * sin_theta,
-                                        0.0f);
-
-            // texture coordinates
-            texcoords[index] = glm::vec3(static_cast<float>(j) / (static_cast<float>(res_radius) - 1.0f),
-                                         static_cast<float>(i) / (static_cast<float>(res_theta)  - 1.0f),
-                                         0.0f);
-
-            // tangent
-            auto t = glm::vec3(cos_theta, sin_theta, 0.0f);
-            t = glm::normalize(t);
-            tangents[index] = t;
-
-            // binormal
-            auto b = glm::vec3(-sin_theta, cos_theta, 0.0f);
-            b = glm::normalize(b);
-            binormals[index] = b;
-
-            // normal
-            auto const n = glm::cross(t, b);
-            normals[index] = n;
-
-            radius += dradius;
-            ++index;
-        }
+    // the radius goes from inner_radius to outer_radius along u, and
+    // theta around the ring along v, 0-2PI
+    auto const sample = [inner_radius, outer_radius](unsigned int res_radius, unsigned int res_theta) {
+        auto const dradius = (outer_radius - inner_radius) / (static_cast<float>(res_radius) - 1.0f);
+        auto const thetas = bonobo::computeAngleTable(res_theta, 0.0f, bonobo::two_pi);
+
+        auto geometry = bonobo::sampleGridSurface(res_radius, res_theta, [&thetas, inner_radius, dradius](unsigned int u, unsigned int v) {
+            auto const cos_theta = thetas[v].x, sin_theta = thetas[v].y;
+            auto const radius = inner_radius + static_cast<float>(u) * dradius;
+
+            auto const t = glm::vec3(cos_theta, sin_theta, 0.0f);
+            auto const b = glm::vec3(-sin_theta, cos_theta, 0.0f);
+            return bonobo::surface_point{ glm::vec3(radius * cos_theta, radius * sin_theta, 0.0f),
+                                          glm::cross(t, b), t, b };
+        }, GL_TRIANGLE_STRIP);
+        // The ring is flat: only its outer border departs from the circle.
+        geometry.error = local::sagitta(outer_radius, bonobo::two_pi / static_cast<float>(res_theta - 1u));
+        return geometry;
+    };
+    return local::create_levels(res_radius, res_theta, 2u, 8u, sample, format);
+}
 
-        theta += dtheta;
+namespace local
+{
+    struct shape_entry {
+        bonobo::mesh_data mesh;
+        size_t references_nb;
+        size_t bytes;
+        double generation_time_ms;
+    };
+
+    static std::unordered_map<std::string, shape_entry> entries;
+    static std::unordered_map<GLuint, std::string> keys;
+    static parametric_shapes::shape_cache_stats stats = {};
+
+    // Floats are printed in hexadecimal so that keys match exactly.
+    static std::string make_key(char const* shape, unsigned int res_a, unsigned int res_b,
+                                float param_a, float param_b, bonobo::vertex_format format)
+    {
+        char key[128];
+        std::snprintf(key, sizeof(key), "%s|%u|%u|%a|%a|%u", shape, res_a, res_b,
+                      static_cast<double>(param_a), static_cast<double>(param_b), static_cast<unsigned int>(format));
+        return key;
     }
 
-    // create index array
-    auto indices = std::vector<glm::uvec3>(2u * (res_theta - 1u) * (res_radius - 1u));
-
-    // generate indices iteratively
-    index = 0u;
-    for (unsigned int i = 0u; i < res_theta - 1u; ++i)
+    static parametric_shapes::shared_shape acquire(std::string const& key, float scale,
+                                                   std::function<bonobo::mesh_data ()> const& create)
     {
-        for (unsigned int j = 0u; j < res_radius - 1u; ++j)
-        {
-            indices[index] = glm::uvec3(res_radius * i + j,
-                                        res_radius * i + j + 1u,
-                                        res_radius * i + j + 1u + res_radius);
-            ++index;
-
-            indices[index] = glm::uvec3(res_radius * i + j,
-                                        res_radius * i + j + res_radius + 1u,
-                                        res_radius * i + j + res_radius);
-            ++index;
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            auto const start_time = StartTimer();
+            auto mesh = create();
+            auto const generation_time_ms = static_cast<double>(EndTimerNanoseconds(start_time)) * 0.000001;
+            stats.generation_time_ms += generation_time_ms;
+            if (mesh.vao == 0u)
+                return parametric_shapes::shared_shape{ mesh, scale };
+
+            auto const bytes = mesh.vertices_nb * bonobo::vertexSize(mesh.format, mesh.attributes)
+                             + bonobo::indexBufferLength(mesh) * bonobo::indexSize(mesh.index_type);
+            it = entries.emplace(key, shape_entry{ mesh, 0u, bytes, generation_time_ms }).first;
+            keys.emplace(mesh.vao, key);
+
+            ++stats.meshes_nb;
+            ++stats.generations_nb;
+            stats.bytes_resident += bytes;
+        }
+
+        auto& entry = it->second;
+        if (entry.references_nb++ > 0u) {
+            ++stats.hits_nb;
+            stats.bytes_saved += entry.bytes;
+            stats.generation_time_saved_ms += entry.generation_time_ms;
         }
+        return parametric_shapes::shared_shape{ entry.mesh, scale };
     }
+}
 
-    bonobo::mesh_data data;
-    glGenVertexArrays(1, &data.vao);
-    assert(data.vao != 0u);
-    glBindVertexArray(data.vao);
-
-    auto const vertices_offset = 0u;
-    auto const vertices_size = static_cast<GLsizeiptr>(vertices.size() * sizeof(glm::vec3));
-    auto const normals_offset = vertices_size;
-    auto const normals_size = static_cast<GLsizeiptr>(normals.size() * sizeof(glm::vec3));
-    auto const texcoords_offset = normals_offset + normals_size;
-    auto const texcoords_size = static_cast<GLsizeiptr>(texcoords.size() * sizeof(glm::vec3));
-    auto const tangents_offset = texcoords_offset + texcoords_size;
-    auto const tangents_size = static_cast<GLsizeiptr>(tangents.size() * sizeof(glm::vec3));
-    auto const binormals_offset = tangents_offset + tangents_size;
-    auto const binormals_size = static_cast<GLsizeiptr>(binormals.size() * sizeof(glm::vec3));
-    auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-                                                +normals_size
-                                                +texcoords_size
-                                                +tangents_size
-                                                +binormals_size
-                                                );
-    glGenBuffers(1, &data.bo);
-    assert(data.bo != 0u);
-    glBindBuffer(GL_ARRAY_BUFFER, data.bo);
-    glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
-
-    glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(vertices.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
-
-    glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(normals.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::normals));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(texcoords.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(tangents.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::tangents));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
-
-    glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(binormals.data()));
-    glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::binormals));
-    glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0u);
-
-    data.indices_nb = indices.size() * 3u;
-    glGenBuffers(1, &data.ibo);
-    assert(data.ibo != 0u);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.ibo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices.size() * sizeof(glm::uvec3)), reinterpret_cast<GLvoid const*>(indices.data()), GL_STATIC_DRAW);
-
-    glBindVertexArray(0u);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
-
-    return data;
+parametric_shapes::shared_shape
+parametric_shapes::acquireQuad(unsigned int width, unsigned int height, unsigned int res,
+                               bonobo::vertex_format const format)
+{
+    auto const key = local::make_key("quad", res, res, static_cast<float>(width), static_cast<float>(height), format);
+    return local::acquire(key, 1.0f, [=]() { return createQuad(width, height, res, format); });
+}
+
+parametric_shapes::shared_shape
+parametric_shapes::acquireSphere(unsigned int const res_theta,
+                                 unsigned int const res_phi, float const radius,
+                                 bonobo::vertex_format const format)
+{
+    auto const key = local::make_key("sphere", res_theta, res_phi, 1.0f, 0.0f, format);
+    return local::acquire(key, radius, [=]() { return createSphere(res_theta, res_phi, 1.0f, format); });
 }
 
+parametric_shapes::shared_shape
+parametric_shapes::acquireTorus(unsigned int const res_theta,
+                                unsigned int const res_phi, float const rA,
+                                float const rB, bonobo::vertex_format const format)
+{
+    // Without an outer radius to divide by, the torus is kept as is.
+    auto const scale = rB > 0.0f ? rB : 1.0f;
+    auto const unit_rA = rA / scale, unit_rB = rB / scale;
+    auto const key = local::make_key("torus", res_theta, res_phi, unit_rA, unit_rB, format);
+    return local::acquire(key, scale, [=]() { return createTorus(res_theta, res_phi, unit_rA, unit_rB, format); });
+}
+
+parametric_shapes::shared_shape
+parametric_shapes::acquireCircleRing(unsigned int const res_radius,
+                                     unsigned int const res_theta,
+                                     float const inner_radius,
+                                     float const outer_radius,
+                                     bonobo::vertex_format const format)
+{
+    auto const scale = outer_radius > 0.0f ? outer_radius : 1.0f;
+    auto const unit_inner_radius = inner_radius / scale, unit_outer_radius = outer_radius / scale;
+    auto const key = local::make_key("circle_ring", res_radius, res_theta, unit_inner_radius, unit_outer_radius, format);
+    return local::acquire(key, scale, [=]() { return createCircleRing(res_radius, res_theta, unit_inner_radius, unit_outer_radius, format); });
+}
+
+void
+parametric_shapes::releaseShape(bonobo::mesh_data const& mesh)
+{
+    auto const key_it = local::keys.find(mesh.vao);
+    if (key_it == local::keys.end()) {
+        LogWarning("Mesh %u was not obtained from the shape cache", mesh.vao);
+        return;
+    }
+
+    auto const entry_it = local::entries.find(key_it->second);
+    assert(entry_it != local::entries.end());
+    auto& entry = entry_it->second;
+    if (--entry.references_nb > 0u)
+        return;
+
+    glDeleteBuffers(1, &entry.mesh.ibo);
+    glDeleteBuffers(1, &entry.mesh.bo);
+    glDeleteVertexArrays(1, &entry.mesh.vao);
+    bonobo::gl_state::invalidate();
+    --local::stats.meshes_nb;
+    local::stats.bytes_resident -= entry.bytes;
+    local::entries.erase(entry_it);
+    local::keys.erase(key_it);
+}
+
+parametric_shapes::shape_cache_stats
+parametric_shapes::getShapeCacheStats()
+{
+    return local::stats;
+}
+
+void
+parametric_shapes::logShapeCacheStats()
+{
+    auto const& stats = local::stats;
+    LogInfo("Shape cache: %zu meshes resident (%.1f MB), %zu generations taking %.1f ms; %zu duplicate requests saved %.1f MB and %.1f ms",
+            stats.meshes_nb, static_cast<double>(stats.bytes_resident) / (1024.0 * 1024.0),
+            stats.generations_nb, stats.generation_time_ms,
+            stats.hits_nb, static_cast<double>(stats.bytes_saved) / (1024.0 * 1024.0), stats.generation_time_saved_ms);
+}
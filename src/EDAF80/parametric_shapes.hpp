@@ -10,9 +10,12 @@ namespace parametric_shapes
     //!
     //! @param width the width of the quad
     //! @param height the height of the quad
+    //! @param res tessellation resolution (nbr of vertices) along each side
+    //! @param format layout to store the vertex attributes in
     //! @return wrapper around OpenGL objects' name containing the geometry
     //!         data
-    bonobo::mesh_data createQuad(unsigned int width, unsigned int height, unsigned int res);
+    bonobo::mesh_data createQuad(unsigned int width, unsigned int height, unsigned int res,
+                                 bonobo::vertex_format const format = bonobo::vertex_format::interleaved_packed);
 
     //! \brief Create a sphere for some tesselation level and make it
     //!        available to OpenGL.
@@ -20,9 +23,11 @@ namespace parametric_shapes
     //! @param res_theta tessellation resolution (nbr of vertices) in the latitude direction ( 0 < theta < PI/2 )
     //! @param res_phi tessellation resolution (nbr of vertices) in the longitude direction ( 0 < phi < 2PI )
     //! @param radius radius of the sphere
+    //! @param format layout to store the vertex attributes in
     //! @return wrapper around OpenGL objects' name containing the geometry
     //!         data
-    bonobo::mesh_data createSphere(unsigned int const res_theta, unsigned int const res_phi, float const radius);
+    bonobo::mesh_data createSphere(unsigned int const res_theta, unsigned int const res_phi, float const radius,
+                                   bonobo::vertex_format const format = bonobo::vertex_format::interleaved_packed);
 
     //! \brief Create a torus for some tesselation level and make it
     //!        available to OpenGL.
@@ -31,9 +36,11 @@ namespace parametric_shapes
     //! @param res_phi tessellation resolution (nbr of vertices) in the longitude direction ( 0 < phi < 2PI )
     //! @param rA radius of the innermost border of the torus
     //! @param rB radius of the outermost border of the torus
+    //! @param format layout to store the vertex attributes in
     //! @return wrapper around OpenGL objects' name containing the geometry
     //!         data
-    bonobo::mesh_data createTorus(unsigned int const res_theta, unsigned int const res_phi, float const rA, float const rB);
+    bonobo::mesh_data createTorus(unsigned int const res_theta, unsigned int const res_phi, float const rA, float const rB,
+                                  bonobo::vertex_format const format = bonobo::vertex_format::interleaved_packed);
 
     //! \brief Create a circle ring for some tesselation level and make it
     //!        available to OpenGL.
@@ -42,8 +49,79 @@ namespace parametric_shapes
     //! @param theta_res tessellation resolution (nbr of vertices) in the angular direction ( 0 < theta < 2PI )
     //! @param inner_radius radius of the innermost border of the ring
     //! @param outer_radius radius of the outermost border of the ring
+    //! @param format layout to store the vertex attributes in
     //! @return wrapper around OpenGL objects' name containing the geometry
     //!         data
-    bonobo::mesh_data createCircleRing(unsigned int const radius_res, unsigned int const theta_res, float const inner_radius, float const outer_radius);
+    bonobo::mesh_data createCircleRing(unsigned int const radius_res, unsigned int const theta_res, float const inner_radius, float const outer_radius,
+                                       bonobo::vertex_format const format = bonobo::vertex_format::interleaved_packed);
+
+    //! \brief A mesh shared through the shape cache, and the uniform
+    //!        scale nodes using it should apply, e.g. with
+    //!        `Node::set_scaling(glm::vec3(scale))`.
+    struct shared_shape {
+        bonobo::mesh_data mesh;
+        float scale;
+    };
+
+    //! \brief Statistics on how much work the shape cache avoided.
+    struct shape_cache_stats {
+        size_t meshes_nb;                //!< number of distinct meshes currently resident
+        size_t generations_nb;           //!< number of meshes actually generated and uploaded
+        size_t hits_nb;                  //!< number of requests served from the cache
+        size_t bytes_resident;           //!< GPU memory used by resident meshes
+        size_t bytes_saved;              //!< GPU memory that duplicates would have used
+        double generation_time_ms;       //!< time spent generating and uploading
+        double generation_time_saved_ms; //!< time duplicates would have spent generating and uploading
+    };
+
+    //! \brief Get a quad from the shape cache, creating it only if no
+    //!        quad with the same parameters is resident.
+    //!
+    //! Quads are not folded by scale, as shaders such as the water one
+    //! work on object-space positions; the returned scale is always 1.
+    //! Meshes from the cache are reference counted: every call must
+    //! eventually be matched by a call to `releaseShape()`.
+    //!
+    //! See `createQuad()` for the parameters.
+    shared_shape acquireQuad(unsigned int width, unsigned int height, unsigned int res,
+                             bonobo::vertex_format const format = bonobo::vertex_format::interleaved_packed);
+
+    //! \brief Get a sphere from the shape cache.
+    //!
+    //! All spheres with the same resolution share one unit sphere, to be
+    //! scaled by `radius`. See `acquireQuad()` for the reference counting,
+    //! and `createSphere()` for the parameters.
+    shared_shape acquireSphere(unsigned int const res_theta, unsigned int const res_phi, float const radius,
+                               bonobo::vertex_format const format = bonobo::vertex_format::interleaved_packed);
+
+    //! \brief Get a torus from the shape cache.
+    //!
+    //! Tori with the same resolution and the same ratio between their
+    //! radii share one mesh whose outer radius is 1, to be scaled by
+    //! `rB`. See `acquireQuad()` for the reference counting, and
+    //! `createTorus()` for the parameters.
+    shared_shape acquireTorus(unsigned int const res_theta, unsigned int const res_phi, float const rA, float const rB,
+                              bonobo::vertex_format const format = bonobo::vertex_format::interleaved_packed);
+
+    //! \brief Get a circle ring from the shape cache.
+    //!
+    //! Rings with the same resolution and the same ratio between their
+    //! radii share one mesh whose outer radius is 1, to be scaled by
+    //! `outer_radius`. See `acquireQuad()` for the reference counting,
+    //! and `createCircleRing()` for the parameters.
+    shared_shape acquireCircleRing(unsigned int const radius_res, unsigned int const theta_res, float const inner_radius, float const outer_radius,
+                                   bonobo::vertex_format const format = bonobo::vertex_format::interleaved_packed);
+
+    //! \brief Drop one reference to a mesh obtained from the shape
+    //!        cache, deleting it once unused.
+    //!
+    //! @param mesh the mesh returned by one of the `acquire*()` functions
+    void releaseShape(bonobo::mesh_data const& mesh);
+
+    //! \brief Retrieve the current shape cache statistics.
+    shape_cache_stats getShapeCacheStats();
+
+    //! \brief Log the current shape cache statistics.
+    void logShapeCacheStats();
 }
 
@@ -1,21 +1,34 @@
 #include "assignment2.hpp"
+#include "EDAF80/interpolation.hpp"
 
 #include "config.hpp"
 #include "external/glad/glad.h"
+#include "core/benchmark.hpp"
 #include "core/Bonobo.h"
+#include "core/bounds.hpp"
+#include "core/bvh.hpp"
 #include "core/FPSCamera.h"
+#include "core/geometry_arena.hpp"
 #include "core/GLStateInspection.h"
 #include "core/GLStateInspectionView.h"
+#include "core/gpu_profiler.hpp"
+#include "core/gl_state.hpp"
 #include "core/helpers.hpp"
 #include "core/InputHandler.h"
+#include "core/lod.hpp"
 #include "core/Log.h"
 #include "core/LogView.h"
 #include "core/Misc.h"
 #include "core/node.hpp"
+#include "core/Profiler.h"
+#include "core/ProfilerView.h"
+#include "core/render_queue.hpp"
+#include "core/shader_manager.hpp"
+#include "core/uniform_buffer.hpp"
+#include "core/uniform_cache.hpp"
 #include "core/utils.h"
 #include "core/Window.h"
 #include <imgui.h>
-#include "external/imgui_impl_glfw_gl3.h"
 
 #include "external/glad/glad.h"
 #include <GLFW/glfw3.h>
@@ -38,6 +51,17 @@ static polygon_mode_t get_next_mode(polygon_mode_t mode)
 	return static_cast<polygon_mode_t>((static_cast<unsigned int>(mode) + 1u) % 3u);
 }
 
+namespace uniforms
+{
+	static auto const depth_texture           = bonobo::getUniformID("depth_texture");
+	static auto const normal_texture          = bonobo::getUniformID("normal_texture");
+	static auto const shadow_texture          = bonobo::getUniformID("shadow_texture");
+	static auto const diffuse_texture         = bonobo::getUniformID("diffuse_texture");
+	static auto const specular_texture        = bonobo::getUniformID("specular_texture");
+	static auto const light_d_texture         = bonobo::getUniformID("light_d_texture");
+	static auto const light_s_texture         = bonobo::getUniformID("light_s_texture");
+}
+
 namespace constant
 {
 	constexpr uint32_t shadowmap_res_x = 1024;
@@ -49,6 +73,32 @@ namespace constant
 	constexpr float  light_cutoff        = 0.05f;
 }
 
+// Mirrors of the std140 blocks declared by accumulate_lights.frag: a vec3
+// takes 16 bytes, unless followed by a float.
+namespace blocks
+{
+	struct per_frame {
+		glm::vec2 inv_res;
+		glm::vec2 shadowmap_texel_size;
+	};
+
+	struct per_view {
+		glm::mat4 view_projection_inverse;
+		glm::vec3 camera_position;
+		float     padding;
+	};
+
+	struct per_light {
+		glm::mat4 shadow_view_projection;
+		glm::vec3 color;
+		float     intensity;
+		glm::vec3 position;
+		float     angle_falloff;
+		glm::vec3 direction;
+		float     padding;
+	};
+}
+
 static bonobo::mesh_data loadCone();
 
 edan35::Assignment2::Assignment2()
@@ -90,11 +140,16 @@ void
 edan35::Assignment2::run()
 {
 	// Load the geometry of Sponza
-	auto const sponza_geometry = bonobo::loadObjects("../crysponza/sponza.obj");
+	auto sponza_geometry = bonobo::loadObjects("../crysponza/sponza.obj");
 	if (sponza_geometry.empty()) {
 		LogError("Failed to load the Sponza model");
 		return;
 	}
+
+	// Move all meshes into a few shared buffers, so that draws sharing a
+	// material can be merged by the render queue.
+	bonobo::geometry_arena sponza_arena;
+	sponza_arena.add(sponza_geometry);
 	std::vector<Node> sponza_elements;
 	sponza_elements.reserve(sponza_geometry.size());
 	for (auto const& shape : sponza_geometry) {
@@ -103,6 +158,15 @@ edan35::Assignment2::run()
 		sponza_elements.push_back(node);
 	}
 
+	// Sponza never moves, so its hierarchy is built once.
+	auto const bvh_start_time = GetTimeMilliseconds();
+	bonobo::bvh sponza_bvh;
+	sponza_bvh.build(sponza_elements);
+	LogInfo("Built a BVH of %u nodes over %u meshes in %.1f ms",
+	        static_cast<unsigned int>(sponza_bvh.get_nodes_nb()),
+	        static_cast<unsigned int>(sponza_bvh.get_primitives_nb()),
+	        GetTimeMilliseconds() - bvh_start_time);
+
 	auto const cone_geometry = loadCone();
 	Node cone;
 	cone.set_geometry(cone_geometry);
@@ -127,26 +191,16 @@ edan35::Assignment2::run()
 	auto fallback_shader = bonobo::createProgram("fallback.vert", "fallback.frag");
 	if (fallback_shader == 0u) {
 		LogError("Failed to load fallback shader");
+		bonobo::releaseObjectTextures(sponza_geometry);
 		return;
 	}
-	auto const reload_shader = [fallback_shader](std::string const& vertex_path, std::string const& fragment_path, GLuint& program){
-		if (program != 0u && program != fallback_shader)
-			glDeleteProgram(program);
-		program = bonobo::createProgram("../EDAN35/" + vertex_path, "../EDAN35/" + fragment_path);
-		if (program == 0u) {
-			LogError("Failed to load \"%s\" and \"%s\"", vertex_path.c_str(), fragment_path.c_str());
-			program = fallback_shader;
-		}
-	};
-	GLuint fill_gbuffer_shader = 0u, fill_shadowmap_shader = 0u, accumulate_lights_shader = 0u, resolve_deferred_shader = 0u;
-	auto const reload_shaders = [&reload_shader,&fill_gbuffer_shader,&fill_shadowmap_shader,&accumulate_lights_shader,&resolve_deferred_shader](){
-		LogInfo("Reloading shaders");
-		reload_shader("fill_gbuffer.vert",      "fill_gbuffer.frag",      fill_gbuffer_shader);
-		reload_shader("fill_shadowmap.vert",    "fill_shadowmap.frag",    fill_shadowmap_shader);
-		reload_shader("accumulate_lights.vert", "accumulate_lights.frag", accumulate_lights_shader);
-		reload_shader("resolve_deferred.vert",  "resolve_deferred.frag",  resolve_deferred_shader);
-	};
-	reload_shaders();
+	// Programs get rebuilt, in the background, whenever their sources
+	// are saved; a failed build leaves the previous program in place.
+	bonobo::shader_manager shaders;
+	auto const fill_gbuffer_program      = shaders.add("../EDAN35/fill_gbuffer.vert",      "../EDAN35/fill_gbuffer.frag",      fallback_shader);
+	shaders.add("../EDAN35/fill_shadowmap.vert", "../EDAN35/fill_shadowmap.frag", fallback_shader); // not used by any pass yet
+	auto const accumulate_lights_program = shaders.add("../EDAN35/accumulate_lights.vert", "../EDAN35/accumulate_lights.frag", fallback_shader);
+	auto const resolve_deferred_program  = shaders.add("../EDAN35/resolve_deferred.vert",  "../EDAN35/resolve_deferred.frag",  fallback_shader);
 
 	auto const set_uniforms = [](GLuint /*program*/){};
 
@@ -195,11 +249,10 @@ edan35::Assignment2::run()
 		GLfloat border_color[4] = { 1.0f, 0.0f, 0.0f, 0.0f};
 		glSamplerParameterfv(sampler, GL_TEXTURE_BORDER_COLOR, border_color);
 	});
-	auto const bind_texture_with_sampler = [](GLenum target, unsigned int slot, GLuint program, std::string const& name, GLuint texture, GLuint sampler){
-		glActiveTexture(GL_TEXTURE0 + slot);
-		glBindTexture(target, texture);
-		glUniform1i(glGetUniformLocation(program, name.c_str()), static_cast<GLint>(slot));
-		glBindSampler(slot, sampler);
+	auto const bind_texture_with_sampler = [](GLenum target, unsigned int slot, GLuint program, bonobo::uniform_id name, GLuint texture, GLuint sampler){
+		bonobo::gl_state::bindTexture(slot, target, texture);
+		glUniform1i(bonobo::getUniformLocation(program, name), static_cast<GLint>(slot));
+		bonobo::gl_state::bindSampler(slot, sampler);
 	};
 
 
@@ -230,17 +283,51 @@ edan35::Assignment2::run()
 	auto seconds_nb = 0.0f;
 
 
-	glEnable(GL_DEPTH_TEST);
-	glEnable(GL_CULL_FACE);
+	// Constants shared by the draws of a frame are written once, then
+	// selected per draw by binding their offset. Offsets get aligned to
+	// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, which is at most 256 bytes.
+	auto const uniform_blocks_nb = 2u + constant::lights_nb;
+	bonobo::uniform_ring uniform_ring(sizeof(blocks::per_frame) + sizeof(blocks::per_view)
+	                                  + constant::lights_nb * sizeof(blocks::per_light)
+	                                  + uniform_blocks_nb * 256u);
+	std::array<glm::mat4, constant::lights_nb> light_matrices;
+	std::array<GLintptr, constant::lights_nb> light_blocks;
+
+
+	bonobo::gl_state::setEnabled(GL_DEPTH_TEST, true);
+	bonobo::gl_state::setEnabled(GL_CULL_FACE, true);
+
+
+	// Sponza has a few hundred meshes sharing a handful of materials:
+	// sort them to avoid switching textures back and forth.
+	bonobo::render_queue render_queue;
+
+	// Time spent by the GPU on each pass, read back a few frames later.
+	bonobo::gpu_profiler gpu_profiler;
+	auto merge_draws = true;
+
+	// Only the meshes inside the frustum of the camera, or of a light for
+	// its shadow map, are submitted.
+	std::vector<uint32_t> visible_elements;
+	visible_elements.reserve(sponza_elements.size());
+	bonobo::culling_stats gbuffer_culling, shadowmap_culling;
 
+	// Meshes far enough from the camera are drawn with their coarser
+	// levels of detail, in the shadow maps as well.
+	bonobo::lod_stats lod_stats;
+
+
+	// Replays a camera path on a fixed timestep when benchmarking.
+	bonobo::benchmark benchmark(window->GetTitle(), interpolation::evalCatmullRom);
 
 	double ddeltatime;
 	size_t fpsSamples = 0;
-	double nowTime, lastTime = GetTimeMilliseconds();
+	double nowTime, lastTime = benchmark.get_time_milliseconds();
 	double fpsNextTick = lastTime + 1000.0;
 
-	while (!glfwWindowShouldClose(window->GetGLFW_Window())) {
-		nowTime = GetTimeMilliseconds();
+	while (!window->ShouldClose() && !benchmark.is_done()) {
+		benchmark.begin_frame();
+		nowTime = benchmark.get_time_milliseconds();
 		ddeltatime = nowTime - lastTime;
 		if (nowTime > fpsNextTick) {
 			fpsNextTick += 1000.0;
@@ -252,23 +339,69 @@ edan35::Assignment2::run()
 		auto& io = ImGui::GetIO();
 		inputHandler->SetUICapture(io.WantCaptureMouse, io.WantCaptureMouse);
 
-		glfwPollEvents();
+		window->PollEvents();
 		inputHandler->Advance();
-		mCamera.Update(ddeltatime, *inputHandler);
-
-		ImGui_ImplGlfwGL3_NewFrame();
+		if (benchmark.has_camera_path())
+			benchmark.place_camera(mCamera);
+		else
+			mCamera.Update(ddeltatime, *inputHandler);
+
+		window->NewImGuiFrame();
+		bonobo::gl_state::newFrame();
+		render_queue.new_frame();
+		render_queue.set_merge_draws(merge_draws);
+		gpu_profiler.begin_frame();
+		PROFILE_NEW_FRAME();
 
 		if (inputHandler->GetKeycodeState(GLFW_KEY_R) & JUST_PRESSED) {
-			reload_shaders();
+			LogInfo("Reloading shaders");
+			shaders.reload_all();
+		}
+		shaders.update();
+		auto const fill_gbuffer_shader      = shaders.get(fill_gbuffer_program);
+		auto const accumulate_lights_shader = shaders.get(accumulate_lights_program);
+		auto const resolve_deferred_shader  = shaders.get(resolve_deferred_program);
+
+
+		//
+		// Write the constants of all passes
+		//
+		uniform_ring.begin_frame();
+		auto const frame_block = uniform_ring.write(blocks::per_frame{
+			glm::vec2(1.0f / static_cast<float>(window_size.x), 1.0f / static_cast<float>(window_size.y)),
+			glm::vec2(1.0f / static_cast<float>(constant::shadowmap_res_x), 1.0f / static_cast<float>(constant::shadowmap_res_y))
+		});
+		auto const view_block = uniform_ring.write(blocks::per_view{
+			mCamera.GetClipToWorldMatrix(),
+			mCamera.mWorld.GetTranslation(),
+			0.0f
+		});
+		for (size_t i = 0; i < constant::lights_nb; ++i) {
+			auto& lightTransform = lightTransforms[i];
+			lightTransform.SetRotate(seconds_nb * 0.1f + i * 1.57f, glm::vec3(0.0f, 1.0f, 0.0f));
+			light_matrices[i] = lightProjection * lightOffsetTransform.GetMatrixInverse() * lightTransform.GetMatrixInverse();
+
+			light_blocks[i] = uniform_ring.write(blocks::per_light{
+				light_matrices[i],
+				lightColors[i],
+				constant::light_intensity,
+				lightTransform.GetTranslation(),
+				constant::light_angle_falloff,
+				lightTransform.GetFront(),
+				0.0f
+			});
 		}
+		uniform_ring.end_frame();
+		uniform_ring.bind<blocks::per_frame>(bonobo::uniform_block_binding::per_frame, frame_block);
+		uniform_ring.bind<blocks::per_view>(bonobo::uniform_block_binding::per_view, view_block);
 
 
 
-		glDepthFunc(GL_LESS);
+		bonobo::gl_state::depthFunc(GL_LESS);
 		//
 		// Pass 1: Render scene into the g-buffer
 		//
-		glBindFramebuffer(GL_FRAMEBUFFER, deferred_fbo);
+		bonobo::gl_state::bindFramebuffer(deferred_fbo);
 		GLenum const deferred_draw_buffers[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
 		glDrawBuffers(3, deferred_draw_buffers);
 		auto const status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
@@ -279,117 +412,128 @@ edan35::Assignment2::run()
 		// XXX: Is any other clearing needed?
 
 		GLStateInspection::CaptureSnapshot("Filling Pass");
+		gpu_profiler.begin_section("Filling Pass");
+		PROFILE_BEGIN("Filling Pass");
 
-		for (auto const& element : sponza_elements)
-			element.render(mCamera.GetWorldToClipMatrix(), element.get_transform(), fill_gbuffer_shader, set_uniforms);
+		PROFILE_BEGIN("Scene traversal");
+		lod_stats = bonobo::selectLods(mCamera.GetLodView(static_cast<float>(window_size.y)), sponza_elements);
+		gbuffer_culling = sponza_bvh.cull(mCamera.GetFrustum(), visible_elements);
+		for (auto const index : visible_elements)
+			render_queue.submit(sponza_elements[index], mCamera.GetWorldToClipMatrix(), sponza_elements[index].get_transform(), fill_gbuffer_shader, set_uniforms);
+		PROFILE_END();
+		render_queue.flush();
 
+		PROFILE_END();
+		gpu_profiler.end_section();
 
 
-		glCullFace(GL_FRONT);
+
+		bonobo::gl_state::cullFace(GL_FRONT);
 		//
 		// Pass 2: Generate shadowmaps and accumulate lights' contribution
 		//
-		glBindFramebuffer(GL_FRAMEBUFFER, light_fbo);
+		bonobo::gl_state::bindFramebuffer(light_fbo);
 		GLenum light_draw_buffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
 		glDrawBuffers(2, light_draw_buffers);
 		glViewport(0, 0, window_size.x, window_size.y);
 		// XXX: Is any clearing needed?
+		shadowmap_culling = bonobo::culling_stats();
 		for (size_t i = 0; i < constant::lights_nb; ++i) {
-			auto& lightTransform = lightTransforms[i];
-			lightTransform.SetRotate(seconds_nb * 0.1f + i * 1.57f, glm::vec3(0.0f, 1.0f, 0.0f));
-
-			auto light_matrix = lightProjection * lightOffsetTransform.GetMatrixInverse() * lightTransform.GetMatrixInverse();
+			auto const& lightTransform = lightTransforms[i];
+			auto const& light_matrix = light_matrices[i];
 
 			//
 			// Pass 2.1: Generate shadow map for light i
 			//
-			glBindFramebuffer(GL_FRAMEBUFFER, shadowmap_fbo);
+			bonobo::gl_state::bindFramebuffer(shadowmap_fbo);
 			glViewport(0, 0, constant::shadowmap_res_x, constant::shadowmap_res_y);
 			// XXX: Is any clearing needed?
 
 			GLStateInspection::CaptureSnapshot("Shadow Map Generation");
+			gpu_profiler.begin_section("Shadow Map Generation");
+			PROFILE_BEGIN("Shadow Map Generation");
+
+			PROFILE_BEGIN("Scene traversal");
+			shadowmap_culling += sponza_bvh.cull(bonobo::extractFrustum(light_matrix), visible_elements);
+			for (auto const index : visible_elements)
+				render_queue.submit(sponza_elements[index], light_matrix, glm::mat4(), fill_gbuffer_shader, set_uniforms);
+			PROFILE_END();
+			render_queue.flush();
 
-			for (auto const& element : sponza_elements)
-				element.render(light_matrix, glm::mat4(), fill_gbuffer_shader, set_uniforms);
+			PROFILE_END();
+			gpu_profiler.end_section();
 
 
-			glEnable(GL_BLEND);
-			glDepthFunc(GL_GREATER);
-			glDepthMask(GL_FALSE);
-			glBlendEquationSeparate(GL_FUNC_ADD, GL_MIN);
-			glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
+			bonobo::gl_state::setEnabled(GL_BLEND, true);
+			bonobo::gl_state::depthFunc(GL_GREATER);
+			bonobo::gl_state::depthMask(GL_FALSE);
+			bonobo::gl_state::blendEquationSeparate(GL_FUNC_ADD, GL_MIN);
+			bonobo::gl_state::blendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ONE);
 			//
 			// Pass 2.2: Accumulate light i contribution
-			glBindFramebuffer(GL_FRAMEBUFFER, light_fbo);
+			bonobo::gl_state::bindFramebuffer(light_fbo);
 			glDrawBuffers(2, light_draw_buffers);
-			glUseProgram(accumulate_lights_shader);
+			bonobo::gl_state::useProgram(accumulate_lights_shader);
 			glViewport(0, 0, window_size.x, window_size.y);
 			// XXX: Is any clearing needed?
 
-			auto const spotlight_set_uniforms = [&window_size,&mCamera,&light_matrix,&lightColors,&lightTransform,&i](GLuint program){
-				glUniform2f(glGetUniformLocation(program, "inv_res"),
-				            1.0f / static_cast<float>(window_size.x),
-				            1.0f / static_cast<float>(window_size.y));
-				glUniformMatrix4fv(glGetUniformLocation(program, "view_projection_inverse"), 1, GL_FALSE,
-				                   glm::value_ptr(mCamera.GetClipToWorldMatrix()));
-				glUniform3fv(glGetUniformLocation(program, "camera_position"), 1,
-				                   glm::value_ptr(mCamera.mWorld.GetTranslation()));
-				glUniformMatrix4fv(glGetUniformLocation(program, "shadow_view_projection"), 1, GL_FALSE,
-				                   glm::value_ptr(light_matrix));
-				glUniform3fv(glGetUniformLocation(program, "light_color"), 1, glm::value_ptr(lightColors[i]));
-				glUniform3fv(glGetUniformLocation(program, "light_position"), 1, glm::value_ptr(lightTransform.GetTranslation()));
-				glUniform3fv(glGetUniformLocation(program, "light_direction"), 1, glm::value_ptr(lightTransform.GetFront()));
-				glUniform1f(glGetUniformLocation(program, "light_intensity"), constant::light_intensity);
-				glUniform1f(glGetUniformLocation(program, "light_angle_falloff"), constant::light_angle_falloff);
-				glUniform2f(glGetUniformLocation(program, "shadowmap_texel_size"),
-				            1.0f / static_cast<float>(constant::shadowmap_res_x),
-				            1.0f / static_cast<float>(constant::shadowmap_res_y));
+			auto const spotlight_set_uniforms = [&uniform_ring,&light_blocks,&i](GLuint /*program*/){
+				uniform_ring.bind<blocks::per_light>(bonobo::uniform_block_binding::per_light, light_blocks[i]);
 			};
 
-			bind_texture_with_sampler(GL_TEXTURE_2D, 0, accumulate_lights_shader, "depth_texture", depth_texture, depth_sampler);
-			bind_texture_with_sampler(GL_TEXTURE_2D, 1, accumulate_lights_shader, "normal_texture", normal_texture, default_sampler);
-			bind_texture_with_sampler(GL_TEXTURE_2D, 2, accumulate_lights_shader, "shadow_texture", shadowmap_texture, shadow_sampler);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 0, accumulate_lights_shader, uniforms::depth_texture, depth_texture, depth_sampler);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 1, accumulate_lights_shader, uniforms::normal_texture, normal_texture, default_sampler);
+			bind_texture_with_sampler(GL_TEXTURE_2D, 2, accumulate_lights_shader, uniforms::shadow_texture, shadowmap_texture, shadow_sampler);
 
 			GLStateInspection::CaptureSnapshot("Accumulating");
+			gpu_profiler.begin_section("Accumulating");
+			PROFILE_BEGIN("Accumulating");
 
 			cone.render(mCamera.GetWorldToClipMatrix(),
 			            lightTransform.GetMatrix() * lightOffsetTransform.GetMatrix() * coneScaleTransform.GetMatrix(),
 			            accumulate_lights_shader, spotlight_set_uniforms);
 
-			glBindSampler(2u, 0u);
-			glBindSampler(1u, 0u);
-			glBindSampler(0u, 0u);
+			PROFILE_END();
+			gpu_profiler.end_section();
 
-			glDepthMask(GL_TRUE);
-			glDepthFunc(GL_LESS);
-			glDisable(GL_BLEND);
+			bonobo::gl_state::bindSampler(2u, 0u);
+			bonobo::gl_state::bindSampler(1u, 0u);
+			bonobo::gl_state::bindSampler(0u, 0u);
+
+			bonobo::gl_state::depthMask(GL_TRUE);
+			bonobo::gl_state::depthFunc(GL_LESS);
+			bonobo::gl_state::setEnabled(GL_BLEND, false);
 		}
 
 
-		glCullFace(GL_BACK);
-		glDepthFunc(GL_ALWAYS);
+		bonobo::gl_state::cullFace(GL_BACK);
+		bonobo::gl_state::depthFunc(GL_ALWAYS);
 		//
 		// Pass 3: Compute final image using both the g-buffer and  the light accumulation buffer
 		//
-		glBindFramebuffer(GL_FRAMEBUFFER, 0u);
-		glUseProgram(resolve_deferred_shader);
+		bonobo::gl_state::bindFramebuffer(0u);
+		bonobo::gl_state::useProgram(resolve_deferred_shader);
 		glViewport(0, 0, window_size.x, window_size.y);
 		// XXX: Is any clearing needed?
 
-		bind_texture_with_sampler(GL_TEXTURE_2D, 0, resolve_deferred_shader, "diffuse_texture", diffuse_texture, default_sampler);
-		bind_texture_with_sampler(GL_TEXTURE_2D, 1, resolve_deferred_shader, "specular_texture", specular_texture, default_sampler);
-		bind_texture_with_sampler(GL_TEXTURE_2D, 2, resolve_deferred_shader, "light_d_texture", light_diffuse_contribution_texture, default_sampler);
-		bind_texture_with_sampler(GL_TEXTURE_2D, 3, resolve_deferred_shader, "light_s_texture", light_specular_contribution_texture, default_sampler);
+		bind_texture_with_sampler(GL_TEXTURE_2D, 0, resolve_deferred_shader, uniforms::diffuse_texture, diffuse_texture, default_sampler);
+		bind_texture_with_sampler(GL_TEXTURE_2D, 1, resolve_deferred_shader, uniforms::specular_texture, specular_texture, default_sampler);
+		bind_texture_with_sampler(GL_TEXTURE_2D, 2, resolve_deferred_shader, uniforms::light_d_texture, light_diffuse_contribution_texture, default_sampler);
+		bind_texture_with_sampler(GL_TEXTURE_2D, 3, resolve_deferred_shader, uniforms::light_s_texture, light_specular_contribution_texture, default_sampler);
 
 		GLStateInspection::CaptureSnapshot("Resolve Pass");
+		gpu_profiler.begin_section("Resolve Pass");
+		PROFILE_BEGIN("Resolve Pass");
 
 		bonobo::drawFullscreen();
 
-		glBindSampler(3, 0u);
-		glBindSampler(2, 0u);
-		glBindSampler(1, 0u);
-		glBindSampler(0, 0u);
-		glUseProgram(0u);
+		PROFILE_END();
+		gpu_profiler.end_section();
+
+		bonobo::gl_state::bindSampler(3u, 0u);
+		bonobo::gl_state::bindSampler(2u, 0u);
+		bonobo::gl_state::bindSampler(1u, 0u);
+		bonobo::gl_state::bindSampler(0u, 0u);
 
 
 		//
@@ -423,31 +567,51 @@ edan35::Assignment2::run()
 		Log::View::Render();
 
 		bool opened = ImGui::Begin("Render Time", nullptr, ImVec2(120, 50), -1.0f, 0);
-		if (opened)
+		if (opened) {
 			ImGui::Text("%.3f ms", ddeltatime);
+			auto const& gl_stats = bonobo::gl_state::getLastFrameStats();
+			auto const& queue_stats = render_queue.get_last_frame_stats();
+			ImGui::Text("Draws: %zu, state changes: %zu (%zu saved by sorting)",
+			            queue_stats.draws_nb, queue_stats.state_changes, queue_stats.saved_changes());
+			ImGui::Checkbox("Merge draws", &merge_draws);
+			ImGui::Text("Draw calls: %zu, submitted in %.3f ms", queue_stats.calls_nb, queue_stats.submission_ms);
+			ImGui::Text("Culling: g-buffer %zu visible / %zu culled, shadow maps %zu visible / %zu culled",
+			            gbuffer_culling.visible_nb, gbuffer_culling.culled_nb,
+			            shadowmap_culling.visible_nb, shadowmap_culling.culled_nb);
+			ImGui::Text("LOD: %zu / %zu meshes coarser, %zu / %zu triangles",
+			            lod_stats.coarser_nodes_nb, lod_stats.nodes_nb,
+			            lod_stats.selected_indices_nb / 3u, lod_stats.full_indices_nb / 3u);
+			bonobo::bvh::ray_hit aimed_at;
+			if (sponza_bvh.raycast(mCamera.mWorld.GetTranslation(), mCamera.mWorld.GetFront(), mCamera.mFar, aimed_at))
+				ImGui::Text("Aiming at mesh #%u, %.1f units away", aimed_at.primitive, aimed_at.distance);
+			ImGui::Text("GL state calls: %zu issued, %zu skipped", gl_stats.total_issued(), gl_stats.total_skipped());
+			for (unsigned int i = 0u; i < static_cast<unsigned int>(bonobo::gl_state::call::count); ++i)
+				ImGui::Text("  %-15s %6zu / %6zu", bonobo::gl_state::getCallName(static_cast<bonobo::gl_state::call>(i)),
+				            gl_stats.issued[i], gl_stats.skipped[i]);
+		}
 		ImGui::End();
 
+		gpu_profiler.show("gpu_timings.csv");
+		Profiler::View::Render();
+
+		window->CaptureScene();
 		ImGui::Render();
+		gpu_profiler.end_frame();
 
 		window->Swap();
+		benchmark.end_frame();
 		lastTime = nowTime;
 	}
 
-	glDeleteProgram(resolve_deferred_shader);
-	resolve_deferred_shader = 0u;
-	glDeleteProgram(accumulate_lights_shader);
-	accumulate_lights_shader = 0u;
-	glDeleteProgram(fill_shadowmap_shader);
-	fill_shadowmap_shader = 0u;
-	glDeleteProgram(fill_gbuffer_shader);
-	fill_gbuffer_shader = 0u;
 	glDeleteProgram(fallback_shader);
 	fallback_shader = 0u;
+
+	bonobo::releaseObjectTextures(sponza_geometry);
 }
 
-int main()
+int main(int argc, char* argv[])
 {
-	Bonobo::Init();
+	Bonobo::Init(argc, argv);
 	try {
 		edan35::Assignment2 assignment2;
 		assignment2.run();
@@ -464,6 +628,7 @@ loadCone()
 	bonobo::mesh_data cone;
 	cone.vertices_nb = 65;
 	cone.drawing_mode = GL_TRIANGLE_STRIP;
+	cone.attributes = 1u << static_cast<unsigned int>(bonobo::shader_bindings::vertices);
 	float vertexArrayData[65 * 3] = {
 		0.f, 1.f, -1.f,
 		0.f, 0.f, 0.f,
@@ -547,6 +712,8 @@ loadCone()
 		glBindBuffer(GL_ARRAY_BUFFER, 0u);
 	}
 	glBindVertexArray(0u);
+	bonobo::gl_state::invalidate();
+	bonobo::computeBounds(reinterpret_cast<glm::vec3 const*>(vertexArrayData), cone.vertices_nb, cone.bounds, cone.sphere);
 
 	return cone;
 }
@@ -2,13 +2,61 @@
 #include "Log.h"
 #include "Window.h"
 
-void Bonobo::Init()
+#include <cstdlib>
+#include <cstring>
+
+static Bonobo::Options options = { false, 0u, "", "benchmark", 60u, 1000.0 / 60.0, "", "", "" };
+
+static void ParseOptions(int argc, char const* const* argv)
+{
+	if (auto const headless = std::getenv("LUGGCGL_HEADLESS"))
+		options.headless = std::strcmp(headless, "0") != 0;
+	if (auto const frames_nb = std::getenv("LUGGCGL_FRAMES"))
+		options.frames_nb = static_cast<unsigned int>(std::strtoul(frames_nb, nullptr, 10));
+	if (auto const benchmark_path = std::getenv("LUGGCGL_BENCHMARK"))
+		options.benchmark_path = benchmark_path;
+	if (auto const replay_path = std::getenv("LUGGCGL_REPLAY"))
+		options.replay_path = replay_path;
+	if (auto const capture_prefix = std::getenv("LUGGCGL_CAPTURE"))
+		options.capture_prefix = capture_prefix;
+
+	for (int i = 1; i < argc; ++i) {
+		auto const has_value = i + 1 < argc;
+		if (std::strcmp(argv[i], "--headless") == 0)
+			options.headless = true;
+		else if (std::strcmp(argv[i], "--frames") == 0 && has_value)
+			options.frames_nb = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(argv[i], "--benchmark") == 0 && has_value)
+			options.benchmark_path = argv[++i];
+		else if (std::strcmp(argv[i], "--benchmark-output") == 0 && has_value)
+			options.benchmark_output = argv[++i];
+		else if (std::strcmp(argv[i], "--warmup") == 0 && has_value)
+			options.warmup_frames_nb = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+		else if (std::strcmp(argv[i], "--timestep") == 0 && has_value)
+			options.timestep_ms = std::strtod(argv[++i], nullptr);
+		else if (std::strcmp(argv[i], "--record") == 0 && has_value)
+			options.record_path = argv[++i];
+		else if (std::strcmp(argv[i], "--replay") == 0 && has_value)
+			options.replay_path = argv[++i];
+		else if (std::strcmp(argv[i], "--capture") == 0 && has_value)
+			options.capture_prefix = argv[++i];
+		else
+			LogWarning("Ignoring unknown option \"%s\"", argv[i]);
+	}
+}
+
+void Bonobo::Init(int argc, char const* const* argv)
 {
 	Log::Init();
 	LogInfo("Running Bonobo v0.2");
 
+	ParseOptions(argc, argv);
+
+	// When benchmarking, the frame count only covers measured frames, and
+	// the benchmark ends the run itself.
 	LogInfo("Initiating window management system...");
-	Window::Init();
+	auto const benchmarking = !options.benchmark_path.empty() || !options.replay_path.empty();
+	Window::Init(options.headless, benchmarking ? 0u : options.frames_nb);
 
 	LogInfo("Done");
 }
@@ -19,3 +67,7 @@ void Bonobo::Destroy()
 	Log::Destroy();
 }
 
+Bonobo::Options const &Bonobo::GetOptions()
+{
+	return options;
+}
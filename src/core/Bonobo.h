@@ -1,7 +1,43 @@
 #pragma once
 
+#include <string>
+
 class Bonobo {
 public:
-	static void Init();
+	//! \brief Settings given on the command line, or through environment
+	//!        variables for the ones listed.
+	struct Options {
+		//! `--headless` or `LUGGCGL_HEADLESS=1`: render offscreen,
+		//! see `Window::Init()`
+		bool headless;
+		//! `--frames <n>` or `LUGGCGL_FRAMES=<n>`: number of frames to
+		//! render before closing, or to measure when benchmarking; 0 for
+		//! no limit
+		unsigned int frames_nb;
+		//! `--benchmark <path>` or `LUGGCGL_BENCHMARK=<path>`: camera
+		//! path to follow in benchmark mode, see `bonobo::benchmark`;
+		//! vsync is then disabled, as it is when replaying inputs
+		std::string benchmark_path;
+		//! `--benchmark-output <prefix>`: results are written to
+		//! `<prefix>.csv` and `<prefix>.json`
+		std::string benchmark_output;
+		//! `--warmup <n>`: frames rendered before measuring
+		unsigned int warmup_frames_nb;
+		//! `--timestep <ms>`: simulated time between two frames
+		double timestep_ms;
+		//! `--record <path>`: inputs are recorded to this file, see
+		//! `InputHandler::StartRecording()`
+		std::string record_path;
+		//! `--replay <path>` or `LUGGCGL_REPLAY=<path>`: inputs are
+		//! replayed from this file, and the run is benchmarked
+		std::string replay_path;
+		//! `--capture <prefix>` or `LUGGCGL_CAPTURE=<prefix>`: every
+		//! frame is saved as a PNG file, without the UI, see
+		//! `bonobo::frame_capture` and `Window::CaptureScene()`
+		std::string capture_prefix;
+	};
+public:
+	static void Init(int argc = 0, char const* const* argv = nullptr);
 	static void Destroy();
+	static Options const &GetOptions();
 };
@@ -1,10 +1,13 @@
 #pragma once
 
+#include "bounds.hpp"
+#include "lod.hpp"
 #include "TRSTransform.h"
 #include "InputHandler.h"
 
 #include <glm/glm.hpp>
 
+#include <cmath>
 #include <iostream>
 
 template<typename T, glm::precision P>
@@ -29,6 +32,15 @@ public:
 	glm::tmat4x4<T, P> GetClipToViewMatrix();
 	glm::tmat4x4<T, P> GetViewToClipMatrix();
 
+	//! \brief World-space planes of the view frustum, for culling.
+	bonobo::frustum GetFrustum();
+
+	//! \brief Camera data for picking levels of detail, tolerating an
+	//!        error of one pixel.
+	//!
+	//! @param [in] viewport_height height in pixels of the area rendered to
+	bonobo::lod_view GetLodView(T viewport_height);
+
 	glm::tvec3<T, P> GetClipToWorld(glm::tvec3<T, P> xyw);
 	glm::tvec3<T, P> GetClipToView(glm::tvec3<T, P> xyw);
 
@@ -115,6 +115,21 @@ glm::tmat4x4<T, P> FPSCamera<T, P>::GetViewToClipMatrix()
 	return mProjection;
 }
 
+template<typename T, glm::precision P>
+bonobo::frustum FPSCamera<T, P>::GetFrustum()
+{
+	return bonobo::extractFrustum(glm::mat4(GetWorldToClipMatrix()));
+}
+
+template<typename T, glm::precision P>
+bonobo::lod_view FPSCamera<T, P>::GetLodView(T viewport_height)
+{
+	bonobo::lod_view view;
+	view.position = glm::vec3(mWorld.GetTranslation());
+	view.pixels_per_unit = static_cast<float>(viewport_height / (static_cast<T>(2) * std::tan(mFov / static_cast<T>(2))));
+	return view;
+}
+
 template<typename T, glm::precision P>
 glm::tvec3<T, P> FPSCamera<T, P>::GetClipToWorld(glm::tvec3<T, P> xyw)
 {
@@ -1,19 +1,294 @@
 #include "InputHandler.h"
+#include "Bonobo.h"
 #include "Log.h"
 
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
 /*----------------------------------------------------------------------------*/
 
-InputHandler::InputHandler()
+/*
+ * Recordings start with a header: "BINP", the format version as a u32 and
+ * the number of ticks recorded as a u64, all little-endian. Each event
+ * then takes the number of ticks since the previous event as a varint,
+ * its type as a byte, and its parameters:
+ *   EVENT_KEY:          key and scancode as zigzag varints, action and mods
+ *                       as bytes;
+ *   EVENT_MOUSE_BUTTON: button, action and mods as bytes;
+ *   EVENT_MOUSE_MOTION: x and y as f32;
+ *   EVENT_UI_CAPTURE:   a byte, bit 0 for the mouse and 1 for the keyboard.
+ * An EVENT_END closes the recording.
+ */
+namespace local
+{
+	static char const recordMagic[4] = { 'B', 'I', 'N', 'P' };
+	static u32 const recordVersion = 1u;
+	static size_t const recordHeaderSize = sizeof(recordMagic) + sizeof(u32) + sizeof(u64);
+
+	enum EventType : u8 {
+		EVENT_KEY = 0u,
+		EVENT_MOUSE_BUTTON = 1u,
+		EVENT_MOUSE_MOTION = 2u,
+		EVENT_UI_CAPTURE = 3u,
+		EVENT_END = 0xFFu
+	};
+
+	static void WriteVarint(std::vector<u8> &out, u64 value)
+	{
+		while (value >= 0x80u) {
+			out.push_back(static_cast<u8>(value | 0x80u));
+			value >>= 7;
+		}
+		out.push_back(static_cast<u8>(value));
+	}
+
+	static void WriteSigned(std::vector<u8> &out, int value)
+	{
+		auto const v = static_cast<i64>(value);
+		WriteVarint(out, (static_cast<u64>(v) << 1) ^ static_cast<u64>(v >> 63));
+	}
+
+	template<typename T>
+	static void WriteRaw(std::vector<u8> &out, T value)
+	{
+		u8 bytes[sizeof(T)];
+		std::memcpy(bytes, &value, sizeof(T));
+		out.insert(out.end(), bytes, bytes + sizeof(T));
+	}
+
+	// Readers return false when running past the end of the data.
+	static bool ReadVarint(std::vector<u8> const &in, size_t &cursor, u64 &value)
+	{
+		value = 0u;
+		for (u32 shift = 0u; cursor < in.size() && shift < 64u; shift += 7u) {
+			auto const byte = in[cursor++];
+			value |= static_cast<u64>(byte & 0x7Fu) << shift;
+			if ((byte & 0x80u) == 0u)
+				return true;
+		}
+		return false;
+	}
+
+	static bool ReadSigned(std::vector<u8> const &in, size_t &cursor, int &value)
+	{
+		u64 v;
+		if (!ReadVarint(in, cursor, v))
+			return false;
+		value = static_cast<int>(static_cast<i64>(v >> 1) ^ -static_cast<i64>(v & 1u));
+		return true;
+	}
+
+	template<typename T>
+	static bool ReadRaw(std::vector<u8> const &in, size_t &cursor, T &value)
+	{
+		if (in.size() - cursor < sizeof(T))
+			return false;
+		std::memcpy(&value, in.data() + cursor, sizeof(T));
+		cursor += sizeof(T);
+		return true;
+	}
+}
+
+InputHandler::InputHandler() : mMousePosition(0.0f), mTick(0u), mRecording(false), mRecordStartTick(0u), mRecordLastTick(0u), mReplaying(false), mFeedingReplay(false), mReplayCursor(0u), mReplayStartTick(0u), mReplayNextTick(0u), mReplayTicksNb(0u)
 {
 	mMouseCapturedByUI = false;
 	mKeyboardCapturedByUI = false;
+
+	auto const &options = Bonobo::GetOptions();
+	if (!options.replay_path.empty())
+		StartReplay(options.replay_path);
+	if (!options.record_path.empty())
+		StartRecording(options.record_path);
+}
+
+InputHandler::~InputHandler()
+{
+	if (mRecording)
+		StopRecording();
 }
 
 void InputHandler::Advance()
 {
+	// Live events arrive between two calls, so replayed ones are fed at
+	// the same point.
+	if (mReplaying)
+		FeedReplay();
 	mTick++;
 }
 
+void InputHandler::RecordEvent(u8 type)
+{
+	auto const tick = mTick - mRecordStartTick;
+	local::WriteVarint(mRecord, tick - mRecordLastTick);
+	mRecord.push_back(type);
+	mRecordLastTick = tick;
+}
+
+void InputHandler::StartRecording(std::string const &path)
+{
+	mRecording = true;
+	mRecordPath = path;
+	mRecord.clear();
+	mRecordStartTick = mTick;
+	mRecordLastTick = 0u;
+	// The current UI capture state is part of the starting conditions.
+	RecordEvent(local::EVENT_UI_CAPTURE);
+	mRecord.push_back(static_cast<u8>((mMouseCapturedByUI ? 1u : 0u) | (mKeyboardCapturedByUI ? 2u : 0u)));
+	LogInfo("Recording inputs to \"%s\"", path.c_str());
+}
+
+bool InputHandler::StopRecording()
+{
+	if (!mRecording)
+		return false;
+	mRecording = false;
+	RecordEvent(local::EVENT_END);
+
+	std::vector<u8> header;
+	header.insert(header.end(), local::recordMagic, local::recordMagic + sizeof(local::recordMagic));
+	local::WriteRaw(header, local::recordVersion);
+	local::WriteRaw(header, static_cast<u64>(mTick - mRecordStartTick));
+
+	std::ofstream file(mRecordPath, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		LogWarning("Could not create \"%s\"", mRecordPath.c_str());
+		return false;
+	}
+	file.write(reinterpret_cast<char const *>(header.data()), static_cast<std::streamsize>(header.size()));
+	file.write(reinterpret_cast<char const *>(mRecord.data()), static_cast<std::streamsize>(mRecord.size()));
+	if (!file.good()) {
+		LogWarning("Failed to write \"%s\"", mRecordPath.c_str());
+		return false;
+	}
+	LogInfo("Recorded %llu ticks of inputs to \"%s\" (%zu bytes)", static_cast<unsigned long long>(mTick - mRecordStartTick),
+	        mRecordPath.c_str(), header.size() + mRecord.size());
+	mRecord.clear();
+	return true;
+}
+
+bool InputHandler::StartReplay(std::string const &path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		LogError("Could not open \"%s\"", path.c_str());
+		return false;
+	}
+	mReplay.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+	u32 version = 0u;
+	mReplayCursor = sizeof(local::recordMagic);
+	u64 delta = 0u;
+	if (mReplay.size() < local::recordHeaderSize
+	    || std::memcmp(mReplay.data(), local::recordMagic, sizeof(local::recordMagic)) != 0
+	    || !local::ReadRaw(mReplay, mReplayCursor, version) || version != local::recordVersion
+	    || !local::ReadRaw(mReplay, mReplayCursor, mReplayTicksNb)
+	    || !local::ReadVarint(mReplay, mReplayCursor, delta)) {
+		LogError("\"%s\" is not an input recording, or was made by another version", path.c_str());
+		mReplay.clear();
+		return false;
+	}
+
+	mReplaying = true;
+	mReplayStartTick = mTick;
+	mReplayNextTick = delta;
+	LogInfo("Replaying %llu ticks of inputs from \"%s\"", static_cast<unsigned long long>(mReplayTicksNb), path.c_str());
+	return true;
+}
+
+void InputHandler::FeedReplay()
+{
+	auto const tick = mTick - mReplayStartTick;
+	mFeedingReplay = true;
+	while (mReplaying && mReplayNextTick <= tick) {
+		auto ok = mReplayCursor < mReplay.size();
+		auto const type = ok ? mReplay[mReplayCursor++] : static_cast<u8>(local::EVENT_END);
+		if (type == local::EVENT_END) {
+			if (ok)
+				LogInfo("Input replay finished");
+			else
+				LogError("Input replay ended unexpectedly");
+			mReplaying = false;
+			break;
+		}
+
+		switch (type) {
+			case local::EVENT_KEY: {
+				int key = 0, scancode = 0;
+				u8 action = 0u, mods = 0u;
+				ok = local::ReadSigned(mReplay, mReplayCursor, key) && local::ReadSigned(mReplay, mReplayCursor, scancode)
+				  && local::ReadRaw(mReplay, mReplayCursor, action) && local::ReadRaw(mReplay, mReplayCursor, mods);
+				if (ok)
+					FeedKeyboard(key, scancode, action, mods);
+				break;
+			}
+			case local::EVENT_MOUSE_BUTTON: {
+				u8 button = 0u, action = 0u, mods = 0u;
+				ok = local::ReadRaw(mReplay, mReplayCursor, button) && local::ReadRaw(mReplay, mReplayCursor, action)
+				  && local::ReadRaw(mReplay, mReplayCursor, mods);
+				if (ok)
+					FeedMouseButtons(button, action, mods);
+				break;
+			}
+			case local::EVENT_MOUSE_MOTION: {
+				f32 x = 0.0f, y = 0.0f;
+				ok = local::ReadRaw(mReplay, mReplayCursor, x) && local::ReadRaw(mReplay, mReplayCursor, y);
+				if (ok)
+					FeedMouseMotion(glm::vec2(x, y));
+				break;
+			}
+			case local::EVENT_UI_CAPTURE: {
+				u8 capture = 0u;
+				ok = local::ReadRaw(mReplay, mReplayCursor, capture);
+				if (ok)
+					SetUICapture((capture & 1u) != 0u, (capture & 2u) != 0u);
+				break;
+			}
+			default:
+				ok = false;
+				break;
+		}
+
+		u64 delta = 0u;
+		if (!ok || !local::ReadVarint(mReplay, mReplayCursor, delta)) {
+			LogError("Input replay is corrupted at byte %zu: stopping it", mReplayCursor);
+			mReplaying = false;
+			break;
+		}
+		mReplayNextTick += delta;
+	}
+	mFeedingReplay = false;
+	if (!mReplaying)
+		mReplay.clear();
+}
+
+bool InputHandler::IsReplaying() const
+{
+	return mReplaying;
+}
+
+u64 InputHandler::GetReplayTicksNb() const
+{
+	return mReplayTicksNb;
+}
+
+u64 InputHandler::GetRecordingTicksNb(std::string const &path)
+{
+	std::ifstream file(path, std::ios::binary);
+	std::vector<u8> header(local::recordHeaderSize);
+	if (!file.read(reinterpret_cast<char *>(header.data()), static_cast<std::streamsize>(header.size()))
+	    || std::memcmp(header.data(), local::recordMagic, sizeof(local::recordMagic)) != 0)
+		return 0u;
+
+	size_t cursor = sizeof(local::recordMagic);
+	u32 version = 0u;
+	u64 ticksNb = 0u;
+	if (!local::ReadRaw(header, cursor, version) || version != local::recordVersion
+	    || !local::ReadRaw(header, cursor, ticksNb))
+		return 0u;
+	return ticksNb;
+}
+
 void InputHandler::DownEvent(std::unordered_map<size_t, IState> &map, size_t loc)
 {
 	auto sc = map.find(loc);
@@ -56,6 +331,16 @@ void InputHandler::UpModEvent(std::unordered_map<size_t, IState> &map, u32 mods)
 
 void InputHandler::FeedKeyboard(int key, int scancode, int action, int mods)
 {
+	if (mReplaying && !mFeedingReplay)
+		return;
+	if (mRecording) {
+		RecordEvent(local::EVENT_KEY);
+		local::WriteSigned(mRecord, key);
+		local::WriteSigned(mRecord, scancode);
+		mRecord.push_back(static_cast<u8>(action));
+		mRecord.push_back(static_cast<u8>(mods));
+	}
+
 	switch (action)
 	{
 		case GLFW_PRESS:
@@ -77,11 +362,28 @@ void InputHandler::FeedKeyboard(int key, int scancode, int action, int mods)
 
 void InputHandler::FeedMouseMotion(glm::vec2 const& position)
 {
-  mMousePosition = position;
+	if (mReplaying && !mFeedingReplay)
+		return;
+	if (mRecording) {
+		RecordEvent(local::EVENT_MOUSE_MOTION);
+		local::WriteRaw(mRecord, static_cast<f32>(position.x));
+		local::WriteRaw(mRecord, static_cast<f32>(position.y));
+	}
+
+	mMousePosition = position;
 }
 
 void InputHandler::FeedMouseButtons(int button, int action, int mods)
 {
+	if (mReplaying && !mFeedingReplay)
+		return;
+	if (mRecording) {
+		RecordEvent(local::EVENT_MOUSE_BUTTON);
+		mRecord.push_back(static_cast<u8>(button));
+		mRecord.push_back(static_cast<u8>(action));
+		mRecord.push_back(static_cast<u8>(mods));
+	}
+
 	switch (action)
 	{
 		case GLFW_PRESS:
@@ -147,6 +449,15 @@ bool InputHandler::IsKeyboardCapturedByUI() const
 
 void InputHandler::SetUICapture(bool mouseCapture, bool keyboardCapture)
 {
+	// The UI is fed live inputs only, so its capture state is recorded and
+	// replayed along with them.
+	if (mReplaying && !mFeedingReplay)
+		return;
+	if (mRecording && (mouseCapture != mMouseCapturedByUI || keyboardCapture != mKeyboardCapturedByUI)) {
+		RecordEvent(local::EVENT_UI_CAPTURE);
+		mRecord.push_back(static_cast<u8>((mouseCapture ? 1u : 0u) | (keyboardCapture ? 2u : 0u)));
+	}
+
 	mMouseCapturedByUI = mouseCapture;
 	mKeyboardCapturedByUI = keyboardCapture;
 }
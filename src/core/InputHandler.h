@@ -2,7 +2,9 @@
 
 #include "Types.h"
 
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <GLFW/glfw3.h>
 #include <glm/vec2.hpp>
@@ -27,7 +29,10 @@ public:
 	};
 
 public:
+	//! \brief Starts recording or replaying if asked to on the command
+	//!        line, see `Bonobo::Options`.
 	InputHandler();
+	~InputHandler();
 
 public:
 	void FeedKeyboard(int key, int scancode, int action, int mods);
@@ -43,6 +48,22 @@ public:
 	bool IsKeyboardCapturedByUI() const;
 	void SetUICapture(bool mouseCapture, bool keyboardCapture);
 
+	//! \brief Record all events fed from now on, tagged with their tick,
+	//!        to be written to `path` by `StopRecording()`.
+	void StartRecording(std::string const &path);
+	//! \brief Write the events recorded so far; also done on destruction.
+	bool StopRecording();
+	//! \brief Feed the events recorded in `path` back, at the same ticks
+	//!        relative to now, ignoring all live events until the end of
+	//!        the recording.
+	bool StartReplay(std::string const &path);
+	bool IsReplaying() const;
+	//! \brief Number of ticks covered by the recording being replayed.
+	u64 GetReplayTicksNb() const;
+	//! \brief Number of ticks covered by the recording in `path`, or 0 if
+	//!        it can not be read.
+	static u64 GetRecordingTicksNb(std::string const &path);
+
 private:
 	void DownEvent(std::unordered_map<size_t, IState> &map, size_t loc);
 	void DownModEvent(std::unordered_map<size_t, IState> &map, u32 mods);
@@ -63,5 +84,23 @@ private:
 
 	u64 mTick;
 
+	// Events are stored as a type, the number of ticks since the previous
+	// event, and the event's parameters, see InputHandler.cpp.
+	bool mRecording;
+	std::string mRecordPath;
+	std::vector<u8> mRecord;
+	u64 mRecordStartTick;
+	u64 mRecordLastTick;
+
+	bool mReplaying;
+	bool mFeedingReplay;
+	std::vector<u8> mReplay;
+	size_t mReplayCursor;
+	u64 mReplayStartTick;
+	u64 mReplayNextTick;
+	u64 mReplayTicksNb;
+
+	void RecordEvent(u8 type);
+	void FeedReplay();
 };
 
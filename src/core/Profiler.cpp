@@ -0,0 +1,193 @@
+#include "Profiler.h"
+
+#include "Log.h"
+#include "Misc.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+namespace local
+{
+	// Events kept per thread; older ones get overwritten. Must be a power
+	// of two.
+	constexpr u64 bufferCapacity = 1u << 16;
+	constexpr u32 maxDepth = 64u;
+
+	// Written by its own thread only, without locking; other threads read
+	// the events up to `written`, which is published last.
+	struct ThreadBuffer {
+		u32 thread;
+		std::unique_ptr<Profiler::Event[]> events;
+		std::atomic<u64> written;
+
+		// Only used by the owning thread
+		char const *openNames[maxDepth];
+		u64 openStarts[maxDepth];
+		u32 depth;
+
+		// Only used by the thread calling NewFrame()
+		u64 gathered;
+	};
+
+	static std::mutex buffersMutex;
+	static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	static thread_local ThreadBuffer *threadBuffer = nullptr;
+
+	static auto const epoch = StartTimer();
+
+	static std::vector<Profiler::ThreadEvents> lastFrame;
+	static u64 lastFrameStart = 0u;
+	static u64 lastFrameEnd = 0u;
+
+	static u64 Now()
+	{
+		return EndTimerNanoseconds(epoch);
+	}
+
+	static ThreadBuffer &GetThreadBuffer()
+	{
+		if (threadBuffer == nullptr) {
+			// Only taken once per thread.
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			auto buffer = std::make_unique<ThreadBuffer>();
+			buffer->thread = static_cast<u32>(buffers.size());
+			buffer->events = std::make_unique<Profiler::Event[]>(bufferCapacity);
+			buffer->written = 0u;
+			buffer->depth = 0u;
+			buffer->gathered = 0u;
+			threadBuffer = buffer.get();
+			buffers.push_back(std::move(buffer));
+		}
+		return *threadBuffer;
+	}
+
+	static std::vector<ThreadBuffer *> GetBuffers()
+	{
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		std::vector<ThreadBuffer *> list;
+		for (auto const &buffer : buffers)
+			list.push_back(buffer.get());
+		return list;
+	}
+
+	// Copy the events written since `from`, and return the index to read
+	// from next time.
+	static u64 Read(ThreadBuffer &buffer, u64 from, std::vector<Profiler::Event> &out)
+	{
+		auto const written = buffer.written.load(std::memory_order_acquire);
+		auto const begin = std::max(from, written > bufferCapacity ? written - bufferCapacity : 0u);
+		auto const first = out.size();
+		for (auto i = begin; i < written; ++i)
+			out.push_back(buffer.events[i & (bufferCapacity - 1u)]);
+
+		// The owning thread may have wrapped around, and overwritten some
+		// of the oldest events while they were being copied; the event at
+		// `after - bufferCapacity` shares its slot with the one possibly
+		// being written at `after`, so it is dropped as well.
+		auto const after = buffer.written.load(std::memory_order_acquire);
+		if (after >= bufferCapacity && after - bufferCapacity >= begin) {
+			auto const overwritten = std::min<u64>(after - bufferCapacity + 1u - begin, out.size() - first);
+			out.erase(out.begin() + static_cast<std::ptrdiff_t>(first),
+			          out.begin() + static_cast<std::ptrdiff_t>(first + overwritten));
+		}
+		return written;
+	}
+
+	static void WriteEscaped(std::ostream &os, char const *string)
+	{
+		for (; *string != '\0'; ++string) {
+			if (*string == '"' || *string == '\\')
+				os << '\\';
+			os << *string;
+		}
+	}
+}
+
+void Profiler::BeginScope(char const *name)
+{
+	auto &buffer = local::GetThreadBuffer();
+	if (buffer.depth < local::maxDepth) {
+		buffer.openNames[buffer.depth] = name;
+		buffer.openStarts[buffer.depth] = local::Now();
+	}
+	++buffer.depth;
+}
+
+void Profiler::EndScope()
+{
+	auto &buffer = local::GetThreadBuffer();
+	if (buffer.depth == 0u)
+		return;
+	--buffer.depth;
+	if (buffer.depth >= local::maxDepth)
+		return;
+
+	auto const index = buffer.written.load(std::memory_order_relaxed);
+	auto &event = buffer.events[index & (local::bufferCapacity - 1u)];
+	event.name = buffer.openNames[buffer.depth];
+	event.start = buffer.openStarts[buffer.depth];
+	event.end = local::Now();
+	event.depth = buffer.depth;
+	buffer.written.store(index + 1u, std::memory_order_release);
+}
+
+void Profiler::NewFrame()
+{
+	auto const now = local::Now();
+	local::lastFrame.clear();
+	for (auto buffer : local::GetBuffers()) {
+		ThreadEvents thread;
+		thread.thread = buffer->thread;
+		buffer->gathered = local::Read(*buffer, buffer->gathered, thread.events);
+		if (!thread.events.empty())
+			local::lastFrame.push_back(std::move(thread));
+	}
+	local::lastFrameStart = local::lastFrameEnd;
+	local::lastFrameEnd = now;
+}
+
+std::vector<Profiler::ThreadEvents> const &Profiler::GetLastFrame(u64 &frameStart, u64 &frameEnd)
+{
+	frameStart = local::lastFrameStart;
+	frameEnd = local::lastFrameEnd;
+	return local::lastFrame;
+}
+
+bool Profiler::WriteChromeTrace(std::string const &path)
+{
+	std::ofstream file(path, std::ios::trunc);
+	if (!file.is_open()) {
+		LogWarning("Could not create \"%s\"", path.c_str());
+		return false;
+	}
+
+	// Timestamps are in microseconds; keep nanosecond precision.
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	auto first = true;
+	std::vector<Event> events;
+	for (auto buffer : local::GetBuffers()) {
+		events.clear();
+		local::Read(*buffer, 0u, events);
+		for (auto const &event : events) {
+			file << (first ? "\n" : ",\n") << "{\"name\":\"";
+			local::WriteEscaped(file, event.name);
+			file << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->thread
+			     << ",\"ts\":" << static_cast<double>(event.start) * 0.001
+			     << ",\"dur\":" << static_cast<double>(event.end - event.start) * 0.001 << "}";
+			first = false;
+		}
+	}
+	file << "\n]}\n";
+
+	if (!file.good()) {
+		LogWarning("Failed to write \"%s\"", path.c_str());
+		return false;
+	}
+	LogInfo("CPU trace written to \"%s\"", path.c_str());
+	return true;
+}
@@ -0,0 +1,71 @@
+/*
+ * Hierarchical CPU profiler
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include "BuildSettings.h"
+#include "Types.h"
+
+namespace Profiler {
+
+//! \brief One timed scope, as recorded by the thread it ran on.
+struct Event {
+	char const *name;	//!< must outlive the profiler, typically a literal
+	u64 start;			//!< nanoseconds since the profiler started
+	u64 end;			//!< nanoseconds since the profiler started
+	u32 depth;			//!< number of scopes enclosing this one on its thread
+};
+
+//! \brief Events of one thread, as returned by `GetLastFrame()`.
+struct ThreadEvents {
+	u32 thread;			//!< index of the thread, in order of first event
+	std::vector<Event> events;
+};
+
+//! \brief Open a scope on the calling thread; prefer `PROFILE_SCOPE()`.
+void BeginScope(char const *name);
+
+//! \brief Close the innermost scope opened by the calling thread.
+void EndScope();
+
+//! \brief Mark the start of a new frame, gathering the events of all
+//!        threads which ended during the previous one; to be called from
+//!        the main thread.
+void NewFrame();
+
+//! \brief Events gathered by the last `NewFrame()`, along with the time
+//!        span of that frame.
+std::vector<ThreadEvents> const &GetLastFrame(u64 &frameStart, u64 &frameEnd);
+
+//! \brief Write all events still held by the per-thread buffers in the
+//!        Chrome trace event format, for chrome://tracing or Perfetto.
+bool WriteChromeTrace(std::string const &path);
+
+//! \brief Opens a scope for its own lifetime.
+class Scope {
+public:
+	explicit Scope(char const *name) { BeginScope(name); }
+	~Scope() { EndScope(); }
+	Scope(Scope const &) = delete;
+	Scope &operator=(Scope const &) = delete;
+};
+
+};
+
+#if defined ENABLE_PROFILING && ENABLE_PROFILING != 0
+	#define PROFILE_CONCATENATE_(a, b)	a##b
+	#define PROFILE_CONCATENATE(a, b)	PROFILE_CONCATENATE_(a, b)
+	#define PROFILE_SCOPE(name)			Profiler::Scope PROFILE_CONCATENATE(profilerScope, __LINE__)(name)
+	#define PROFILE_FUNCTION()			PROFILE_SCOPE(__func__)
+	#define PROFILE_BEGIN(name)			Profiler::BeginScope(name)
+	#define PROFILE_END()				Profiler::EndScope()
+	#define PROFILE_NEW_FRAME()			Profiler::NewFrame()
+#else
+	#define PROFILE_SCOPE(name)
+	#define PROFILE_FUNCTION()
+	#define PROFILE_BEGIN(name)
+	#define PROFILE_END()
+	#define PROFILE_NEW_FRAME()
+#endif
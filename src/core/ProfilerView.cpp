@@ -0,0 +1,68 @@
+#include <algorithm>
+
+#include <imgui.h>
+
+#include "ProfilerView.h"
+
+namespace local
+{
+	static float const rowHeight = 18.0f;
+
+	static ImU32 ColorOf(char const *name)
+	{
+		// Same name, same colour, from one frame to the next.
+		u32 hash = 2166136261u;
+		for (; *name != '\0'; ++name)
+			hash = (hash ^ static_cast<u8>(*name)) * 16777619u;
+		return ImGui::ColorConvertFloat4ToU32(ImVec4(0.35f + 0.4f * static_cast<float>(hash & 0xffu) / 255.0f,
+		                                             0.35f + 0.4f * static_cast<float>((hash >> 8) & 0xffu) / 255.0f,
+		                                             0.35f + 0.4f * static_cast<float>((hash >> 16) & 0xffu) / 255.0f,
+		                                             1.0f));
+	}
+}
+
+void Profiler::View::Render()
+{
+	bool opened = ImGui::Begin("CPU Profiler", nullptr, ImVec2(600, 200), -1.0f, 0);
+	if (opened) {
+		u64 frameStart = 0u, frameEnd = 0u;
+		auto const &threads = Profiler::GetLastFrame(frameStart, frameEnd);
+		auto const frameDuration = frameEnd > frameStart ? frameEnd - frameStart : 1u;
+		ImGui::Text("Last frame: %.3f ms", static_cast<double>(frameDuration) * 0.000001);
+		ImGui::SameLine();
+		if (ImGui::Button("Save Chrome trace"))
+			Profiler::WriteChromeTrace("cpu_trace.json");
+
+		auto drawList = ImGui::GetWindowDrawList();
+		auto const width = std::max(ImGui::GetContentRegionAvailWidth(), 1.0f);
+		for (auto const &thread : threads) {
+			ImGui::Text("Thread %u", thread.thread);
+			u32 depthNb = 1u;
+			for (auto const &event : thread.events)
+				depthNb = std::max(depthNb, event.depth + 1u);
+
+			auto const origin = ImGui::GetCursorScreenPos();
+			for (auto const &event : thread.events) {
+				// Events straddling the start of the frame get clipped.
+				auto const start = std::max(event.start, frameStart);
+				if (event.end <= start)
+					continue;
+				auto const x0 = origin.x + width * static_cast<float>(start - frameStart) / static_cast<float>(frameDuration);
+				auto const x1 = origin.x + width * static_cast<float>(std::min(event.end, frameEnd) - frameStart) / static_cast<float>(frameDuration);
+				auto const y0 = origin.y + local::rowHeight * static_cast<float>(event.depth);
+				auto const min = ImVec2(x0, y0);
+				auto const max = ImVec2(std::max(x1, x0 + 1.0f), y0 + local::rowHeight - 1.0f);
+				drawList->AddRectFilled(min, max, local::ColorOf(event.name));
+				if (max.x - min.x > 30.0f) {
+					drawList->PushClipRect(min, max);
+					drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32(0, 0, 0, 255), event.name);
+					drawList->PopClipRect();
+				}
+				if (ImGui::IsMouseHoveringRect(min, max))
+					ImGui::SetTooltip("%s: %.3f ms", event.name, static_cast<double>(event.end - event.start) * 0.000001);
+			}
+			ImGui::Dummy(ImVec2(width, local::rowHeight * static_cast<float>(depthNb)));
+		}
+	}
+	ImGui::End();
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Profiler.h"
+
+namespace Profiler {
+
+class View {
+public:
+	//! \brief Show the scopes of the last frame as a flame graph, one
+	//!        lane per thread, along with a button saving a Chrome trace.
+	static void Render();
+};
+
+};
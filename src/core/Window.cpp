@@ -4,16 +4,39 @@
 #include <GLFW/glfw3.h>
 #include <imgui.h>
 
+#include "Bonobo.h"
+#include "frame_capture.hpp"
+#include "gl_state.hpp"
 #include "InputHandler.h"
 #include "Log.h"
+#include "Misc.h"
 #include "opengl.hpp"
 #include "Window.h"
 
 #include "external/imgui_impl_glfw_gl3.h"
 
+#if defined(LUGGCGL_HAS_EGL)
+#	include <EGL/egl.h>
+#	include <EGL/eglext.h>
+#endif
+
+#include <cstring>
+
 static std::unordered_map<std::string, Window *> *windowMap = nullptr;
 static int default_opengl_major_version = 4;
 static int default_opengl_minor_version = 1;
+static bool headless = false;
+static unsigned int max_frames_nb = 0u; // 0 for no limit
+static void (*imgui_render_draw_lists)(ImDrawData*) = nullptr;
+
+// ImGui draws GL_UNSIGNED_SHORT lists which can reference vertex 0xffff,
+// so primitive restart, left enabled by the last strip drawn through
+// `bonobo::gl_state`, has to go before the UI gets rendered.
+static void RenderImGuiDrawLists(ImDrawData* draw_data)
+{
+	bonobo::gl_state::setEnabled(GL_PRIMITIVE_RESTART, false);
+	imgui_render_draw_lists(draw_data);
+}
 
 void Window::ErrorCallback(int error, char const* description)
 {
@@ -83,7 +106,7 @@ Window *Window::Create(std::string mTitle, unsigned int w, unsigned int h, unsig
 		return nullptr;
 	}
 	Window *window = new Window(mTitle, w, h, msaa, fullscreen, resizable_, swap);
-	if (window->mWindowGLFW == nullptr) {
+	if ((headless ? window->mContextEGL : static_cast<void *>(window->mWindowGLFW)) == nullptr) {
 		delete window;
 		return nullptr;
 	}
@@ -109,13 +132,33 @@ std::string Window::GetTitle() const
 }
 
 Window::Window(std::string mTitle_, unsigned w_, unsigned h_, unsigned int msaa_, bool fullscreen_, bool resizable_, SwapStrategy swap_) :
-	mTitle(mTitle_), mWidth(w_), mHeight(h_), mMSAA(msaa_), mFullscreen(fullscreen_), mResizable(resizable_), mSwap(swap_), mWindowGLFW(nullptr), mInputHandler(nullptr), mCamera(nullptr)
+	mTitle(mTitle_), mWidth(w_), mHeight(h_), mMSAA(msaa_), mFullscreen(fullscreen_), mResizable(resizable_), mSwap(swap_), mWindowGLFW(nullptr), mDisplayEGL(nullptr), mSurfaceEGL(nullptr), mContextEGL(nullptr), mFramesNb(0u), mCapture(nullptr), mFrameCaptured(false), mInputHandler(nullptr), mCamera(nullptr)
 {
-	Show();
+	auto const& options = Bonobo::GetOptions();
+	// Waiting for the vertical blank would make the benchmarked CPU frame
+	// times a multiple of the refresh period.
+	if (!options.benchmark_path.empty() || !options.replay_path.empty())
+		mSwap = DISABLE_VSYNC;
+	bool const shown = headless ? ShowHeadless() : Show();
+	auto const& capture_prefix = options.capture_prefix;
+	if (shown && !capture_prefix.empty())
+		mCapture = new bonobo::frame_capture(capture_prefix);
 }
 
 Window::~Window()
 {
+	// The remaining captures are read back through the context.
+	delete mCapture;
+#if defined(LUGGCGL_HAS_EGL)
+	if (mDisplayEGL != nullptr) {
+		eglMakeCurrent(mDisplayEGL, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (mContextEGL != nullptr)
+			eglDestroyContext(mDisplayEGL, mContextEGL);
+		if (mSurfaceEGL != nullptr)
+			eglDestroySurface(mDisplayEGL, mSurfaceEGL);
+		eglTerminate(mDisplayEGL);
+	}
+#endif
 }
 
 bool Window::Show()
@@ -166,6 +209,103 @@ bool Window::Show()
 	glfwSetScrollCallback(mWindowGLFW, ImGui_ImplGlfwGL3_ScrollCallback);
 	glfwSetCharCallback(mWindowGLFW, ImGui_ImplGlfwGL3_CharCallback);
 
+	glfwSwapInterval(mSwap);
+	// TODO: Reinitiate renderer
+	return InitContext();
+}
+
+bool Window::ShowHeadless()
+{
+#if defined(LUGGCGL_HAS_EGL)
+	// Build agents have no display server: ask Mesa for its surfaceless
+	// platform when available, rather than the default X11 one.
+	EGLDisplay display = EGL_NO_DISPLAY;
+	auto const client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	auto const get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	if (client_extensions != nullptr && std::strstr(client_extensions, "EGL_MESA_platform_surfaceless") != nullptr
+	    && get_platform_display != nullptr)
+		display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	EGLint egl_major_version = 0, egl_minor_version = 0;
+	if (display == EGL_NO_DISPLAY || eglInitialize(display, &egl_major_version, &egl_minor_version) == EGL_FALSE) {
+		LogError("[EGL]: Failed to initialise a display (error 0x%x).", eglGetError());
+		return false;
+	}
+	mDisplayEGL = display;
+	LogInfo("Using EGL %d.%d (%s) for headless rendering.", egl_major_version, egl_minor_version, eglQueryString(display, EGL_VENDOR));
+
+	// The pbuffer acts as the default framebuffer, so code rendering into
+	// framebuffer 0 works unchanged.
+	EGLint const config_attributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_STENCIL_SIZE, 8,
+		EGL_SAMPLE_BUFFERS, mMSAA > 1u ? 1 : 0,
+		EGL_SAMPLES, mMSAA > 1u ? static_cast<EGLint>(mMSAA) : 0,
+		EGL_NONE
+	};
+	EGLConfig config = nullptr;
+	EGLint configs_nb = 0;
+	if (eglChooseConfig(display, config_attributes, &config, 1, &configs_nb) == EGL_FALSE || configs_nb == 0) {
+		LogError("[EGL]: No configuration supports %u-sample pbuffers.", mMSAA);
+		return false;
+	}
+
+	EGLint const surface_attributes[] = {
+		EGL_WIDTH, static_cast<EGLint>(mWidth),
+		EGL_HEIGHT, static_cast<EGLint>(mHeight),
+		EGL_NONE
+	};
+	mSurfaceEGL = eglCreatePbufferSurface(display, config, surface_attributes);
+	if (mSurfaceEGL == EGL_NO_SURFACE) {
+		LogError("[EGL]: Failed to create a %ux%u pbuffer (error 0x%x).", mWidth, mHeight, eglGetError());
+		mSurfaceEGL = nullptr;
+		return false;
+	}
+
+	EGLint const context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, default_opengl_major_version,
+		EGL_CONTEXT_MINOR_VERSION_KHR, default_opengl_minor_version,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT_KHR,
+		EGL_NONE
+	};
+	eglBindAPI(EGL_OPENGL_API);
+	mContextEGL = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+	if (mContextEGL == EGL_NO_CONTEXT) {
+		LogInfo("Couldn't create an OpenGL %d.%d context.\n", default_opengl_major_version, default_opengl_minor_version);
+		mContextEGL = nullptr;
+		return false;
+	}
+	eglMakeCurrent(display, mSurfaceEGL, mSurfaceEGL, mContextEGL);
+
+	if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress))) {
+		LogError("[GLAD]: Failed to initialise OpenGL context.");
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display, mContextEGL);
+		mContextEGL = nullptr;
+		return false;
+	}
+
+	ImGui_ImplGlfwGL3_Init(nullptr, false);
+	ImGui::GetIO().IniFilename = nullptr;
+
+	eglSwapInterval(display, 0);
+	return InitContext();
+#else
+	LogError("Headless rendering requires EGL, which was not found when building.");
+	return false;
+#endif
+}
+
+bool Window::InitContext()
+{
 	GLint major_version = 0, minor_version = 0, context_flags = 0, profile_mask = 0;
 	glGetIntegerv(GL_MAJOR_VERSION, &major_version);
 	glGetIntegerv(GL_MINOR_VERSION, &minor_version);
@@ -196,8 +336,12 @@ bool Window::Show()
 		LogInfo("DebugCallback is not core in OpenGL %d.%d, and sadly the GL_KHR_DEBUG extension is not available either.", major_version, minor_version);
 	}
 
-	glfwSwapInterval(mSwap);
-	// TODO: Reinitiate renderer
+	auto& io = ImGui::GetIO();
+	if (io.RenderDrawListsFn != RenderImGuiDrawLists) {
+		imgui_render_draw_lists = io.RenderDrawListsFn;
+		io.RenderDrawListsFn = RenderImGuiDrawLists;
+	}
+
 	return true;
 }
 
@@ -205,6 +349,10 @@ void Window::SetFullscreen(bool state)
 {
 	if (mFullscreen == state)
 		return;
+	if (headless) {
+		LogWarning("Headless windows can not go fullscreen.");
+		return;
+	}
 	if (mWindowGLFW)
 		glfwDestroyWindow(mWindowGLFW);
 	mFullscreen = state;
@@ -215,10 +363,20 @@ void Window::SetFullscreen(bool state)
 	}
 }
 
-void Window::Init()
+void Window::Init(bool headless_, unsigned int max_frames_nb_)
 {
-	glfwSetErrorCallback(Window::ErrorCallback);
-	glfwInit();
+	headless = headless_;
+	max_frames_nb = max_frames_nb_;
+	if (headless)
+		LogInfo("Rendering headless%s", max_frames_nb == 0u ? ", without any frame limit" : "");
+	if (max_frames_nb != 0u)
+		LogInfo("Closing after %u frames", max_frames_nb);
+
+	// GLFW would fail to initialise without a display server.
+	if (!headless) {
+		glfwSetErrorCallback(Window::ErrorCallback);
+		glfwInit();
+	}
 
 	if (windowMap != nullptr)
 		Window::Destroy();
@@ -234,12 +392,68 @@ void Window::Destroy()
 	windowMap->clear();
 	delete windowMap;
 	windowMap = nullptr;
-	glfwTerminate();
+	if (!headless)
+		glfwTerminate();
+}
+
+bool Window::IsHeadless()
+{
+	return headless;
+}
+
+void Window::CaptureScene()
+{
+	if (mCapture == nullptr || mFrameCaptured)
+		return;
+	mCapture->capture(static_cast<GLsizei>(mWidth), static_cast<GLsizei>(mHeight));
+	mFrameCaptured = true;
 }
 
-void Window::Swap() const
+void Window::Swap()
 {
+	CaptureScene();
+	mFrameCaptured = false;
+#if defined(LUGGCGL_HAS_EGL)
+	if (headless)
+		eglSwapBuffers(mDisplayEGL, mSurfaceEGL);
+	else
+#endif
 	glfwSwapBuffers(mWindowGLFW);
+	++mFramesNb;
+}
+
+bool Window::ShouldClose() const
+{
+	if (max_frames_nb != 0u && mFramesNb >= max_frames_nb)
+		return true;
+	return !headless && glfwWindowShouldClose(mWindowGLFW);
+}
+
+void Window::PollEvents() const
+{
+	if (!headless)
+		glfwPollEvents();
+}
+
+void Window::NewImGuiFrame() const
+{
+	if (!headless) {
+		ImGui_ImplGlfwGL3_NewFrame();
+		return;
+	}
+
+	// Mirrors ImGui_ImplGlfwGL3_NewFrame(), without any input.
+	static double last_time = 0.0;
+	auto& io = ImGui::GetIO();
+	if (io.Fonts->TexID == nullptr)
+		ImGui_ImplGlfwGL3_CreateDeviceObjects();
+	auto const time = GetTimeSeconds();
+	io.DisplaySize = ImVec2(static_cast<float>(mWidth), static_cast<float>(mHeight));
+	io.DisplayFramebufferScale = ImVec2(1.0f, 1.0f);
+	io.DeltaTime = last_time > 0.0 ? static_cast<float>(time - last_time) : 1.0f / 60.0f;
+	io.MousePos = ImVec2(-1.0f, -1.0f);
+	last_time = time;
+	ImGui::NewFrame();
 }
 
 glm::ivec2 Window::GetDimensions() const
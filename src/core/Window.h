@@ -10,6 +10,11 @@
 
 class InputHandler;
 
+namespace bonobo
+{
+	class frame_capture;
+}
+
 
 class Window
 {
@@ -20,7 +25,16 @@ public:
 		LATE_SWAP_TEARING = -1
 	};
 public:
-	static void Init();
+	//! \brief Initialise the window management system.
+	//!
+	//! @param [in] headless whether to render into an offscreen EGL
+	//!             pbuffer rather than a visible window, for machines
+	//!             without a display, e.g. using Mesa's llvmpipe
+	//! @param [in] max_frames_nb number of frames swapped before
+	//!             `ShouldClose()` returns true, or 0 for no limit
+	static void Init(bool headless = false, unsigned int max_frames_nb = 0u);
+	//! \brief Whether windows are rendered offscreen, without GLFW.
+	static bool IsHeadless();
 	static Window *Create(std::string title, unsigned int w, unsigned int h, unsigned int msaa = 4, bool fullscreen = false, bool resizable_ = true, SwapStrategy swap = ENABLE_VSYNC);
 	static bool Destroy(Window *window);
 	static void Destroy();
@@ -31,13 +45,30 @@ protected:
 public:
 	void SetFullscreen(bool state);
 	std::string GetTitle() const;
-	void Swap() const;
+	//! \brief Capture the frame as rendered so far, when a capture
+	//!        prefix was given, see `Bonobo::Options::capture_prefix`.
+	//!
+	//! Called before `ImGui::Render()`, so that captures only hold the
+	//! scene and can be compared from one run to the next.
+	void CaptureScene();
+	//! \brief Present the frame; it is first captured if
+	//!        `CaptureScene()` was not called since the last swap.
+	void Swap();
+	//! \brief Whether the user asked to close the window, or the frame
+	//!        limit given to `Init()` was reached.
+	bool ShouldClose() const;
+	//! \brief Process pending window events; does nothing when headless.
+	void PollEvents() const;
+	//! \brief Start a new ImGui frame.
+	void NewImGuiFrame() const;
 	glm::ivec2 GetDimensions() const;
 	GLFWwindow *GetGLFW_Window() const;
 	void SetInputHandler(InputHandler *inputHandler);
 	void SetCamera(FPSCameraf *camera);
 private:
 	bool Show();
+	bool ShowHeadless();
+	bool InitContext();
 	static void ErrorCallback(int error, char const* description);
 	static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
 	static void MouseCallback(GLFWwindow* window, int button, int action, int mods);
@@ -51,6 +82,12 @@ private:
 	bool mResizable;
 	SwapStrategy mSwap;
 	GLFWwindow *mWindowGLFW;
+	void *mDisplayEGL;	//!< EGLDisplay, when headless
+	void *mSurfaceEGL;	//!< EGLSurface, when headless
+	void *mContextEGL;	//!< EGLContext, when headless
+	unsigned int mFramesNb;
+	bonobo::frame_capture *mCapture;	//!< null unless capturing frames
+	bool mFrameCaptured;	//!< whether the current frame was already captured
 	InputHandler *mInputHandler;
 	FPSCameraf *mCamera;
 };
@@ -0,0 +1,264 @@
+#include "benchmark.hpp"
+
+#include "core/Bonobo.h"
+#include "core/InputHandler.h"
+#include "core/Log.h"
+#include "core/Misc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace local
+{
+	// Frames recorded by the GPU profiler before their timings are read.
+	constexpr unsigned int frames_in_flight = 3u;
+
+	constexpr unsigned int default_measured_frames_nb = 600u;
+	constexpr float catmull_rom_tension = 0.5f;
+
+	struct statistics {
+		size_t samples_nb;
+		double min, median, p95, p99, max, mean;
+	};
+
+	// Percentiles use the nearest-rank method; NaN samples are ignored.
+	static statistics compute_statistics(std::vector<double> samples)
+	{
+		samples.erase(std::remove_if(samples.begin(), samples.end(), [](double s){ return std::isnan(s); }), samples.end());
+		auto stats = statistics{ samples.size(), 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+		if (samples.empty())
+			return stats;
+
+		std::sort(samples.begin(), samples.end());
+		auto const percentile = [&samples](double p) {
+			auto const rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(samples.size())));
+			return samples[std::max<size_t>(rank, 1u) - 1u];
+		};
+		stats.min = samples.front();
+		stats.median = percentile(50.0);
+		stats.p95 = percentile(95.0);
+		stats.p99 = percentile(99.0);
+		stats.max = samples.back();
+		for (auto const s : samples)
+			stats.mean += s;
+		stats.mean /= static_cast<double>(samples.size());
+		return stats;
+	}
+
+	static void write_json(std::ostream& os, statistics const& s)
+	{
+		os << "{ \"samples\": " << s.samples_nb
+		   << ", \"min\": " << s.min << ", \"median\": " << s.median
+		   << ", \"p95\": " << s.p95 << ", \"p99\": " << s.p99
+		   << ", \"max\": " << s.max << ", \"mean\": " << s.mean << " }";
+	}
+
+	static void write_json_escaped(std::ostream& os, std::string const& string)
+	{
+		os << '"';
+		for (auto const c : string) {
+			if (c == '"' || c == '\\')
+				os << '\\';
+			os << c;
+		}
+		os << '"';
+	}
+}
+
+bonobo::benchmark::benchmark(std::string const& name, spline_function spline) : _name(name), _spline(spline), _enabled(false), _done(false), _fixed_timestep(false), _output(), _renderer(), _warmup_frames_nb(0u), _measured_frames_nb(0u), _timestep_ms(0.0), _keys(), _gpu_profiler(), _frames_begun_nb(0u), _frame_start_ms(0.0), _cpu_ms(), _gpu_ms()
+{
+	auto const& options = Bonobo::GetOptions();
+	_fixed_timestep = !options.benchmark_path.empty() || !options.replay_path.empty() || !options.record_path.empty();
+	_timestep_ms = options.timestep_ms;
+	if (options.benchmark_path.empty() && options.replay_path.empty())
+		return;
+
+	if (!options.benchmark_path.empty() && !load_path(options.benchmark_path)) {
+		LogError("Failed to load the camera path \"%s\": ending the benchmark", options.benchmark_path.c_str());
+		_done = true;
+		return;
+	}
+
+	_enabled = true;
+	_output = options.benchmark_output;
+	_warmup_frames_nb = options.warmup_frames_nb;
+	_measured_frames_nb = options.frames_nb != 0u ? options.frames_nb : local::default_measured_frames_nb;
+	if (options.frames_nb == 0u && !options.replay_path.empty()) {
+		// Inputs advance by one tick per frame.
+		auto const ticks_nb = InputHandler::GetRecordingTicksNb(options.replay_path);
+		if (ticks_nb != 0u)
+			_measured_frames_nb = ticks_nb > _warmup_frames_nb ? static_cast<unsigned int>(ticks_nb - _warmup_frames_nb) : 1u;
+	}
+	auto const renderer = glGetString(GL_RENDERER);
+	_renderer = renderer != nullptr ? reinterpret_cast<char const*>(renderer) : "unknown";
+	_gpu_profiler = std::make_unique<gpu_profiler>(local::frames_in_flight);
+	_cpu_ms.assign(_measured_frames_nb, std::numeric_limits<double>::quiet_NaN());
+	_gpu_ms.assign(_measured_frames_nb, std::numeric_limits<double>::quiet_NaN());
+
+	LogInfo("Benchmarking \"%s\" over %u frames, after %u warm-up ones, every %.3f ms",
+	        options.benchmark_path.empty() ? options.replay_path.c_str() : options.benchmark_path.c_str(),
+	        _measured_frames_nb, _warmup_frames_nb, _timestep_ms);
+}
+
+double
+bonobo::benchmark::get_time_milliseconds() const
+{
+	if (!_fixed_timestep)
+		return GetTimeMilliseconds();
+	return static_cast<double>(_frames_begun_nb) * _timestep_ms;
+}
+
+double
+bonobo::benchmark::get_time_seconds() const
+{
+	if (!_fixed_timestep)
+		return GetTimeSeconds();
+	return get_time_milliseconds() / 1000.0;
+}
+
+void
+bonobo::benchmark::begin_frame()
+{
+	if (_done)
+		return;
+	if (_fixed_timestep)
+		++_frames_begun_nb;
+	if (!_enabled)
+		return;
+
+	_frame_start_ms = GetTimeMilliseconds();
+
+	// The profiler reads back the frame issued `frames_in_flight` frames
+	// before the one it starts, unless the results were not ready.
+	auto const collected_frames_nb = _gpu_profiler->get_collected_frames_nb();
+	_gpu_profiler->begin_frame();
+	if (_gpu_profiler->get_collected_frames_nb() == collected_frames_nb)
+		return;
+	auto const frame = static_cast<long long>(_frames_begun_nb) - 1ll - local::frames_in_flight - _warmup_frames_nb;
+	if (frame >= 0ll && frame < static_cast<long long>(_measured_frames_nb))
+		_gpu_ms[static_cast<size_t>(frame)] = _gpu_profiler->get_sections().front().last_ms;
+}
+
+void
+bonobo::benchmark::place_camera(FPSCameraf& camera) const
+{
+	if (!_enabled || _keys.empty())
+		return;
+
+	auto const frame = std::min(_frames_begun_nb - std::min(_frames_begun_nb, _warmup_frames_nb + 1u), _measured_frames_nb - 1u);
+	auto const progress = _measured_frames_nb > 1u ? static_cast<float>(frame) / static_cast<float>(_measured_frames_nb - 1u) : 0.0f;
+	auto const last = _keys.size() - 1u;
+	auto const position = progress * static_cast<float>(last);
+	auto const i = std::min(static_cast<size_t>(position), last == 0u ? 0u : last - 1u);
+	auto const x = position - static_cast<float>(i);
+
+	auto const& k0 = _keys[i == 0u ? 0u : i - 1u];
+	auto const& k1 = _keys[i];
+	auto const& k2 = _keys[std::min(i + 1u, last)];
+	auto const& k3 = _keys[std::min(i + 2u, last)];
+	camera.mWorld.SetTranslate(_spline(k0.position, k1.position, k2.position, k3.position, local::catmull_rom_tension, x));
+	camera.mWorld.LookAt(_spline(k0.target, k1.target, k2.target, k3.target, local::catmull_rom_tension, x), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+void
+bonobo::benchmark::end_frame()
+{
+	if (!_enabled || _done)
+		return;
+
+	_gpu_profiler->end_frame();
+	// Swapping a headless pbuffer does not necessarily flush, which would
+	// leave the queries pending for longer than the frames in flight.
+	glFlush();
+	auto const frame = static_cast<long long>(_frames_begun_nb) - 1ll - _warmup_frames_nb;
+	if (frame >= 0ll && frame < static_cast<long long>(_measured_frames_nb))
+		_cpu_ms[static_cast<size_t>(frame)] = GetTimeMilliseconds() - _frame_start_ms;
+
+	if (_frames_begun_nb < _warmup_frames_nb + _measured_frames_nb + local::frames_in_flight)
+		return;
+	_done = true;
+	write_results();
+}
+
+bool
+bonobo::benchmark::load_path(std::string const& path)
+{
+	auto file = std::ifstream(path);
+	if (!file.is_open())
+		return false;
+
+	auto line = std::string();
+	for (size_t line_nb = 1u; std::getline(file, line); ++line_nb) {
+		if (line.empty() || line[0] == '#' || line.find_first_not_of(" \t\r") == std::string::npos)
+			continue;
+		auto stream = std::istringstream(line);
+		key k;
+		if (!(stream >> k.position.x >> k.position.y >> k.position.z >> k.target.x >> k.target.y >> k.target.z)) {
+			LogError("\"%s\", line %zu: expected a position and a target", path.c_str(), line_nb);
+			return false;
+		}
+		_keys.push_back(k);
+	}
+	return !_keys.empty();
+}
+
+bool
+bonobo::benchmark::write_results() const
+{
+	auto const cpu = local::compute_statistics(_cpu_ms);
+	auto const gpu = local::compute_statistics(_gpu_ms);
+	LogInfo("CPU frame times (ms): min %.3f, median %.3f, p95 %.3f, p99 %.3f", cpu.min, cpu.median, cpu.p95, cpu.p99);
+	LogInfo("GPU frame times (ms): min %.3f, median %.3f, p95 %.3f, p99 %.3f", gpu.min, gpu.median, gpu.p95, gpu.p99);
+
+	auto const csv_path = _output + ".csv";
+	auto csv = std::ofstream(csv_path, std::ios::trunc);
+	if (!csv.is_open()) {
+		LogWarning("Could not create \"%s\"", csv_path.c_str());
+		return false;
+	}
+	csv << "timer,samples,min_ms,median_ms,p95_ms,p99_ms,max_ms,mean_ms\n";
+	for (auto const& row : { std::make_pair("cpu", cpu), std::make_pair("gpu", gpu) }) {
+		auto const& s = row.second;
+		csv << row.first << "," << s.samples_nb << "," << s.min << "," << s.median << "," << s.p95
+		    << "," << s.p99 << "," << s.max << "," << s.mean << "\n";
+	}
+
+	auto const json_path = _output + ".json";
+	auto json = std::ofstream(json_path, std::ios::trunc);
+	if (!json.is_open()) {
+		LogWarning("Could not create \"%s\"", json_path.c_str());
+		return false;
+	}
+	json << "{\n\t\"name\": ";
+	local::write_json_escaped(json, _name);
+	json << ",\n\t\"renderer\": ";
+	local::write_json_escaped(json, _renderer);
+	json << ",\n\t\"warmup_frames\": " << _warmup_frames_nb
+	     << ",\n\t\"frames\": " << _measured_frames_nb
+	     << ",\n\t\"timestep_ms\": " << _timestep_ms
+	     << ",\n\t\"gpu_dropped_frames\": " << (_measured_frames_nb - gpu.samples_nb)
+	     << ",\n\t\"cpu_ms\": ";
+	local::write_json(json, cpu);
+	json << ",\n\t\"gpu_ms\": ";
+	local::write_json(json, gpu);
+	json << ",\n\t\"frames_ms\": [";
+	for (size_t i = 0u; i < _measured_frames_nb; ++i) {
+		json << (i == 0u ? "\n\t\t[" : ",\n\t\t[") << _cpu_ms[i] << ", ";
+		if (std::isnan(_gpu_ms[i]))
+			json << "null";
+		else
+			json << _gpu_ms[i];
+		json << "]";
+	}
+	json << "\n\t]\n}\n";
+
+	if (!csv.good() || !json.good()) {
+		LogWarning("Failed to write the benchmark results to \"%s\"", _output.c_str());
+		return false;
+	}
+	LogInfo("Benchmark results written to \"%s\" and \"%s\"", csv_path.c_str(), json_path.c_str());
+	return true;
+}
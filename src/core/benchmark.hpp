@@ -0,0 +1,116 @@
+#pragma once
+
+#include "FPSCamera.h"
+#include "gpu_profiler.hpp"
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Renders a reproducible sequence of frames and reports
+	//!        statistics on how long they took.
+	//!
+	//! The camera follows a path read from a text file, with one key per
+	//! line: the position of the camera followed by the point it looks
+	//! at, as six numbers; empty lines and lines starting with `#` are
+	//! skipped. Keys are evenly spread over the measured frames, and
+	//! joined by splines.
+	//!
+	//! A run is made of warm-up frames, with the camera on the first key,
+	//! then of the measured frames, and last of a few frames giving the
+	//! GPU time to report on the final measured ones. Time advances by a
+	//! fixed step every frame, starting from 0, so animations driven by
+	//! `get_time_milliseconds()` or `get_time_seconds()` are the same
+	//! from one run to the next.
+	//!
+	//! Replaying recorded inputs is benchmarked the same way, the camera
+	//! then being driven by those inputs, over as many frames as were
+	//! recorded; recording inputs also uses the fixed time step, for the
+	//! replay to match what was seen.
+	//!
+	//! Once done, the minimum, median, 95th and 99th percentiles of the
+	//! CPU and GPU frame times are logged and written as CSV and JSON,
+	//! the latter also holding each frame's timings.
+	class benchmark
+	{
+	public:
+		//! \brief Signature of `interpolation::evalCatmullRom()`.
+		using spline_function = glm::vec3 (*)(glm::vec3 const&, glm::vec3 const&,
+		                                      glm::vec3 const&, glm::vec3 const&,
+		                                      float, float);
+
+		//! \brief Set up a benchmark from `Bonobo::GetOptions()`.
+		//!
+		//! The benchmark is disabled unless a camera path or inputs to
+		//! replay were given, in which case an OpenGL context must be
+		//! current. If the path can not be loaded, the benchmark is
+		//! immediately done.
+		//!
+		//! @param [in] name identifies the run in the results
+		//! @param [in] spline used to interpolate the camera path
+		benchmark(std::string const& name, spline_function spline);
+
+		benchmark(benchmark const&) = delete;
+		benchmark& operator=(benchmark const&) = delete;
+
+		//! \brief Whether frames are being measured.
+		bool is_enabled() const { return _enabled; }
+
+		//! \brief Whether the camera should be placed by
+		//!        `place_camera()` rather than by user inputs.
+		bool has_camera_path() const { return !_keys.empty(); }
+
+		//! \brief Whether all frames were rendered, and the results
+		//!        written; the application should then close.
+		bool is_done() const { return _done; }
+
+		//! \brief Simulated time of the current frame when benchmarking
+		//!        or recording inputs, the wall-clock time otherwise.
+		double get_time_milliseconds() const;
+
+		//! \brief Same as `get_time_milliseconds()`, in seconds.
+		double get_time_seconds() const;
+
+		//! \brief Start timing a new frame; to be called first thing in
+		//!        the frame.
+		void begin_frame();
+
+		//! \brief Move the camera to where the path is at this frame.
+		void place_camera(FPSCameraf& camera) const;
+
+		//! \brief Stop timing the frame; to be called after swapping.
+		void end_frame();
+
+	private:
+		struct key {
+			glm::vec3 position;
+			glm::vec3 target;
+		};
+
+		bool load_path(std::string const& path);
+		bool write_results() const;
+
+		std::string _name;
+		spline_function _spline;
+		bool _enabled;
+		bool _done;
+		bool _fixed_timestep;
+
+		std::string _output;
+		std::string _renderer;
+		unsigned int _warmup_frames_nb;
+		unsigned int _measured_frames_nb;
+		double _timestep_ms;
+		std::vector<key> _keys;
+
+		std::unique_ptr<gpu_profiler> _gpu_profiler;
+		unsigned int _frames_begun_nb;
+		double _frame_start_ms;
+		std::vector<double> _cpu_ms;
+		std::vector<double> _gpu_ms; //!< NaN for frames dropped by the GPU profiler
+	};
+}
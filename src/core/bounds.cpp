@@ -0,0 +1,232 @@
+#include "bounds.hpp"
+
+#include "core/node.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	define BONOBO_BOUNDS_USE_SSE 1
+#	include <xmmintrin.h>
+#else
+#	define BONOBO_BOUNDS_USE_SSE 0
+#endif
+
+namespace local
+{
+	// Scratch buffers reused by cullNodes() from one call to the next;
+	// culling only happens on the thread owning the OpenGL context.
+	static std::vector<bonobo::bounding_sphere> spheres;
+	static std::vector<glm::mat4> transforms;
+	static std::vector<Node const*> candidates;
+	static std::vector<uint8_t> visibility;
+
+	static glm::vec4 row(glm::mat4 const& m, glm::length_t i)
+	{
+		return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+	}
+
+	static glm::vec4 normalize_plane(glm::vec4 const& plane)
+	{
+		auto const length = glm::length(glm::vec3(plane));
+		return length > 0.0f ? plane / length : plane;
+	}
+
+	// Unknown bounds are tested as an infinite sphere, which passes every
+	// plane without needing a branch in the SIMD loop.
+	static float effective_radius(bonobo::bounding_sphere const& sphere)
+	{
+		return sphere.radius < 0.0f ? std::numeric_limits<float>::infinity() : sphere.radius;
+	}
+}
+
+void
+bonobo::computeBounds(glm::vec3 const* positions, size_t positions_nb, aabb& box, bounding_sphere& sphere)
+{
+	box = aabb();
+	sphere = bounding_sphere();
+	if (positions == nullptr || positions_nb == 0u)
+		return;
+
+	box.min = box.max = positions[0];
+	for (size_t i = 1u; i < positions_nb; ++i) {
+		box.min = glm::min(box.min, positions[i]);
+		box.max = glm::max(box.max, positions[i]);
+	}
+
+	sphere.center = 0.5f * (box.min + box.max);
+	auto radius2 = 0.0f;
+	for (size_t i = 0u; i < positions_nb; ++i) {
+		auto const offset = positions[i] - sphere.center;
+		radius2 = std::max(radius2, glm::dot(offset, offset));
+	}
+	sphere.radius = std::sqrt(radius2);
+}
+
+bonobo::aabb
+bonobo::transformBounds(aabb const& box, glm::mat4 const& transform)
+{
+	auto const center = glm::vec3(transform * glm::vec4(0.5f * (box.min + box.max), 1.0f));
+	auto const half_extent = 0.5f * (box.max - box.min);
+	auto const linear = glm::mat3(transform);
+	auto const absolute = glm::mat3(glm::abs(linear[0]), glm::abs(linear[1]), glm::abs(linear[2]));
+	auto const new_half_extent = absolute * half_extent;
+
+	aabb result;
+	result.min = center - new_half_extent;
+	result.max = center + new_half_extent;
+	return result;
+}
+
+bonobo::bounding_sphere
+bonobo::transformBounds(bounding_sphere const& sphere, glm::mat4 const& transform)
+{
+	if (sphere.radius < 0.0f)
+		return sphere;
+
+	auto const scaling2 = std::max({ glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+	                                 glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+	                                 glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2])) });
+
+	bounding_sphere result;
+	result.center = glm::vec3(transform * glm::vec4(sphere.center, 1.0f));
+	result.radius = sphere.radius * std::sqrt(scaling2);
+	return result;
+}
+
+bonobo::frustum
+bonobo::extractFrustum(glm::mat4 const& world_to_clip)
+{
+	// Gribb & Hartmann: a point is inside when -w <= x, y, z <= w in
+	// clip-space, and each of those inequalities is a plane in world-space.
+	auto const x = local::row(world_to_clip, 0);
+	auto const y = local::row(world_to_clip, 1);
+	auto const z = local::row(world_to_clip, 2);
+	auto const w = local::row(world_to_clip, 3);
+
+	frustum result;
+	result.planes[frustum::left]   = local::normalize_plane(w + x);
+	result.planes[frustum::right]  = local::normalize_plane(w - x);
+	result.planes[frustum::bottom] = local::normalize_plane(w + y);
+	result.planes[frustum::top]    = local::normalize_plane(w - y);
+	result.planes[frustum::front]  = local::normalize_plane(w + z);
+	result.planes[frustum::back]   = local::normalize_plane(w - z);
+	return result;
+}
+
+bool
+bonobo::isVisible(frustum const& f, aabb const& box)
+{
+	for (auto const& plane : f.planes) {
+		// Corner of the box furthest along the plane normal
+		auto const corner = glm::vec3(plane.x >= 0.0f ? box.max.x : box.min.x,
+		                              plane.y >= 0.0f ? box.max.y : box.min.y,
+		                              plane.z >= 0.0f ? box.max.z : box.min.z);
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+bool
+bonobo::isVisible(frustum const& f, bounding_sphere const& sphere)
+{
+	if (sphere.radius < 0.0f)
+		return true;
+
+	for (auto const& plane : f.planes)
+		if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+			return false;
+	return true;
+}
+
+bonobo::culling_stats
+bonobo::cullSpheres(frustum const& f, bounding_sphere const* spheres, size_t spheres_nb, uint8_t* visible)
+{
+	culling_stats stats;
+	size_t i = 0u;
+
+#if BONOBO_BOUNDS_USE_SSE
+	__m128 plane_x[frustum::count], plane_y[frustum::count], plane_z[frustum::count], plane_w[frustum::count];
+	for (size_t p = 0u; p < frustum::count; ++p) {
+		plane_x[p] = _mm_set1_ps(f.planes[p].x);
+		plane_y[p] = _mm_set1_ps(f.planes[p].y);
+		plane_z[p] = _mm_set1_ps(f.planes[p].z);
+		plane_w[p] = _mm_set1_ps(f.planes[p].w);
+	}
+
+	for (; i + 4u <= spheres_nb; i += 4u) {
+		auto const s = spheres + i;
+		auto const x = _mm_setr_ps(s[0].center.x, s[1].center.x, s[2].center.x, s[3].center.x);
+		auto const y = _mm_setr_ps(s[0].center.y, s[1].center.y, s[2].center.y, s[3].center.y);
+		auto const z = _mm_setr_ps(s[0].center.z, s[1].center.z, s[2].center.z, s[3].center.z);
+		auto const minus_radius = _mm_setr_ps(-local::effective_radius(s[0]), -local::effective_radius(s[1]),
+		                                      -local::effective_radius(s[2]), -local::effective_radius(s[3]));
+
+		auto inside = _mm_setzero_ps();
+		for (size_t p = 0u; p < frustum::count; ++p) {
+			auto const distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_x[p], x), _mm_mul_ps(plane_y[p], y)),
+			                                 _mm_add_ps(_mm_mul_ps(plane_z[p], z), plane_w[p]));
+			auto const passes = _mm_cmpge_ps(distance, minus_radius);
+			inside = p == 0u ? passes : _mm_and_ps(inside, passes);
+		}
+
+		auto const mask = _mm_movemask_ps(inside);
+		for (size_t k = 0u; k < 4u; ++k) {
+			visible[i + k] = static_cast<uint8_t>((mask >> k) & 1);
+			if (visible[i + k] != 0u)
+				++stats.visible_nb;
+			else
+				++stats.culled_nb;
+		}
+	}
+#endif
+
+	for (; i < spheres_nb; ++i) {
+		visible[i] = isVisible(f, spheres[i]) ? 1u : 0u;
+		if (visible[i] != 0u)
+			++stats.visible_nb;
+		else
+			++stats.culled_nb;
+	}
+
+	return stats;
+}
+
+bonobo::culling_stats
+bonobo::cullNodes(frustum const& f, std::vector<Node> const& nodes, std::vector<Node const*>& visible)
+{
+	visible.clear();
+
+	local::spheres.clear();
+	local::transforms.clear();
+	local::candidates.clear();
+	for (auto const& node : nodes) {
+		if (node.get_vao() == 0u)
+			continue;
+		local::transforms.push_back(node.get_transform());
+		local::spheres.push_back(transformBounds(node.get_bounding_sphere(), local::transforms.back()));
+		local::candidates.push_back(&node);
+	}
+
+	local::visibility.resize(local::candidates.size());
+	auto stats = cullSpheres(f, local::spheres.data(), local::spheres.size(), local::visibility.data());
+
+	// Spheres are loose around elongated meshes, so refine the survivors
+	// with their boxes; this only runs on the ones that passed.
+	for (size_t i = 0u; i < local::candidates.size(); ++i) {
+		if (local::visibility[i] == 0u)
+			continue;
+		auto const node = local::candidates[i];
+		if (node->get_bounding_sphere().radius >= 0.0f
+		 && !isVisible(f, transformBounds(node->get_bounds(), local::transforms[i]))) {
+			--stats.visible_nb;
+			++stats.culled_nb;
+			continue;
+		}
+		visible.push_back(node);
+	}
+
+	return stats;
+}
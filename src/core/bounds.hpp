@@ -0,0 +1,132 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Node;
+
+namespace bonobo
+{
+	//! \brief Axis-aligned bounding box.
+	struct aabb {
+		glm::vec3 min;
+		glm::vec3 max;
+
+		aabb() : min(0.0f), max(0.0f)
+		{
+		}
+	};
+
+	//! \brief Bounding sphere; a negative radius means the bounds are
+	//!        unknown, and such a volume is never culled.
+	struct bounding_sphere {
+		glm::vec3 center;
+		float radius;
+
+		bounding_sphere() : center(0.0f), radius(-1.0f)
+		{
+		}
+	};
+
+	//! \brief Planes of a view frustum.
+	//!
+	//! Each plane is stored as `(n, d)` with `n` of unit length and
+	//! pointing inside, so that a point `p` lies inside the frustum when
+	//! `dot(n, p) + d >= 0` for all six planes.
+	struct frustum {
+		//! \brief Index of each plane; `front` and `back` are the near
+		//!        and far planes.
+		enum plane : unsigned int { left = 0u, right, bottom, top, front, back, count };
+
+		std::array<glm::vec4, plane::count> planes;
+	};
+
+	//! \brief Number of volumes kept and rejected by a culling pass.
+	struct culling_stats {
+		size_t visible_nb;
+		size_t culled_nb;
+
+		culling_stats() : visible_nb(0u), culled_nb(0u)
+		{
+		}
+
+		culling_stats& operator+=(culling_stats const& other)
+		{
+			visible_nb += other.visible_nb;
+			culled_nb += other.culled_nb;
+			return *this;
+		}
+	};
+
+	//! \brief Compute the bounding box and a bounding sphere of a set of
+	//!        points.
+	//!
+	//! The sphere is centred on the box, which is not the tightest fit
+	//! but is cheap and good enough for culling.
+	//!
+	//! @param [in] positions points to bound
+	//! @param [in] positions_nb number of points
+	//! @param [out] box bounding box of the points
+	//! @param [out] sphere bounding sphere of the points; its radius is
+	//!              left negative if there are no points
+	void computeBounds(glm::vec3 const* positions, size_t positions_nb,
+	                   aabb& box, bounding_sphere& sphere);
+
+	//! \brief Bounding box, in the destination space, of a transformed box.
+	aabb transformBounds(aabb const& box, glm::mat4 const& transform);
+
+	//! \brief Bounding sphere, in the destination space, of a transformed
+	//!        sphere; non-uniform scalings grow the radius by their
+	//!        largest factor.
+	bounding_sphere transformBounds(bounding_sphere const& sphere, glm::mat4 const& transform);
+
+	//! \brief Extract the frustum planes of a projection.
+	//!
+	//! @param [in] world_to_clip matrix transforming from world-space to
+	//!             OpenGL clip-space, such as
+	//!             `FPSCamera::GetWorldToClipMatrix()` or the matrix of a
+	//!             shadow-casting light
+	//! @return the planes, expressed in world-space
+	frustum extractFrustum(glm::mat4 const& world_to_clip);
+
+	//! \brief Test whether a box intersects or lies inside a frustum.
+	bool isVisible(frustum const& f, aabb const& box);
+
+	//! \brief Test whether a sphere intersects or lies inside a frustum.
+	bool isVisible(frustum const& f, bounding_sphere const& sphere);
+
+	//! \brief Test many spheres at once against a frustum.
+	//!
+	//! Spheres are processed four at a time with SSE when the compiler
+	//! targets it, and one at a time otherwise.
+	//!
+	//! @param [in] f frustum to test against
+	//! @param [in] spheres world-space spheres to test
+	//! @param [in] spheres_nb number of spheres
+	//! @param [out] visible array of at least `spheres_nb` elements, set
+	//!              to 1 for spheres that may be visible and to 0 otherwise
+	//! @return how many spheres were kept and rejected
+	culling_stats cullSpheres(frustum const& f, bounding_sphere const* spheres,
+	                          size_t spheres_nb, uint8_t* visible);
+
+	//! \brief Keep the nodes whose geometry may be seen through a
+	//!        frustum.
+	//!
+	//! Nodes are first tested by their bounding sphere with
+	//! `cullSpheres()`, and the ones passing are then tested by their
+	//! bounding box. Nodes without geometry are dropped, and nodes with
+	//! unknown bounds are always kept. Children are not visited.
+	//!
+	//! @param [in] f world-space frustum to test against
+	//! @param [in] nodes nodes to filter, placed in world-space by their
+	//!             own transform
+	//! @param [out] visible cleared, then filled with the nodes kept, in
+	//!              the order they appear in `nodes`
+	//! @return how many nodes were kept and rejected
+	culling_stats cullNodes(frustum const& f, std::vector<Node> const& nodes,
+	                        std::vector<Node const*>& visible);
+}
@@ -0,0 +1,421 @@
+#include "bvh.hpp"
+
+#include "core/node.hpp"
+#include "core/Profiler.h"
+#include "core/thread_pool.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace local
+{
+	constexpr size_t bins_nb = 16u;
+	constexpr uint32_t max_leaf_size = 4u;      // larger leaves are only made when no split helps
+	constexpr unsigned int max_depth = 64u;     // bounds the traversal stacks
+	constexpr uint32_t parallel_threshold = 4096u;
+	constexpr float traversal_cost = 1.0f;      // relative to the cost of testing one primitive
+	constexpr uint32_t all_planes = (1u << bonobo::frustum::count) - 1u;
+
+	static bonobo::aabb empty_box()
+	{
+		bonobo::aabb box;
+		box.min = glm::vec3(std::numeric_limits<float>::max());
+		box.max = glm::vec3(-std::numeric_limits<float>::max());
+		return box;
+	}
+
+	static void grow(bonobo::aabb& box, glm::vec3 const& point)
+	{
+		box.min = glm::min(box.min, point);
+		box.max = glm::max(box.max, point);
+	}
+
+	static void grow(bonobo::aabb& box, bonobo::aabb const& other)
+	{
+		box.min = glm::min(box.min, other.min);
+		box.max = glm::max(box.max, other.max);
+	}
+
+	static bonobo::bounding_sphere enclosing_sphere(bonobo::aabb const& box)
+	{
+		bonobo::bounding_sphere sphere;
+		sphere.center = 0.5f * (box.min + box.max);
+		sphere.radius = 0.5f * glm::length(box.max - box.min);
+		return sphere;
+	}
+
+	// Spheres are stored in leaf order, so that each leaf can be tested
+	// with a single call to cullSpheres().
+	static void gather_spheres(std::vector<bonobo::bounding_sphere> const& spheres, std::vector<uint32_t> const& primitives,
+	                           std::vector<bonobo::bounding_sphere>& leaf_spheres)
+	{
+		leaf_spheres.resize(primitives.size());
+		for (size_t i = 0u; i < primitives.size(); ++i)
+			leaf_spheres[i] = spheres[primitives[i]];
+	}
+
+	static float surface_area(bonobo::aabb const& box)
+	{
+		auto const d = box.max - box.min;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	// Distance along the ray at which it enters the box, or a negative
+	// value if it misses it or enters it past max_distance.
+	static float intersect(glm::vec3 const& min, glm::vec3 const& max, glm::vec3 const& origin, glm::vec3 const& inverse_direction, float max_distance)
+	{
+		auto const t0 = (min - origin) * inverse_direction;
+		auto const t1 = (max - origin) * inverse_direction;
+		auto const entries = glm::min(t0, t1);
+		auto const exits = glm::max(t0, t1);
+		auto const enter = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+		auto const exit = std::min(std::min(exits.x, exits.y), std::min(exits.z, max_distance));
+		return enter <= exit ? enter : -1.0f;
+	}
+
+	static bool overlaps(glm::vec3 const& min, glm::vec3 const& max, bonobo::bounding_sphere const& sphere)
+	{
+		auto const offset = glm::clamp(sphere.center, min, max) - sphere.center;
+		return glm::dot(offset, offset) <= sphere.radius * sphere.radius;
+	}
+
+	// Test a box against the planes whose bit is set in `planes`, and
+	// clear the bits of the planes the box is entirely in front of.
+	static bool classify(bonobo::frustum const& f, glm::vec3 const& min, glm::vec3 const& max, uint32_t& planes)
+	{
+		for (unsigned int p = 0u; p < bonobo::frustum::count; ++p) {
+			if ((planes & (1u << p)) == 0u)
+				continue;
+			auto const& plane = f.planes[p];
+			auto const normal = glm::vec3(plane);
+			auto const positive = glm::vec3(plane.x >= 0.0f ? max.x : min.x,
+			                                plane.y >= 0.0f ? max.y : min.y,
+			                                plane.z >= 0.0f ? max.z : min.z);
+			if (glm::dot(normal, positive) + plane.w < 0.0f)
+				return false;
+			auto const negative = min + max - positive;
+			if (glm::dot(normal, negative) + plane.w >= 0.0f)
+				planes &= ~(1u << p);
+		}
+		return true;
+	}
+
+	struct builder {
+		std::vector<bonobo::aabb> const& boxes;
+		std::vector<glm::vec3> const& centroids;
+		uint32_t* primitives;
+
+		// Append the subtree over primitives[begin, end) to `out`, in
+		// depth-first order and with right child indices relative to `out`.
+		void build(std::vector<bonobo::bvh::node>& out, uint32_t begin, uint32_t end, unsigned int depth) const
+		{
+			auto const index = out.size();
+			out.push_back(bonobo::bvh::node());
+
+			auto bounds = empty_box(), centroid_bounds = empty_box();
+			for (auto i = begin; i < end; ++i) {
+				grow(bounds, boxes[primitives[i]]);
+				grow(centroid_bounds, centroids[primitives[i]]);
+			}
+			out[index].min = bounds.min;
+			out[index].max = bounds.max;
+
+			auto const count = end - begin;
+			auto const make_leaf = [&out,index,begin,count](){
+				out[index].offset = begin;
+				out[index].count = count;
+			};
+			if (count == 1u || depth + 1u >= max_depth)
+				return make_leaf();
+
+			// Bin the centroids along each axis, and evaluate the SAH cost
+			// of splitting between every pair of consecutive bins.
+			auto best_cost = std::numeric_limits<float>::max();
+			int best_axis = -1;
+			size_t best_bin = 0u;
+			auto const extent = centroid_bounds.max - centroid_bounds.min;
+			for (int axis = 0; axis < 3; ++axis) {
+				if (extent[axis] <= 0.0f)
+					continue;
+
+				bonobo::aabb bin_boxes[bins_nb];
+				uint32_t bin_counts[bins_nb] = { 0u };
+				std::fill(std::begin(bin_boxes), std::end(bin_boxes), empty_box());
+				auto const scale = static_cast<float>(bins_nb) / extent[axis];
+				for (auto i = begin; i < end; ++i) {
+					auto const bin = std::min(bins_nb - 1u, static_cast<size_t>((centroids[primitives[i]][axis] - centroid_bounds.min[axis]) * scale));
+					grow(bin_boxes[bin], boxes[primitives[i]]);
+					++bin_counts[bin];
+				}
+
+				// right_areas[i] and right_counts[i] describe bins (i, bins_nb)
+				float right_areas[bins_nb - 1u];
+				uint32_t right_counts[bins_nb - 1u];
+				auto right_box = empty_box();
+				uint32_t right_count = 0u;
+				for (size_t i = bins_nb - 1u; i > 0u; --i) {
+					grow(right_box, bin_boxes[i]);
+					right_count += bin_counts[i];
+					right_areas[i - 1u] = right_count > 0u ? surface_area(right_box) : 0.0f;
+					right_counts[i - 1u] = right_count;
+				}
+
+				auto left_box = empty_box();
+				uint32_t left_count = 0u;
+				for (size_t i = 0u; i + 1u < bins_nb; ++i) {
+					grow(left_box, bin_boxes[i]);
+					left_count += bin_counts[i];
+					if (left_count == 0u || right_counts[i] == 0u)
+						continue;
+					auto const cost = surface_area(left_box) * static_cast<float>(left_count)
+					                + right_areas[i] * static_cast<float>(right_counts[i]);
+					if (cost < best_cost) {
+						best_cost = cost;
+						best_axis = axis;
+						best_bin = i;
+					}
+				}
+			}
+
+			uint32_t middle;
+			if (best_axis < 0) {
+				// All centroids coincide: no binning can separate them.
+				if (count <= max_leaf_size)
+					return make_leaf();
+				middle = begin + count / 2u;
+			} else {
+				auto const area = surface_area(bounds);
+				auto const split_cost = traversal_cost + (area > 0.0f ? best_cost / area : 0.0f);
+				if (count <= max_leaf_size && split_cost >= static_cast<float>(count))
+					return make_leaf();
+
+				auto const axis = best_axis;
+				auto const min = centroid_bounds.min[axis];
+				auto const scale = static_cast<float>(bins_nb) / extent[axis];
+				auto const split = std::partition(primitives + begin, primitives + end, [this,axis,min,scale,best_bin](uint32_t primitive){
+					return std::min(bins_nb - 1u, static_cast<size_t>((centroids[primitive][axis] - min) * scale)) <= best_bin;
+				});
+				middle = static_cast<uint32_t>(split - primitives);
+				if (middle == begin || middle == end)
+					middle = begin + count / 2u;
+			}
+
+			out[index].count = 0u;
+			if (count >= parallel_threshold) {
+				// Build the right subtree on its own, then append it with
+				// its child indices shifted.
+				auto right_nodes = std::vector<bonobo::bvh::node>();
+				utils::thread_pool::instance().parallel_for(2u, [this,&out,&right_nodes,begin,middle,end,depth](size_t i){
+					if (i == 0u)
+						build(out, begin, middle, depth + 1u);
+					else
+						build(right_nodes, middle, end, depth + 1u);
+				});
+				auto const right_index = static_cast<uint32_t>(out.size());
+				for (auto& node : right_nodes)
+					if (node.count == 0u)
+						node.offset += right_index;
+				out.insert(out.end(), right_nodes.begin(), right_nodes.end());
+				out[index].offset = right_index;
+			} else {
+				build(out, begin, middle, depth + 1u);
+				out[index].offset = static_cast<uint32_t>(out.size());
+				build(out, middle, end, depth + 1u);
+			}
+		}
+	};
+
+	static void build_tree(std::vector<bonobo::aabb> const& boxes, std::vector<uint32_t>& primitives, std::vector<bonobo::bvh::node>& nodes)
+	{
+		nodes.clear();
+		if (primitives.empty())
+			return;
+
+		auto centroids = std::vector<glm::vec3>(boxes.size());
+		for (auto const primitive : primitives)
+			centroids[primitive] = 0.5f * (boxes[primitive].min + boxes[primitive].max);
+
+		nodes.reserve(2u * primitives.size());
+		auto const context = builder{ boxes, centroids, primitives.data() };
+		context.build(nodes, 0u, static_cast<uint32_t>(primitives.size()), 0u);
+		nodes.shrink_to_fit();
+	}
+}
+
+bonobo::bvh::bvh() : _nodes(), _primitives(), _boxes(), _spheres(), _unbounded()
+{
+}
+
+void
+bonobo::bvh::build(std::vector<aabb> const& boxes)
+{
+	PROFILE_SCOPE("bvh::build");
+	_boxes = boxes;
+	_unbounded.clear();
+	_primitives.resize(boxes.size());
+	for (size_t i = 0u; i < _primitives.size(); ++i)
+		_primitives[i] = static_cast<uint32_t>(i);
+	local::build_tree(_boxes, _primitives, _nodes);
+
+	auto spheres = std::vector<bounding_sphere>(boxes.size());
+	for (size_t i = 0u; i < boxes.size(); ++i)
+		spheres[i] = local::enclosing_sphere(boxes[i]);
+	local::gather_spheres(spheres, _primitives, _spheres);
+}
+
+void
+bonobo::bvh::build(std::vector<Node> const& nodes)
+{
+	PROFILE_SCOPE("bvh::build");
+	_boxes.assign(nodes.size(), aabb());
+	auto spheres = std::vector<bounding_sphere>(nodes.size());
+	_unbounded.clear();
+	_primitives.clear();
+	for (size_t i = 0u; i < nodes.size(); ++i) {
+		auto const& node = nodes[i];
+		if (node.get_vao() == 0u)
+			continue;
+		if (node.get_bounding_sphere().radius < 0.0f) {
+			_unbounded.push_back(static_cast<uint32_t>(i));
+			continue;
+		}
+		_boxes[i] = transformBounds(node.get_bounds(), node.get_transform());
+		spheres[i] = transformBounds(node.get_bounding_sphere(), node.get_transform());
+		_primitives.push_back(static_cast<uint32_t>(i));
+	}
+	local::build_tree(_boxes, _primitives, _nodes);
+	local::gather_spheres(spheres, _primitives, _spheres);
+}
+
+bonobo::culling_stats
+bonobo::bvh::cull(frustum const& f, std::vector<uint32_t>& visible) const
+{
+	PROFILE_SCOPE("bvh::cull");
+	visible.assign(_unbounded.begin(), _unbounded.end());
+
+	struct entry {
+		uint32_t node;
+		uint32_t planes; // bit i set if the box still has to be tested against plane i
+	};
+	entry stack[local::max_depth + 1u];
+	size_t stack_size = 0u;
+	if (!_nodes.empty())
+		stack[stack_size++] = { 0u, local::all_planes };
+	auto leaf_visibility = std::vector<uint8_t>(local::max_leaf_size);
+
+	while (stack_size > 0u) {
+		auto const current = stack[--stack_size];
+		auto const& node = _nodes[current.node];
+
+		auto planes = current.planes;
+		if (!local::classify(f, node.min, node.max, planes))
+			continue;
+
+		if (node.count == 0u) {
+			stack[stack_size++] = { node.offset, planes };
+			stack[stack_size++] = { current.node + 1u, planes };
+		} else if (planes == 0u) {
+			visible.insert(visible.end(), _primitives.begin() + node.offset, _primitives.begin() + node.offset + node.count);
+		} else {
+			if (leaf_visibility.size() < node.count)
+				leaf_visibility.resize(node.count);
+			cullSpheres(f, _spheres.data() + node.offset, node.count, leaf_visibility.data());
+			for (uint32_t i = 0u; i < node.count; ++i) {
+				if (leaf_visibility[i] == 0u)
+					continue;
+				auto primitive_planes = planes;
+				auto const primitive = _primitives[node.offset + i];
+				auto const& box = _boxes[primitive];
+				if (local::classify(f, box.min, box.max, primitive_planes))
+					visible.push_back(primitive);
+			}
+		}
+	}
+
+	culling_stats stats;
+	stats.visible_nb = visible.size();
+	stats.culled_nb = _primitives.size() + _unbounded.size() - visible.size();
+	return stats;
+}
+
+bool
+bonobo::bvh::raycast(glm::vec3 const& origin, glm::vec3 const& direction, float max_distance, ray_hit& hit) const
+{
+	if (_nodes.empty())
+		return false;
+
+	auto const inverse_direction = 1.0f / direction;
+	auto closest = max_distance;
+	auto found = false;
+
+	uint32_t stack[local::max_depth + 1u];
+	size_t stack_size = 0u;
+	if (local::intersect(_nodes[0].min, _nodes[0].max, origin, inverse_direction, closest) >= 0.0f)
+		stack[stack_size++] = 0u;
+
+	while (stack_size > 0u) {
+		auto const& node = _nodes[stack[--stack_size]];
+
+		if (node.count > 0u) {
+			for (auto i = node.offset; i < node.offset + node.count; ++i) {
+				auto const primitive = _primitives[i];
+				auto const distance = local::intersect(_boxes[primitive].min, _boxes[primitive].max, origin, inverse_direction, closest);
+				if (distance >= 0.0f && (!found || distance < closest)) {
+					closest = distance;
+					hit.primitive = primitive;
+					hit.distance = distance;
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearest child first, so that it can shorten the ray
+		// before the other one is tested again.
+		auto const left = static_cast<uint32_t>(&node - _nodes.data()) + 1u;
+		auto const right = node.offset;
+		auto const left_distance = local::intersect(_nodes[left].min, _nodes[left].max, origin, inverse_direction, closest);
+		auto const right_distance = local::intersect(_nodes[right].min, _nodes[right].max, origin, inverse_direction, closest);
+		auto const left_first = left_distance >= 0.0f && (right_distance < 0.0f || left_distance <= right_distance);
+		if (left_first) {
+			if (right_distance >= 0.0f)
+				stack[stack_size++] = right;
+			stack[stack_size++] = left;
+		} else {
+			if (left_distance >= 0.0f)
+				stack[stack_size++] = left;
+			if (right_distance >= 0.0f)
+				stack[stack_size++] = right;
+		}
+	}
+
+	return found;
+}
+
+void
+bonobo::bvh::query(bounding_sphere const& sphere, std::vector<uint32_t>& overlapping) const
+{
+	overlapping.assign(_unbounded.begin(), _unbounded.end());
+	if (_nodes.empty() || sphere.radius < 0.0f)
+		return;
+
+	uint32_t stack[local::max_depth + 1u];
+	size_t stack_size = 0u;
+	stack[stack_size++] = 0u;
+
+	while (stack_size > 0u) {
+		auto const index = stack[--stack_size];
+		auto const& node = _nodes[index];
+		if (!local::overlaps(node.min, node.max, sphere))
+			continue;
+
+		if (node.count > 0u) {
+			for (auto i = node.offset; i < node.offset + node.count; ++i)
+				if (local::overlaps(_boxes[_primitives[i]].min, _boxes[_primitives[i]].max, sphere))
+					overlapping.push_back(_primitives[i]);
+		} else {
+			stack[stack_size++] = node.offset;
+			stack[stack_size++] = index + 1u;
+		}
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "core/bounds.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class Node;
+
+namespace bonobo
+{
+	//! \brief Bounding volume hierarchy over static geometry.
+	//!
+	//! The tree is built once, top-down, by binning the primitives along
+	//! each axis and keeping the split of lowest surface area heuristic
+	//! (SAH) cost; large subtrees are built in parallel on
+	//! `utils::thread_pool::instance()`. It is then stored as a flat array
+	//! in depth-first order: the left child of an inner node directly
+	//! follows it, and the primitives of any subtree are contiguous.
+	//!
+	//! Queries return indices of the primitives, i.e. indices into the
+	//! vector the hierarchy was built from. They only test bounding boxes,
+	//! not the triangles inside them.
+	class bvh
+	{
+	public:
+		//! \brief Node of the flattened tree (32 bytes).
+		struct node {
+			glm::vec3 min;
+			uint32_t offset;   //!< index of the right child for inner nodes, of the first entry in the primitive list for leaves
+			glm::vec3 max;
+			uint32_t count;    //!< number of primitives of a leaf, 0 for inner nodes
+		};
+
+		//! \brief Closest primitive hit by a ray.
+		struct ray_hit {
+			uint32_t primitive; //!< index of the primitive
+			float distance;     //!< distance along the ray to where it enters the box of the primitive, 0 if it starts inside
+		};
+
+		//! \brief Create an empty hierarchy, for which all queries return
+		//!        nothing.
+		bvh();
+
+		//! \brief Build the hierarchy over world-space boxes, replacing
+		//!        any previous content.
+		//!
+		//! @param [in] boxes one box per primitive
+		void build(std::vector<aabb> const& boxes);
+
+		//! \brief Build the hierarchy over scene nodes, replacing any
+		//!        previous content.
+		//!
+		//! Each node is bounded by its geometry placed with its own
+		//! transform; nodes are assumed not to move afterwards. Nodes
+		//! without geometry are left out, and nodes with unknown bounds
+		//! are returned by every frustum and sphere query.
+		//!
+		//! @param [in] nodes nodes to index; children are not visited
+		void build(std::vector<Node> const& nodes);
+
+		//! \brief Gather the primitives whose box may be seen through a
+		//!        frustum.
+		//!
+		//! Subtrees entirely inside the frustum are gathered without any
+		//! further test, and subtrees entirely outside are skipped, so
+		//! the cost grows with the number of visible primitives and the
+		//! logarithm of the total, rather than with the total. The
+		//! primitives of leaves straddling the frustum are tested by their
+		//! bounding sphere with `cullSpheres()`, then by their box.
+		//!
+		//! @param [in] f world-space frustum to test against
+		//! @param [out] visible cleared, then filled with the indices of
+		//!              the primitives kept, in no particular order
+		//! @return how many primitives were kept and rejected
+		culling_stats cull(frustum const& f, std::vector<uint32_t>& visible) const;
+
+		//! \brief Find the first primitive whose box a ray goes through.
+		//!
+		//! @param [in] origin world-space start of the ray
+		//! @param [in] direction world-space direction of the ray; it
+		//!             needs not be normalised, distances are then
+		//!             expressed in multiples of its length
+		//! @param [in] max_distance ignore hits further than this
+		//! @param [out] hit closest hit, only written if there is one
+		//! @return whether any primitive was hit
+		bool raycast(glm::vec3 const& origin, glm::vec3 const& direction,
+		             float max_distance, ray_hit& hit) const;
+
+		//! \brief Gather the primitives whose box overlaps a sphere.
+		//!
+		//! @param [in] sphere world-space sphere to test against
+		//! @param [out] overlapping cleared, then filled with the indices
+		//!              of the primitives found, in no particular order
+		void query(bounding_sphere const& sphere, std::vector<uint32_t>& overlapping) const;
+
+		//! \brief Number of primitives indexed by the tree.
+		size_t get_primitives_nb() const { return _primitives.size(); }
+
+		//! \brief Number of nodes of the tree.
+		size_t get_nodes_nb() const { return _nodes.size(); }
+
+		//! \brief Nodes of the tree, the root being the first one.
+		std::vector<node> const& get_nodes() const { return _nodes; }
+
+	private:
+		std::vector<node> _nodes;
+		std::vector<uint32_t> _primitives;  // primitive indices, in leaf order
+		std::vector<aabb> _boxes;           // box of each primitive, by primitive index
+		std::vector<bounding_sphere> _spheres; // sphere of each primitive, in leaf order
+		std::vector<uint32_t> _unbounded;   // primitives returned by every frustum and sphere query
+	};
+}
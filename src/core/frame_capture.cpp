@@ -0,0 +1,236 @@
+#include "frame_capture.hpp"
+
+#include "core/gl_state.hpp"
+#include "core/Log.h"
+#include "core/Profiler.h"
+#include "core/thread_pool.hpp"
+#include "external/lodepng.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+// Shared with the workers, which can outlive the capture object if they
+// are still encoding when it is destroyed.
+struct bonobo::frame_capture::shared_state {
+	std::mutex mutex;
+	std::condition_variable encoded;
+	size_t pending_encodes_nb = 0u;
+	std::vector<std::vector<std::uint8_t>> free_buffers;
+	std::vector<std::string> errors; //!< reported by the main thread, as logging is not thread-safe
+};
+
+namespace local
+{
+	constexpr GLuint64 fence_timeout_ns = 1000000000u;
+
+	static std::string frame_path(std::string const& prefix, size_t index)
+	{
+		char suffix[32];
+		std::snprintf(suffix, sizeof(suffix), "_%06zu.png", index);
+		return prefix + suffix;
+	}
+
+	// OpenGL rows go upwards, PNG ones downwards; alpha is dropped, as the
+	// default framebuffer's is usually meaningless.
+	static void encode(std::vector<std::uint8_t> const& rgba, unsigned int width, unsigned int height,
+	                   std::string const& path, std::string& error)
+	{
+		auto rgb = std::vector<unsigned char>(static_cast<size_t>(width) * height * 3u);
+		for (unsigned int y = 0u; y < height; ++y) {
+			auto src = rgba.data() + static_cast<size_t>(height - 1u - y) * width * 4u;
+			auto dst = rgb.data() + static_cast<size_t>(y) * width * 3u;
+			for (unsigned int x = 0u; x < width; ++x, src += 4, dst += 3) {
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+			}
+		}
+
+		// Skip lodepng's search for a smaller colour type, which scans the
+		// whole image and rarely pays off on rendered frames.
+		lodepng::State state;
+		state.info_raw.colortype = LCT_RGB;
+		state.info_raw.bitdepth = 8u;
+		state.info_png.color.colortype = LCT_RGB;
+		state.info_png.color.bitdepth = 8u;
+		state.encoder.auto_convert = LAC_NO;
+
+		auto png = std::vector<unsigned char>();
+		auto const result = lodepng::encode(png, rgb, width, height, state);
+		if (result != 0u) {
+			error = "Failed to encode \"" + path + "\": " + lodepng_error_text(result);
+			return;
+		}
+		if (lodepng_save_file(png.data(), png.size(), path.c_str()) != 0u)
+			error = "Failed to write \"" + path + "\"";
+	}
+}
+
+bonobo::frame_capture::frame_capture(std::string const& prefix, size_t frames_in_flight) : _prefix(prefix), _slots(std::max<size_t>(frames_in_flight, 1u)), _next(0u), _max_pending_encodes_nb(0u), _state(std::make_shared<shared_state>()), _captured_frames_nb(0u), _stalls_nb(0u)
+{
+	// Enough frames for every worker, and as many again waiting, so
+	// that workers never run out while the GPU is ahead.
+	_max_pending_encodes_nb = 2u * std::max<size_t>(utils::thread_pool::instance().threads_nb(), 1u);
+
+	for (auto& s : _slots) {
+		s = slot{ 0u, 0, nullptr, 0, 0, 0u };
+		glGenBuffers(1, &s.buffer);
+	}
+}
+
+bonobo::frame_capture::~frame_capture()
+{
+	flush();
+	for (auto& s : _slots)
+		glDeleteBuffers(1, &s.buffer);
+}
+
+void
+bonobo::frame_capture::capture(GLsizei width, GLsizei height, GLuint fbo, GLenum attachment)
+{
+	if (width <= 0 || height <= 0)
+		return;
+	PROFILE_SCOPE("frame_capture::capture");
+
+	update();
+	auto& s = _slots[_next];
+	read_back(s, true);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+	auto const size = static_cast<GLsizeiptr>(width) * height * 4;
+	if (size > s.capacity) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+		s.capacity = size;
+	}
+
+	bonobo::gl_state::bindFramebuffer(fbo);
+	if (fbo != 0u)
+		glReadBuffer(attachment);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0u);
+
+	s.width = width;
+	s.height = height;
+	s.index = _captured_frames_nb++;
+	_next = (_next + 1u) % _slots.size();
+}
+
+void
+bonobo::frame_capture::update()
+{
+	// Oldest first: fences are signalled in order, so stop at the first
+	// copy still pending.
+	for (size_t i = 0u; i < _slots.size(); ++i) {
+		auto& s = _slots[(_next + i) % _slots.size()];
+		if (s.fence == nullptr)
+			continue;
+		read_back(s, false);
+		if (s.fence != nullptr)
+			break;
+	}
+	report_errors();
+}
+
+void
+bonobo::frame_capture::flush()
+{
+	for (size_t i = 0u; i < _slots.size(); ++i)
+		read_back(_slots[(_next + i) % _slots.size()], true);
+
+	{
+		std::unique_lock<std::mutex> lock(_state->mutex);
+		_state->encoded.wait(lock, [this](){ return _state->pending_encodes_nb == 0u; });
+	}
+	report_errors();
+}
+
+void
+bonobo::frame_capture::read_back(slot& s, bool wait)
+{
+	if (s.fence == nullptr)
+		return;
+
+	auto status = glClientWaitSync(s.fence, 0, 0u);
+	if (status == GL_TIMEOUT_EXPIRED) {
+		if (!wait)
+			return;
+		++_stalls_nb;
+		do {
+			status = glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, local::fence_timeout_ns);
+		} while (status == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(s.fence);
+	s.fence = nullptr;
+	if (status == GL_WAIT_FAILED) {
+		LogError("Failed to wait for frame %zu to be copied", s.index);
+		return;
+	}
+
+	auto pixels = std::vector<std::uint8_t>();
+	{
+		std::unique_lock<std::mutex> lock(_state->mutex);
+		if (_state->pending_encodes_nb >= _max_pending_encodes_nb) {
+			++_stalls_nb;
+			_state->encoded.wait(lock, [this](){ return _state->pending_encodes_nb < _max_pending_encodes_nb; });
+		}
+		++_state->pending_encodes_nb;
+		if (!_state->free_buffers.empty()) {
+			pixels = std::move(_state->free_buffers.back());
+			_state->free_buffers.pop_back();
+		}
+	}
+
+	auto const size = static_cast<size_t>(s.width) * static_cast<size_t>(s.height) * 4u;
+	pixels.resize(size);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, s.buffer);
+	auto const mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_READ_BIT);
+	if (mapped != nullptr) {
+		std::memcpy(pixels.data(), mapped, size);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0u);
+
+	auto state = _state;
+	if (mapped == nullptr) {
+		LogError("Failed to map the pixels of frame %zu", s.index);
+		std::lock_guard<std::mutex> lock(state->mutex);
+		--state->pending_encodes_nb;
+		state->free_buffers.push_back(std::move(pixels));
+		return;
+	}
+
+	auto const width = static_cast<unsigned int>(s.width);
+	auto const height = static_cast<unsigned int>(s.height);
+	auto path = local::frame_path(_prefix, s.index);
+	// std::function requires copyable tasks, hence the buffer being
+	// shared rather than moved in.
+	auto buffer = std::make_shared<std::vector<std::uint8_t>>(std::move(pixels));
+	utils::thread_pool::instance().submit([state, buffer, width, height, path](){
+		auto error = std::string();
+		local::encode(*buffer, width, height, path, error);
+
+		std::lock_guard<std::mutex> lock(state->mutex);
+		if (!error.empty())
+			state->errors.push_back(std::move(error));
+		state->free_buffers.push_back(std::move(*buffer));
+		--state->pending_encodes_nb;
+		state->encoded.notify_all();
+	});
+}
+
+void
+bonobo::frame_capture::report_errors()
+{
+	auto errors = std::vector<std::string>();
+	{
+		std::lock_guard<std::mutex> lock(_state->mutex);
+		errors.swap(_state->errors);
+	}
+	for (auto const& error : errors)
+		LogError("%s", error.c_str());
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Saves rendered frames as PNG files without stalling the
+	//!        rendering.
+	//!
+	//! Each capture copies a framebuffer into one of a ring of pixel
+	//! buffer objects, and places a fence behind the copy. The pixels are
+	//! only mapped a few frames later, once the fence is signalled, then
+	//! copied to a recycled buffer and handed over to
+	//! `utils::thread_pool::instance()`, whose workers flip and PNG-encode
+	//! them. The main thread only waits when the ring wraps around onto a
+	//! copy the GPU has not finished yet, or when the workers fall too far
+	//! behind.
+	//!
+	//! Frames are written to `<prefix>_<index>.png`, the index counting
+	//! captures from 0 and padded to six digits.
+	class frame_capture
+	{
+	public:
+		//! \brief Create the pixel buffers; requires a current OpenGL
+		//!        context.
+		//!
+		//! @param [in] prefix of the files written, which can include
+		//!             directories, as long as they exist
+		//! @param [in] frames_in_flight number of captures issued before
+		//!             the oldest one is read back
+		frame_capture(std::string const& prefix, size_t frames_in_flight = 3u);
+
+		//! \brief Write all pending captures, see `flush()`.
+		~frame_capture();
+
+		frame_capture(frame_capture const&) = delete;
+		frame_capture& operator=(frame_capture const&) = delete;
+
+		//! \brief Queue a copy of a framebuffer's colour attachment.
+		//!
+		//! Framebuffer bindings are changed through `bonobo::gl_state`.
+		//!
+		//! @param [in] width of the area to capture, from the lower left
+		//!             corner
+		//! @param [in] height of the area to capture
+		//! @param [in] fbo to read from, as returned by
+		//!             `bonobo::createFBO()`, or 0 for the default
+		//!             framebuffer, in which case its current read buffer
+		//!             is used
+		//! @param [in] attachment of `fbo` to read from
+		void capture(GLsizei width, GLsizei height, GLuint fbo = 0u,
+		             GLenum attachment = GL_COLOR_ATTACHMENT0);
+
+		//! \brief Read back the captures the GPU is done with, without
+		//!        waiting; also done by `capture()`.
+		void update();
+
+		//! \brief Wait for all captures to be read back and written.
+		void flush();
+
+		//! \brief Number of captures issued so far.
+		size_t get_captured_frames_nb() const { return _captured_frames_nb; }
+
+		//! \brief Number of times the main thread had to wait, for the
+		//!        GPU or for the workers.
+		size_t get_stalls_nb() const { return _stalls_nb; }
+
+	private:
+		struct slot {
+			GLuint buffer;
+			GLsizeiptr capacity;
+			GLsync fence;          //!< non-null while the copy is pending
+			GLsizei width;
+			GLsizei height;
+			size_t index;
+		};
+
+		struct shared_state;
+
+		void read_back(slot& s, bool wait);
+		void report_errors();
+
+		std::string _prefix;
+		std::vector<slot> _slots;
+		size_t _next;
+		size_t _max_pending_encodes_nb;
+		std::shared_ptr<shared_state> _state;
+
+		size_t _captured_frames_nb;
+		size_t _stalls_nb;
+	};
+}
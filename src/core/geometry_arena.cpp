@@ -0,0 +1,116 @@
+#include "geometry_arena.hpp"
+
+#include "core/gl_state.hpp"
+#include "core/Log.h"
+#include "core/vertex_format.hpp"
+
+#include <cassert>
+#include <map>
+#include <utility>
+
+bonobo::geometry_arena::geometry_arena() : _pools(), _stats()
+{
+}
+
+bonobo::geometry_arena::~geometry_arena()
+{
+	for (auto& pool : _pools) {
+		glDeleteVertexArrays(1, &pool.vao);
+		glDeleteBuffers(1, &pool.bo);
+		glDeleteBuffers(1, &pool.ibo);
+	}
+	gl_state::invalidate();
+}
+
+void
+bonobo::geometry_arena::add(std::vector<mesh_data>& meshes)
+{
+	// Meshes can only share a VAO if their attributes are laid out the
+	// same way, and an index buffer if their indices have the same type.
+	auto layouts = std::map<std::pair<uint32_t, GLenum>, std::vector<mesh_data*>>();
+	for (auto& mesh : meshes) {
+		if (mesh.format != vertex_format::interleaved_packed || mesh.ibo == 0u || mesh.bo == 0u)
+			continue;
+		layouts[std::make_pair(mesh.attributes, mesh.index_type)].push_back(&mesh);
+	}
+
+	for (auto const& layout : layouts) {
+		auto const attributes = layout.first.first;
+		auto const& pool_meshes = layout.second;
+		auto const vertex_size = vertexSize(vertex_format::interleaved_packed, attributes);
+		auto const index_size = indexSize(layout.first.second);
+
+		size_t vertices_nb = 0u, indices_nb = 0u;
+		for (auto const mesh : pool_meshes) {
+			vertices_nb += mesh->vertices_nb;
+			indices_nb += indexBufferLength(*mesh);
+		}
+
+		pool p;
+		glGenVertexArrays(1, &p.vao);
+		assert(p.vao != 0u);
+		glBindVertexArray(p.vao);
+
+		glGenBuffers(1, &p.bo);
+		assert(p.bo != 0u);
+		glBindBuffer(GL_ARRAY_BUFFER, p.bo);
+		glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(vertices_nb * vertex_size), nullptr, GL_STATIC_DRAW);
+		setVertexAttribPointers(vertex_format::interleaved_packed, attributes, vertices_nb);
+		glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+		glGenBuffers(1, &p.ibo);
+		assert(p.ibo != 0u);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p.ibo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices_nb * index_size), nullptr, GL_STATIC_DRAW);
+
+		glBindVertexArray(0u);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+
+		// Indices are kept relative to their own mesh: the base vertex
+		// takes care of the offset when drawing.
+		size_t vertex_offset = 0u, index_offset = 0u;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, p.bo);
+		for (auto const mesh : pool_meshes) {
+			glBindBuffer(GL_COPY_READ_BUFFER, mesh->bo);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+			                    static_cast<GLintptr>(vertex_offset * vertex_size),
+			                    static_cast<GLsizeiptr>(mesh->vertices_nb * vertex_size));
+			mesh->base_vertex = static_cast<GLint>(vertex_offset);
+			vertex_offset += mesh->vertices_nb;
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, p.ibo);
+		for (auto const mesh : pool_meshes) {
+			glBindBuffer(GL_COPY_READ_BUFFER, mesh->ibo);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0,
+			                    static_cast<GLintptr>(index_offset * index_size),
+			                    static_cast<GLsizeiptr>(indexBufferLength(*mesh) * index_size));
+			mesh->first_index = index_offset;
+			index_offset += indexBufferLength(*mesh);
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+
+		for (auto const mesh : pool_meshes) {
+			glDeleteVertexArrays(1, &mesh->vao);
+			glDeleteBuffers(1, &mesh->bo);
+			glDeleteBuffers(1, &mesh->ibo);
+			mesh->vao = p.vao;
+			mesh->bo = p.bo;
+			mesh->ibo = p.ibo;
+		}
+
+		_pools.push_back(p);
+		_stats.meshes_nb += pool_meshes.size();
+		_stats.vertex_bytes += vertices_nb * vertex_size;
+		_stats.index_bytes += indices_nb * index_size;
+	}
+	_stats.pools_nb = _pools.size();
+
+	// VAOs were bound, and deleted, without going through gl_state.
+	gl_state::invalidate();
+
+	LogInfo("Geometry arena: %u meshes in %u pools, %.1f MiB of vertices and %.1f MiB of indices",
+	        static_cast<unsigned int>(_stats.meshes_nb), static_cast<unsigned int>(_stats.pools_nb),
+	        static_cast<double>(_stats.vertex_bytes) / (1024.0 * 1024.0),
+	        static_cast<double>(_stats.index_bytes) / (1024.0 * 1024.0));
+}
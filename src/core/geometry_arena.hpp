@@ -0,0 +1,66 @@
+#pragma once
+
+#include "core/helpers.hpp"
+
+#include "external/glad/glad.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Large vertex and index buffers shared by many static meshes.
+	//!
+	//! Meshes added to the arena have their data copied, on the GPU, into
+	//! one pool per vertex layout and index type; their own buffers and VAO are then
+	//! deleted and replaced by those of the pool, along with the base
+	//! vertex and first index locating them inside it. Meshes of a pool
+	//! therefore share all their geometry state, and `bonobo::render_queue`
+	//! can draw runs of them with a single `glMultiDrawElementsBaseVertex()`.
+	//!
+	//! The arena owns the pools: it must outlive every mesh and node using
+	//! them.
+	class geometry_arena
+	{
+	public:
+		//! \brief Occupancy of the arena.
+		struct stats {
+			size_t meshes_nb;    //!< meshes moved into the arena
+			size_t pools_nb;     //!< VAOs, each with one vertex and one index buffer
+			size_t vertex_bytes; //!< size of all vertex buffers
+			size_t index_bytes;  //!< size of all index buffers
+		};
+
+		geometry_arena();
+		~geometry_arena();
+
+		geometry_arena(geometry_arena const&) = delete;
+		geometry_arena& operator=(geometry_arena const&) = delete;
+
+		//! \brief Move meshes into the arena.
+		//!
+		//! Only indexed meshes using `vertex_format::interleaved_packed`
+		//! can share buffers, as the attributes of planar meshes are
+		//! located relative to their own vertex count; other meshes are
+		//! left untouched. Each call creates new pools, so meshes should
+		//! be added in as few calls as possible.
+		//!
+		//! @param [in,out] meshes meshes whose `vao`, `bo`, `ibo`,
+		//!                 `first_index` and `base_vertex` get rewritten
+		void add(std::vector<mesh_data>& meshes);
+
+		//! \brief Get the occupancy of the arena.
+		stats const& get_stats() const { return _stats; }
+
+	private:
+		struct pool {
+			GLuint vao;
+			GLuint bo;
+			GLuint ibo;
+		};
+
+		std::vector<pool> _pools;
+		stats _stats;
+	};
+}
@@ -0,0 +1,284 @@
+#include "gl_state.hpp"
+
+#include <numeric>
+
+namespace local
+{
+	// Values no OpenGL name or enum takes, marking state not known.
+	constexpr GLuint unknown_name = 0xffffffffu;
+	constexpr GLenum unknown_enum = 0xffffffffu;
+	constexpr int unknown_flag = -1;
+
+	constexpr size_t tracked_units_nb = 32u;
+
+	enum tracked_target : unsigned int {
+		texture_2d = 0u,
+		texture_cube_map,
+		tracked_targets_nb
+	};
+
+	struct state {
+		GLuint program;
+		GLuint vao;
+		GLenum active_texture;
+		GLuint textures[tracked_units_nb][tracked_targets_nb];
+		GLuint samplers[tracked_units_nb];
+		GLuint framebuffer;
+		int blend;
+		int cull_face_enabled;
+		int depth_test;
+		int primitive_restart;
+		GLuint primitive_restart_index;
+		GLenum depth_func;
+		int depth_mask;
+		GLenum blend_equation[2];
+		GLenum blend_func[4];
+		GLenum cull_face;
+	};
+
+	static state current;
+	static bonobo::gl_state::stats frame_stats = {};
+	static bonobo::gl_state::stats last_frame_stats = {};
+
+	// Record a call and tell whether it has to be forwarded.
+	template<typename T>
+	static bool update(bonobo::gl_state::call kind, T& cached, T value)
+	{
+		auto const index = static_cast<size_t>(kind);
+		if (cached == value) {
+			++frame_stats.skipped[index];
+			return false;
+		}
+		cached = value;
+		++frame_stats.issued[index];
+		return true;
+	}
+
+	static void forward(bonobo::gl_state::call kind)
+	{
+		++frame_stats.issued[static_cast<size_t>(kind)];
+	}
+
+	static int* capability_flag(GLenum capability)
+	{
+		switch (capability) {
+			case GL_BLEND:             return &current.blend;
+			case GL_CULL_FACE:         return &current.cull_face_enabled;
+			case GL_DEPTH_TEST:        return &current.depth_test;
+			case GL_PRIMITIVE_RESTART: return &current.primitive_restart;
+			default:                   return nullptr;
+		}
+	}
+
+	static bool reset()
+	{
+		current.program = unknown_name;
+		current.vao = unknown_name;
+		current.active_texture = unknown_enum;
+		for (auto& unit : current.textures)
+			for (auto& texture : unit)
+				texture = unknown_name;
+		for (auto& sampler : current.samplers)
+			sampler = unknown_name;
+		current.framebuffer = unknown_name;
+		current.blend = unknown_flag;
+		current.cull_face_enabled = unknown_flag;
+		current.depth_test = unknown_flag;
+		current.primitive_restart = unknown_flag;
+		current.primitive_restart_index = unknown_name;
+		current.depth_func = unknown_enum;
+		current.depth_mask = unknown_flag;
+		for (auto& mode : current.blend_equation)
+			mode = unknown_enum;
+		for (auto& factor : current.blend_func)
+			factor = unknown_enum;
+		current.cull_face = unknown_enum;
+		return true;
+	}
+
+	static bool const initialised = reset();
+}
+
+size_t
+bonobo::gl_state::stats::total_issued() const
+{
+	return std::accumulate(issued.begin(), issued.end(), size_t(0u));
+}
+
+size_t
+bonobo::gl_state::stats::total_skipped() const
+{
+	return std::accumulate(skipped.begin(), skipped.end(), size_t(0u));
+}
+
+void
+bonobo::gl_state::invalidate()
+{
+	local::reset();
+}
+
+void
+bonobo::gl_state::newFrame()
+{
+	local::last_frame_stats = local::frame_stats;
+	local::frame_stats = {};
+}
+
+bonobo::gl_state::stats const&
+bonobo::gl_state::getLastFrameStats()
+{
+	return local::last_frame_stats;
+}
+
+char const*
+bonobo::gl_state::getCallName(call kind)
+{
+	switch (kind) {
+		case call::program:           return "program";
+		case call::vertex_array:      return "vertex array";
+		case call::active_texture:    return "active texture";
+		case call::texture:           return "texture";
+		case call::sampler:           return "sampler";
+		case call::framebuffer:       return "framebuffer";
+		case call::capability:        return "enable/disable";
+		case call::depth:             return "depth";
+		case call::blend:             return "blend";
+		case call::cull_face:         return "cull face";
+		case call::primitive_restart: return "restart index";
+		default:                      return "unknown";
+	}
+}
+
+void
+bonobo::gl_state::useProgram(GLuint program)
+{
+	if (local::update(call::program, local::current.program, program))
+		glUseProgram(program);
+}
+
+void
+bonobo::gl_state::bindVertexArray(GLuint vao)
+{
+	if (local::update(call::vertex_array, local::current.vao, vao))
+		glBindVertexArray(vao);
+}
+
+void
+bonobo::gl_state::bindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+	auto const tracked_target = target == GL_TEXTURE_2D ? local::texture_2d
+	                          : target == GL_TEXTURE_CUBE_MAP ? local::texture_cube_map
+	                          : local::tracked_targets_nb;
+	if (unit < local::tracked_units_nb && tracked_target != local::tracked_targets_nb
+	 && local::current.textures[unit][tracked_target] == texture) {
+		++local::frame_stats.skipped[static_cast<size_t>(call::texture)];
+		return;
+	}
+
+	if (local::update(call::active_texture, local::current.active_texture, static_cast<GLenum>(GL_TEXTURE0 + unit)))
+		glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(target, texture);
+	local::forward(call::texture);
+	if (unit < local::tracked_units_nb && tracked_target != local::tracked_targets_nb)
+		local::current.textures[unit][tracked_target] = texture;
+}
+
+void
+bonobo::gl_state::bindSampler(GLuint unit, GLuint sampler)
+{
+	if (unit >= local::tracked_units_nb) {
+		glBindSampler(unit, sampler);
+		local::forward(call::sampler);
+		return;
+	}
+	if (local::update(call::sampler, local::current.samplers[unit], sampler))
+		glBindSampler(unit, sampler);
+}
+
+void
+bonobo::gl_state::bindFramebuffer(GLuint fbo)
+{
+	if (local::update(call::framebuffer, local::current.framebuffer, fbo))
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+}
+
+void
+bonobo::gl_state::setEnabled(GLenum capability, bool enabled)
+{
+	auto const flag = local::capability_flag(capability);
+	if (flag == nullptr)
+		local::forward(call::capability);
+	else if (!local::update(call::capability, *flag, enabled ? 1 : 0))
+		return;
+
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+}
+
+void
+bonobo::gl_state::depthFunc(GLenum func)
+{
+	if (local::update(call::depth, local::current.depth_func, func))
+		glDepthFunc(func);
+}
+
+void
+bonobo::gl_state::depthMask(GLboolean mask)
+{
+	if (local::update(call::depth, local::current.depth_mask, mask != GL_FALSE ? 1 : 0))
+		glDepthMask(mask);
+}
+
+void
+bonobo::gl_state::blendEquationSeparate(GLenum rgb_mode, GLenum alpha_mode)
+{
+	auto& cached = local::current.blend_equation;
+	if (cached[0] == rgb_mode && cached[1] == alpha_mode) {
+		++local::frame_stats.skipped[static_cast<size_t>(call::blend)];
+		return;
+	}
+	cached[0] = rgb_mode;
+	cached[1] = alpha_mode;
+	local::forward(call::blend);
+	glBlendEquationSeparate(rgb_mode, alpha_mode);
+}
+
+void
+bonobo::gl_state::blendFuncSeparate(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha)
+{
+	auto& cached = local::current.blend_func;
+	if (cached[0] == src_rgb && cached[1] == dst_rgb && cached[2] == src_alpha && cached[3] == dst_alpha) {
+		++local::frame_stats.skipped[static_cast<size_t>(call::blend)];
+		return;
+	}
+	cached[0] = src_rgb;
+	cached[1] = dst_rgb;
+	cached[2] = src_alpha;
+	cached[3] = dst_alpha;
+	local::forward(call::blend);
+	glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+}
+
+void
+bonobo::gl_state::cullFace(GLenum mode)
+{
+	if (local::update(call::cull_face, local::current.cull_face, mode))
+		glCullFace(mode);
+}
+
+void
+bonobo::gl_state::primitiveRestart(GLenum drawing_mode, GLenum index_type)
+{
+	auto const restartable = drawing_mode == GL_TRIANGLE_STRIP || drawing_mode == GL_TRIANGLE_FAN
+	                      || drawing_mode == GL_LINE_STRIP || drawing_mode == GL_LINE_LOOP;
+	setEnabled(GL_PRIMITIVE_RESTART, restartable);
+	if (!restartable)
+		return;
+	auto const index = index_type == GL_UNSIGNED_BYTE ? 0xffu
+	                 : index_type == GL_UNSIGNED_SHORT ? 0xffffu
+	                 : 0xffffffffu;
+	if (local::update(call::primitive_restart, local::current.primitive_restart_index, static_cast<GLuint>(index)))
+		glPrimitiveRestartIndex(index);
+}
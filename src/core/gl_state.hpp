@@ -0,0 +1,96 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <array>
+#include <cstddef>
+
+namespace bonobo
+{
+	//! \brief Shadow copy of the OpenGL state most often changed while
+	//!        rendering, so that calls setting a value which is already
+	//!        current can be skipped.
+	//!
+	//! The copy is only correct as long as the tracked state is changed
+	//! through these functions. Code calling OpenGL directly for any of
+	//! it, such as the creation of meshes, textures or framebuffers, has
+	//! to call `invalidate()` once it is done, so that the next call goes
+	//! through regardless.
+	//!
+	//! Like OpenGL itself, this is only meant to be used from the thread
+	//! owning the context.
+	namespace gl_state
+	{
+		//! \brief Kinds of calls being tracked.
+		enum class call : unsigned int {
+			program = 0u,  //!< glUseProgram()
+			vertex_array,  //!< glBindVertexArray()
+			active_texture,//!< glActiveTexture()
+			texture,       //!< glBindTexture()
+			sampler,       //!< glBindSampler()
+			framebuffer,   //!< glBindFramebuffer()
+			capability,    //!< glEnable() and glDisable()
+			depth,         //!< glDepthFunc() and glDepthMask()
+			blend,         //!< glBlendEquationSeparate() and glBlendFuncSeparate()
+			cull_face,     //!< glCullFace()
+			primitive_restart, //!< glPrimitiveRestartIndex()
+			count
+		};
+
+		//! \brief Number of calls forwarded to OpenGL and of calls skipped,
+		//!        per kind of call.
+		struct stats {
+			std::array<size_t, static_cast<size_t>(call::count)> issued;
+			std::array<size_t, static_cast<size_t>(call::count)> skipped;
+
+			size_t total_issued() const;
+			size_t total_skipped() const;
+		};
+
+		//! \brief Forget everything known about the current state.
+		void invalidate();
+
+		//! \brief Start counting calls for a new frame; the counts of the
+		//!        frame that just ended remain available through
+		//!        `getLastFrameStats()`.
+		void newFrame();
+
+		//! \brief Counts for the last frame ended by `newFrame()`.
+		stats const& getLastFrameStats();
+
+		//! \brief Name of a kind of call, for display.
+		char const* getCallName(call kind);
+
+		void useProgram(GLuint program);
+		void bindVertexArray(GLuint vao);
+
+		//! \brief Bind a texture to a given texture unit, making that unit
+		//!        active if needed.
+		void bindTexture(GLuint unit, GLenum target, GLuint texture);
+		void bindSampler(GLuint unit, GLuint sampler);
+
+		//! \brief Bind a framebuffer to both GL_DRAW_FRAMEBUFFER and
+		//!        GL_READ_FRAMEBUFFER, like `glBindFramebuffer(GL_FRAMEBUFFER, fbo)`.
+		void bindFramebuffer(GLuint fbo);
+
+		//! \brief glEnable() or glDisable() a capability; GL_BLEND,
+		//!        GL_CULL_FACE, GL_DEPTH_TEST and GL_PRIMITIVE_RESTART are
+		//!        tracked, others are always forwarded.
+		void setEnabled(GLenum capability, bool enabled);
+		void depthFunc(GLenum func);
+		void depthMask(GLboolean mask);
+		void blendEquationSeparate(GLenum rgb_mode, GLenum alpha_mode);
+		void blendFuncSeparate(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha);
+		void cullFace(GLenum mode);
+
+		//! \brief Enable primitive restart on the largest value of an
+		//!        index type, i.e. 0xffff for GL_UNSIGNED_SHORT, when
+		//!        drawing strips, fans or loops; disable it otherwise.
+		//!
+		//! That value is never a valid index, see `bonobo::uploadIndices()`,
+		//! but code drawing without going through this function, such as
+		//! the UI, may well use it: restart is therefore only left enabled
+		//! for the modes able to make use of it.
+		void primitiveRestart(GLenum drawing_mode, GLenum index_type);
+	}
+}
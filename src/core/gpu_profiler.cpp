@@ -0,0 +1,214 @@
+#include "gpu_profiler.hpp"
+
+#include "core/Log.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <fstream>
+
+namespace local
+{
+	static char const* const frame_section_name = "Frame";
+}
+
+constexpr size_t bonobo::gpu_profiler::history_nb;
+
+bonobo::gpu_profiler::gpu_profiler(size_t frames_in_flight) : _frames(frames_in_flight), _current(0u), _open_records(), _sections(), _history_start(0u), _frames_collected(0u), _dropped_frames_nb(0u)
+{
+	assert(frames_in_flight > 0u);
+	for (auto& f : _frames) {
+		f.queries_nb = 0u;
+		f.recorded = false;
+	}
+	find_section(local::frame_section_name);
+}
+
+bonobo::gpu_profiler::~gpu_profiler()
+{
+	for (auto& f : _frames)
+		if (!f.queries.empty())
+			glDeleteQueries(static_cast<GLsizei>(f.queries.size()), f.queries.data());
+}
+
+void
+bonobo::gpu_profiler::begin_frame()
+{
+	// The frame about to be reused was issued `frames_in_flight` frames
+	// ago, which is normally enough for the GPU to have caught up.
+	_current = (_current + 1u) % _frames.size();
+	auto& f = _frames[_current];
+	if (f.recorded)
+		collect(f);
+
+	f.queries_nb = 0u;
+	f.records.clear();
+	f.recorded = false;
+	_open_records.clear();
+	begin_section(local::frame_section_name);
+}
+
+void
+bonobo::gpu_profiler::end_frame()
+{
+	while (!_open_records.empty())
+		end_section();
+	_frames[_current].recorded = true;
+}
+
+void
+bonobo::gpu_profiler::begin_section(char const* name)
+{
+	auto& f = _frames[_current];
+	_open_records.push_back(f.records.size());
+	f.records.push_back({ name, timestamp(f), 0u });
+}
+
+void
+bonobo::gpu_profiler::end_section()
+{
+	if (_open_records.empty()) {
+		LogWarning("Ending a GPU profiler section which was never started");
+		return;
+	}
+	auto& f = _frames[_current];
+	f.records[_open_records.back()].end_query = timestamp(f);
+	_open_records.pop_back();
+}
+
+size_t
+bonobo::gpu_profiler::timestamp(frame& f)
+{
+	if (f.queries_nb == f.queries.size()) {
+		auto const previous_size = f.queries.size();
+		f.queries.resize(std::max<size_t>(2u * previous_size, 16u));
+		glGenQueries(static_cast<GLsizei>(f.queries.size() - previous_size), f.queries.data() + previous_size);
+	}
+	glQueryCounter(f.queries[f.queries_nb], GL_TIMESTAMP);
+	return f.queries_nb++;
+}
+
+void
+bonobo::gpu_profiler::collect(frame& f)
+{
+	// Queries complete in order, so the last one being available means
+	// all of them are.
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(f.queries[f.queries_nb - 1u], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == GL_FALSE) {
+		++_dropped_frames_nb;
+		return;
+	}
+
+	auto timestamps = std::vector<GLuint64>(f.queries_nb);
+	for (size_t i = 0u; i < f.queries_nb; ++i)
+		glGetQueryObjectui64v(f.queries[i], GL_QUERY_RESULT, &timestamps[i]);
+
+	auto frame_ms = std::vector<float>(_sections.size(), 0.0f);
+	for (auto const& r : f.records) {
+		auto const index = find_section(r.name);
+		if (index >= frame_ms.size())
+			frame_ms.resize(index + 1u, 0.0f);
+		frame_ms[index] += static_cast<float>(static_cast<double>(timestamps[r.end_query] - timestamps[r.begin_query]) / 1000000.0);
+	}
+
+	++_frames_collected;
+	auto const frames_nb = std::min(_frames_collected, history_nb);
+	for (size_t i = 0u; i < _sections.size(); ++i) {
+		auto& s = _sections[i];
+		s.history[_history_start] = frame_ms[i];
+		s.last_ms = frame_ms[i];
+		s.max_ms = 0.0f;
+		auto total_ms = 0.0f;
+		for (size_t j = 0u; j < frames_nb; ++j) {
+			auto const value = s.history[(_history_start + history_nb - j) % history_nb];
+			total_ms += value;
+			s.max_ms = std::max(s.max_ms, value);
+		}
+		s.average_ms = total_ms / static_cast<float>(frames_nb);
+	}
+	_history_start = (_history_start + 1u) % history_nb;
+}
+
+size_t
+bonobo::gpu_profiler::find_section(char const* name)
+{
+	for (size_t i = 0u; i < _sections.size(); ++i)
+		if (_sections[i].name == name)
+			return i;
+
+	section s;
+	s.name = name;
+	s.history.fill(0.0f);
+	s.last_ms = 0.0f;
+	s.average_ms = 0.0f;
+	s.max_ms = 0.0f;
+	_sections.push_back(s);
+	return _sections.size() - 1u;
+}
+
+void
+bonobo::gpu_profiler::show(std::string const& export_path) const
+{
+	bool opened = ImGui::Begin("GPU Time", nullptr, ImVec2(400, 300), -1.0f, 0);
+	if (opened) {
+		ImGui::Columns(4, "gpu_profiler_sections");
+		ImGui::Text("Section");   ImGui::NextColumn();
+		ImGui::Text("Last (ms)"); ImGui::NextColumn();
+		ImGui::Text("Avg (ms)");  ImGui::NextColumn();
+		ImGui::Text("Max (ms)");  ImGui::NextColumn();
+		ImGui::Separator();
+		for (auto const& s : _sections) {
+			ImGui::Text("%s", s.name.c_str());  ImGui::NextColumn();
+			ImGui::Text("%.3f", s.last_ms);     ImGui::NextColumn();
+			ImGui::Text("%.3f", s.average_ms);  ImGui::NextColumn();
+			ImGui::Text("%.3f", s.max_ms);      ImGui::NextColumn();
+		}
+		ImGui::Columns(1);
+		ImGui::Separator();
+
+		for (auto const& s : _sections)
+			ImGui::PlotLines(s.name.c_str(), s.history.data(), static_cast<int>(history_nb), static_cast<int>(_history_start),
+			                 nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+
+		if (_dropped_frames_nb != 0u)
+			ImGui::Text("%zu frames dropped: results not ready in time", _dropped_frames_nb);
+		if (ImGui::Button("Export")) {
+			if (export_csv(export_path))
+				LogInfo("GPU timings written to \"%s\"", export_path.c_str());
+		}
+	}
+	ImGui::End();
+}
+
+bool
+bonobo::gpu_profiler::export_csv(std::string const& path) const
+{
+	auto file = std::ofstream(path, std::ios::trunc);
+	if (!file.is_open()) {
+		LogWarning("Could not create \"%s\"", path.c_str());
+		return false;
+	}
+
+	file << "frame";
+	for (auto const& s : _sections)
+		file << "," << s.name;
+	file << "\n";
+
+	auto const frames_nb = std::min(_frames_collected, history_nb);
+	for (size_t i = 0u; i < frames_nb; ++i) {
+		auto const index = (_history_start + history_nb - frames_nb + i) % history_nb;
+		file << (_frames_collected - frames_nb + i);
+		for (auto const& s : _sections)
+			file << "," << s.history[index];
+		file << "\n";
+	}
+
+	if (!file.good()) {
+		LogWarning("Failed to write \"%s\"", path.c_str());
+		return false;
+	}
+	return true;
+}
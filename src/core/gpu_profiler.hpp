@@ -0,0 +1,132 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Measures how long the GPU spends on each section of a frame.
+	//!
+	//! Sections are delimited by `GL_TIMESTAMP` queries, which, unlike
+	//! `GL_TIME_ELAPSED` ones, can be nested. Each frame gets its own set
+	//! of queries, and results are only read back a few frames later,
+	//! once available, so that the CPU never waits on the GPU; a frame
+	//! whose results are still not there by then is dropped.
+	//!
+	//! Sections sharing a name are summed over the frame, so a section
+	//! entered once per light reports the cost of all lights.
+	class gpu_profiler
+	{
+	public:
+		//! \brief Number of frames kept for averages, graphs and exports.
+		static constexpr size_t history_nb = 128u;
+
+		//! \brief Timings of one section, in milliseconds.
+		struct section {
+			std::string name;
+			std::array<float, history_nb> history; //!< one entry per frame, oldest at `get_history_start()`
+			float last_ms;
+			float average_ms;
+			float max_ms;
+		};
+
+		//! \brief Delimits a section for the duration of a scope.
+		class scope
+		{
+		public:
+			scope(gpu_profiler& profiler, char const* name) : _profiler(profiler) { _profiler.begin_section(name); }
+			~scope() { _profiler.end_section(); }
+
+			scope(scope const&) = delete;
+			scope& operator=(scope const&) = delete;
+
+		private:
+			gpu_profiler& _profiler;
+		};
+
+		//! \brief Create the queries; requires a current OpenGL context.
+		//!
+		//! @param [in] frames_in_flight number of frames recorded before
+		//!             the results of the oldest one are read back
+		gpu_profiler(size_t frames_in_flight = 3u);
+		~gpu_profiler();
+
+		gpu_profiler(gpu_profiler const&) = delete;
+		gpu_profiler& operator=(gpu_profiler const&) = delete;
+
+		//! \brief Read back the oldest frame in flight, if available, and
+		//!        start recording a new one.
+		void begin_frame();
+
+		//! \brief Stop recording the current frame.
+		void end_frame();
+
+		//! \brief Start a section; sections can be nested.
+		//!
+		//! @param [in] name of the section; only the pointer is kept until
+		//!             the frame is read back, so it should be a literal
+		void begin_section(char const* name);
+
+		//! \brief End the innermost section still open.
+		void end_section();
+
+		//! \brief Timings of all sections seen so far, in order of first
+		//!        appearance; the frame as a whole comes first.
+		std::vector<section> const& get_sections() const { return _sections; }
+
+		//! \brief Index in `section::history` of the oldest frame.
+		size_t get_history_start() const { return _history_start; }
+
+		//! \brief Number of frames whose results were read back.
+		size_t get_collected_frames_nb() const { return _frames_collected; }
+
+		//! \brief Number of frames dropped because their results were not
+		//!        available in time.
+		size_t get_dropped_frames_nb() const { return _dropped_frames_nb; }
+
+		//! \brief Show a window with a table of the sections and a graph
+		//!        of their history.
+		//!
+		//! @param [in] export_path file written by the window's export
+		//!             button
+		void show(std::string const& export_path) const;
+
+		//! \brief Write the history as CSV, one line per frame and one
+		//!        column per section.
+		//!
+		//! @param [in] path of the file to write
+		//! @return whether writing succeeded
+		bool export_csv(std::string const& path) const;
+
+	private:
+		struct record {
+			char const* name;
+			size_t begin_query;
+			size_t end_query;
+		};
+
+		struct frame {
+			std::vector<GLuint> queries;
+			size_t queries_nb;
+			std::vector<record> records;
+			bool recorded;
+		};
+
+		size_t timestamp(frame& f);
+		void collect(frame& f);
+		size_t find_section(char const* name);
+
+		std::vector<frame> _frames;
+		size_t _current;
+		std::vector<size_t> _open_records;
+
+		std::vector<section> _sections;
+		size_t _history_start;
+		size_t _frames_collected;
+		size_t _dropped_frames_nb;
+	};
+}
@@ -1,9 +1,19 @@
 #include "config.hpp"
 #include "helpers.hpp"
 
+#include "core/gl_state.hpp"
 #include "core/Log.h"
+#include "core/mesh_cache.hpp"
+#include "core/mesh_optimizer.hpp"
+#include "core/mesh_simplifier.hpp"
 #include "core/Misc.h"
 #include "core/opengl.hpp"
+#include "core/Profiler.h"
+#include "core/program_cache.hpp"
+#include "core/texture_registry.hpp"
+#include "core/thread_pool.hpp"
+#include "core/uniform_cache.hpp"
+#include "core/vertex_format.hpp"
 #include "core/various.hpp"
 #include "external/lodepng.h"
 
@@ -12,12 +22,24 @@
 #include <assimp/postprocess.h>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <unordered_set>
 
 namespace local
 {
 	static GLuint fullscreen_shader;
 	static GLuint display_vao;
+
+	namespace uniforms
+	{
+		static auto const tex       = bonobo::getUniformID("tex");
+		static auto const swizzle   = bonobo::getUniformID("swizzle");
+		static auto const linearise = bonobo::getUniformID("linearise");
+		static auto const z_near    = bonobo::getUniformID("near");
+		static auto const z_far     = bonobo::getUniformID("far");
+	}
 }
 
 void
@@ -36,75 +58,100 @@ bonobo::deinit()
 	glDeleteVertexArrays(1, &local::display_vao);
 }
 
-static std::vector<u8>
-getTextureData(std::string const& filename, u32& width, u32& height, bool flip)
+namespace local
+{
+	struct image {
+		std::vector<u8> texels;
+		u32 width;
+		u32 height;
+		unsigned int error;
+	};
+}
+
+// Called from worker threads, so must neither log nor touch OpenGL.
+static void
+decodeImage(std::string const& path, bool flip, local::image& image)
 {
-	auto const path = config::resources_path(filename);
-	std::vector<unsigned char> image;
-	if (lodepng::decode(image, width, height, path, LCT_RGBA) != 0) {
-		LogWarning("Couldn't load or decode image file %s", path.c_str());
-		return image;
+	PROFILE_SCOPE("decodeImage");
+	image.error = lodepng::decode(image.texels, image.width, image.height, path, LCT_RGBA);
+	if (image.error != 0u || !flip)
+		return;
+
+	// Flip in place by swapping rows, rather than copying into a second
+	// buffer.
+	auto const row_size = static_cast<size_t>(image.width) * 4u;
+	for (u32 y = 0; y < image.height / 2u; ++y) {
+		auto const top = image.texels.begin() + static_cast<std::ptrdiff_t>(y * row_size);
+		auto const bottom = image.texels.begin() + static_cast<std::ptrdiff_t>((image.height - 1u - y) * row_size);
+		std::swap_ranges(top, top + static_cast<std::ptrdiff_t>(row_size), bottom);
 	}
-	if (!flip)
-		return image;
+}
+
+static std::vector<local::image>
+decodeImages(std::vector<std::string> const& filenames, bool flip)
+{
+	auto paths = std::vector<std::string>(filenames.size());
+	for (size_t i = 0; i < filenames.size(); ++i)
+		paths[i] = config::resources_path(filenames[i]);
 
-	auto const channels_nb = 4u;
-	auto flipBuffer = std::vector<u8>(width * height * channels_nb);
-	for (u32 y = 0; y < height; y++)
-		memcpy(flipBuffer.data() + (height - 1 - y) * width * channels_nb, &image[y * width * channels_nb], width * channels_nb);
+	auto images = std::vector<local::image>(filenames.size());
+	utils::thread_pool::instance().parallel_for(images.size(), [&paths,&images,flip](size_t i){
+		decodeImage(paths[i], flip, images[i]);
+	});
 
-	return flipBuffer;
+	for (size_t i = 0; i < images.size(); ++i) {
+		if (images[i].error == 0u)
+			continue;
+		LogWarning("Couldn't load or decode image file %s: %s", paths[i].c_str(), lodepng_error_text(images[i].error));
+		images[i].texels.clear();
+	}
+
+	return images;
 }
 
-std::vector<bonobo::mesh_data>
-bonobo::loadObjects(std::string const& filename)
+static bool
+importScene(std::string const& scene_filepath, bonobo::vertex_format format, bonobo::mesh_cache::scene& scene)
 {
-	std::vector<bonobo::mesh_data> objects;
-
-	auto const scene_filepath = config::resources_path("scenes/" + filename);
-	LogInfo("Loading \"%s\"", scene_filepath.c_str());
+	PROFILE_SCOPE("importScene");
 	Assimp::Importer importer;
-	auto const assimp_scene = importer.ReadFile(scene_filepath, aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_CalcTangentSpace);
+	auto const assimp_scene = importer.ReadFile(scene_filepath, aiProcess_Triangulate | aiProcess_SortByPType | aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices);
 	if (assimp_scene == nullptr || assimp_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || assimp_scene->mRootNode == nullptr) {
 		LogError("Assimp failed to load \"%s\": %s", scene_filepath.c_str(), importer.GetErrorString());
-		return objects;
+		return false;
 	}
 
 	if (assimp_scene->mNumMeshes == 0u) {
 		LogError("No mesh available; loading \"%s\" must have had issues", scene_filepath.c_str());
-		return objects;
+		return false;
 	}
 
-	std::vector<texture_bindings> materials_bindings;
-	materials_bindings.reserve(assimp_scene->mNumMaterials);
-
 	LogInfo("\t* materials");
+	scene.materials.resize(assimp_scene->mNumMaterials);
 	for (size_t i = 0; i < assimp_scene->mNumMaterials; ++i) {
-		texture_bindings bindings;
 		auto const material = assimp_scene->mMaterials[i];
 
-		auto const process_texture = [&bindings,&material,i](aiTextureType type, std::string const& type_as_str, std::string const& name){
+		auto const process_texture = [&scene,&material,i](aiTextureType type, std::string const& type_as_str, bonobo::mesh_cache::texture_slot slot){
 			if (material->GetTextureCount(type)) {
 				if (material->GetTextureCount(type) > 1)
 					LogWarning("Material %d has more than one %s texture: discarding all but the first one.", i, type_as_str.c_str());
 				aiString path;
 				material->GetTexture(type, 0, &path);
-				auto const id = bonobo::loadTexture2D("../crysponza/" + std::string(path.C_Str()), type_as_str != "opacity");
-				if (id != 0u)
-					bindings.emplace(name, id);
+				scene.materials[i].textures[static_cast<size_t>(slot)] = std::string(path.C_Str());
 			}
 		};
 
-		process_texture(aiTextureType_DIFFUSE,  "diffuse",  "diffuse_texture");
-		process_texture(aiTextureType_SPECULAR, "specular", "specular_texture");
-		process_texture(aiTextureType_NORMALS,  "normals",  "normals_texture");
-		process_texture(aiTextureType_OPACITY,  "opacity",  "opacity_texture");
-
-		materials_bindings.push_back(bindings);
+		process_texture(aiTextureType_DIFFUSE,  "diffuse",  bonobo::mesh_cache::texture_slot::diffuse);
+		process_texture(aiTextureType_SPECULAR, "specular", bonobo::mesh_cache::texture_slot::specular);
+		process_texture(aiTextureType_NORMALS,  "normals",  bonobo::mesh_cache::texture_slot::normals);
+		process_texture(aiTextureType_OPACITY,  "opacity",  bonobo::mesh_cache::texture_slot::opacity);
 	}
 
 	LogInfo("\t* meshes");
-	objects.reserve(assimp_scene->mNumMeshes);
+	scene.meshes.reserve(assimp_scene->mNumMeshes);
+	scene.owned_vertex_data.reserve(assimp_scene->mNumMeshes);
+	scene.owned_indices.reserve(assimp_scene->mNumMeshes);
+	auto positions = std::vector<glm::vec3 const*>();
+	positions.reserve(assimp_scene->mNumMeshes);
 	for (size_t j = 0; j < assimp_scene->mNumMeshes; ++j) {
 		auto const assimp_object_mesh = assimp_scene->mMeshes[j];
 
@@ -127,104 +174,223 @@ bonobo::loadObjects(std::string const& filename)
 			continue;
 		}
 
-		bonobo::mesh_data object;
-
-		glGenVertexArrays(1, &object.vao);
-		assert(object.vao != 0u);
-		glBindVertexArray(object.vao);
+		// aiVector3D is laid out just like glm::vec3.
+		auto const as_vec3 = [](aiVector3D const* attribute){
+			return reinterpret_cast<glm::vec3 const*>(attribute);
+		};
+		bonobo::vertex_attributes attributes;
+		attributes.vertices_nb = assimp_object_mesh->mNumVertices;
+		attributes.vertices = as_vec3(assimp_object_mesh->mVertices);
+		attributes.normals = assimp_object_mesh->HasNormals() ? as_vec3(assimp_object_mesh->mNormals) : nullptr;
+		attributes.texcoords = assimp_object_mesh->HasTextureCoords(0u) ? as_vec3(assimp_object_mesh->mTextureCoords[0u]) : nullptr;
+		attributes.tangents = assimp_object_mesh->HasTangentsAndBitangents() ? as_vec3(assimp_object_mesh->mTangents) : nullptr;
+		attributes.binormals = assimp_object_mesh->HasTangentsAndBitangents() ? as_vec3(assimp_object_mesh->mBitangents) : nullptr;
+
+		bonobo::mesh_cache::mesh mesh;
+		mesh.format = format;
+		auto vertex_data = bonobo::packVertices(format, attributes, mesh.attributes);
+		bonobo::computeBounds(attributes.vertices, attributes.vertices_nb, mesh.bounds, mesh.sphere);
 
-		auto const vertices_offset = 0u;
-		auto const vertices_size = static_cast<GLsizeiptr>(assimp_object_mesh->mNumVertices * sizeof(glm::vec3));
+		auto const num_vertices_per_face = assimp_object_mesh->mFaces[0u].mNumIndices;
+		assert(num_vertices_per_face >= 1u && num_vertices_per_face <= 3u);
+		auto indices = std::vector<uint32_t>(static_cast<size_t>(assimp_object_mesh->mNumFaces) * num_vertices_per_face);
+		for (size_t i = 0u; i < assimp_object_mesh->mNumFaces; ++i) {
+			auto const& face = assimp_object_mesh->mFaces[i];
+			assert(face.mNumIndices == num_vertices_per_face);
+			for (size_t k = 0u; k < num_vertices_per_face; ++k)
+				indices[num_vertices_per_face * i + k] = face.mIndices[k];
+		}
 
-		auto const normals_offset = vertices_size;
-		auto const normals_size = assimp_object_mesh->HasNormals() ? vertices_size : 0u;
+		mesh.material_id = assimp_object_mesh->mMaterialIndex;
+		if (mesh.material_id >= scene.materials.size())
+			LogError("Object \"%s\" has a material index of %u, but only %u materials were retrieved.", assimp_object_mesh->mName.C_Str(), mesh.material_id, scene.materials.size());
+		mesh.vertices_nb = assimp_object_mesh->mNumVertices;
+		mesh.indices_nb = static_cast<uint32_t>(indices.size());
+		mesh.drawing_mode = num_vertices_per_face == 1u ? GL_POINTS
+		                  : num_vertices_per_face == 2u ? GL_LINES
+		                  : GL_TRIANGLES;
+		mesh.vertex_data = vertex_data.data();
+		mesh.vertex_data_size = vertex_data.size();
+		mesh.indices = indices.data();
+
+		// Moving a std::vector keeps its buffer, so the views stay valid.
+		scene.owned_vertex_data.push_back(std::move(vertex_data));
+		scene.owned_indices.push_back(std::move(indices));
+		scene.meshes.push_back(mesh);
+		positions.push_back(attributes.vertices);
+	}
 
-		auto const texcoords_offset = normals_offset + normals_size;
-		auto const texcoords_size = assimp_object_mesh->HasTextureCoords(0u) ? vertices_size : 0u;
+	// Done once before writing the cache, so loading from it gets the
+	// optimised order and the levels of detail for free.
+	LogInfo("\t* optimising meshes and building levels of detail");
+	auto stats = std::vector<bonobo::mesh_optimization_stats>(scene.meshes.size());
+	auto optimised = std::vector<bool>(scene.meshes.size(), false);
+	utils::thread_pool::instance().parallel_for(scene.meshes.size(), [&scene,&positions,&stats,&optimised](size_t i){
+		auto& mesh = scene.meshes[i];
+		if (mesh.drawing_mode != GL_TRIANGLES)
+			return;
+		auto remap = std::vector<uint32_t>();
+		stats[i] = bonobo::optimizeMesh(mesh.format, mesh.attributes, positions[i], mesh.vertices_nb,
+		                                scene.owned_vertex_data[i].data(), scene.owned_indices[i].data(), mesh.indices_nb,
+		                                &remap);
+		optimised[i] = true;
+
+		// The levels share the vertices, now in their new order.
+		auto ordered_positions = std::vector<glm::vec3>(mesh.vertices_nb);
+		for (size_t v = 0u; v < mesh.vertices_nb; ++v)
+			ordered_positions[remap[v]] = positions[i][v];
+		auto& indices = scene.owned_indices[i];
+		mesh.lods = bonobo::buildLodChain(indices, ordered_positions.data(), mesh.vertices_nb);
+		mesh.indices = indices.data();
+		mesh.indices_nb = static_cast<uint32_t>(indices.size());
+	});
+	for (size_t i = 0; i < scene.meshes.size(); ++i) {
+		if (!optimised[i])
+			continue;
+		auto const& s = stats[i];
+		LogInfo("\t\t- mesh %u: ACMR %.3f -> %.3f (vertex cache) -> %.3f (overdraw, %u clusters), ATVR %.3f -> %.3f -> %.3f, overfetch %.2f -> %.2f",
+		        static_cast<unsigned int>(i), s.input.acmr, s.vertex_cache.acmr, s.overdraw.acmr, static_cast<unsigned int>(s.clusters_nb),
+		        s.input.atvr, s.vertex_cache.atvr, s.overdraw.atvr, s.input_overfetch, s.overfetch);
+		auto const& lods = scene.meshes[i].lods;
+		if (!lods.empty())
+			LogInfo("\t\t  %u levels of detail, down to %u triangles with an error of %g",
+			        static_cast<unsigned int>(lods.size()), static_cast<unsigned int>(lods.back().indices_nb / 3u),
+			        static_cast<double>(lods.back().error));
+	}
 
-		auto const tangents_offset = texcoords_offset + texcoords_size;
-		auto const tangents_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
+	return true;
+}
 
-		auto const binormals_offset = tangents_offset + tangents_size;
-		auto const binormals_size = assimp_object_mesh->HasTangentsAndBitangents() ? vertices_size : 0u;
+static bonobo::mesh_data
+uploadMesh(bonobo::mesh_cache::mesh const& mesh)
+{
+	bonobo::mesh_data object;
+	object.vertices_nb = mesh.vertices_nb;
+	object.drawing_mode = mesh.drawing_mode;
+	object.format = mesh.format;
+	object.attributes = mesh.attributes;
+	object.bounds = mesh.bounds;
+	object.sphere = mesh.sphere;
+
+	glGenVertexArrays(1, &object.vao);
+	assert(object.vao != 0u);
+	glBindVertexArray(object.vao);
+
+	glGenBuffers(1, &object.bo);
+	assert(object.bo != 0u);
+	glBindBuffer(GL_ARRAY_BUFFER, object.bo);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(mesh.vertex_data_size), static_cast<GLvoid const*>(mesh.vertex_data), GL_STATIC_DRAW);
+
+	assert(bonobo::vertexSize(mesh.format, mesh.attributes) * mesh.vertices_nb == mesh.vertex_data_size);
+	bonobo::setVertexAttribPointers(mesh.format, mesh.attributes, mesh.vertices_nb);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+	// The cache stores 32-bit indices; most meshes fit on 16. Coarser
+	// levels of detail follow the full detail in the same buffer.
+	bonobo::uploadIndices(object, mesh.indices, mesh.indices_nb);
+	if (!mesh.lods.empty())
+		object.indices_nb = mesh.lods.front().first_index;
+	object.lods = mesh.lods;
 
-		auto const bo_size = static_cast<GLsizeiptr>(vertices_size
-		                                            +normals_size
-		                                            +texcoords_size
-		                                            +tangents_size
-		                                            +binormals_size
-		                                            );
-		glGenBuffers(1, &object.bo);
-		assert(object.bo != 0u);
-		glBindBuffer(GL_ARRAY_BUFFER, object.bo);
-		glBufferData(GL_ARRAY_BUFFER, bo_size, nullptr, GL_STATIC_DRAW);
+	glBindVertexArray(0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+	bonobo::gl_state::invalidate();
 
-		glBufferSubData(GL_ARRAY_BUFFER, vertices_offset, vertices_size, static_cast<GLvoid const*>(assimp_object_mesh->mVertices));
-		glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::vertices));
-		glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::vertices), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(0x0));
+	return object;
+}
 
-		if (assimp_object_mesh->HasNormals()) {
-			glBufferSubData(GL_ARRAY_BUFFER, normals_offset, normals_size, static_cast<GLvoid const*>(assimp_object_mesh->mNormals));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::normals));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::normals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(normals_offset));
-		}
+std::vector<bonobo::mesh_data>
+bonobo::loadObjects(std::string const& filename, vertex_format format)
+{
+	PROFILE_SCOPE("loadObjects");
+	std::vector<bonobo::mesh_data> objects;
 
-		if (assimp_object_mesh->HasTextureCoords(0u)) {
-			glBufferSubData(GL_ARRAY_BUFFER, texcoords_offset, texcoords_size, static_cast<GLvoid const*>(assimp_object_mesh->mTextureCoords[0u]));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::texcoords));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::texcoords), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(texcoords_offset));
-		}
+	auto const scene_filepath = config::resources_path("scenes/" + filename);
+	LogInfo("Loading \"%s\"", scene_filepath.c_str());
 
-		if (assimp_object_mesh->HasTangentsAndBitangents()) {
-			glBufferSubData(GL_ARRAY_BUFFER, tangents_offset, tangents_size, static_cast<GLvoid const*>(assimp_object_mesh->mTangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::tangents));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::tangents), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(tangents_offset));
+	auto source_hash = mesh_cache::hashSource(scene_filepath);
+	if (source_hash == 0u) {
+		LogError("Failed to read \"%s\"", scene_filepath.c_str());
+		return objects;
+	}
+	// A cache only holds one layout, so asking for another rebuilds it.
+	source_hash = utils::hash_fnv1a(&format, sizeof(format), source_hash);
+
+	auto const cache_filepath = mesh_cache::cachePath(scene_filepath);
+	mesh_cache::scene scene;
+	if (mesh_cache::read(cache_filepath, source_hash, scene)) {
+		LogInfo("\t* using cache \"%s\"", cache_filepath.c_str());
+	} else {
+		if (!importScene(scene_filepath, format, scene))
+			return objects;
+		if (mesh_cache::write(cache_filepath, source_hash, scene))
+			LogInfo("\t* wrote cache \"%s\"", cache_filepath.c_str());
+	}
 
-			glBufferSubData(GL_ARRAY_BUFFER, binormals_offset, binormals_size, static_cast<GLvoid const*>(assimp_object_mesh->mBitangents));
-			glEnableVertexAttribArray(static_cast<unsigned int>(bonobo::shader_bindings::binormals));
-			glVertexAttribPointer(static_cast<unsigned int>(bonobo::shader_bindings::binormals), 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(binormals_offset));
-		}
+	// Gather the textures of all materials first, so that they can be
+	// decoded in one parallel batch. Many materials share the same images:
+	// each slot is requested, so that the registry loads them once and
+	// accounts for the reuse, but only one reference per texture is kept,
+	// so that releaseObjectTextures() can drop exactly those references.
+	struct texture_target {
+		size_t material_id;
+		std::string name;
+	};
+	std::vector<texture_request> texture_requests;
+	std::vector<texture_target> texture_targets;
+	for (size_t i = 0; i < scene.materials.size(); ++i) {
+		auto const& material = scene.materials[i];
+
+		auto const process_texture = [&texture_requests,&texture_targets,&material,i](mesh_cache::texture_slot slot, std::string const& name){
+			auto const& path = material.textures[static_cast<size_t>(slot)];
+			if (path.empty())
+				return;
+			texture_requests.push_back({ "../crysponza/" + path, slot != mesh_cache::texture_slot::opacity });
+			texture_targets.push_back({ i, name });
+		};
 
-		glBindBuffer(GL_ARRAY_BUFFER, 0u);
+		process_texture(mesh_cache::texture_slot::diffuse,  "diffuse_texture");
+		process_texture(mesh_cache::texture_slot::specular, "specular_texture");
+		process_texture(mesh_cache::texture_slot::normals,  "normals_texture");
+		process_texture(mesh_cache::texture_slot::opacity,  "opacity_texture");
+	}
 
-		auto const num_vertices_per_face = assimp_object_mesh->mFaces[0u].mNumIndices;
-		object.indices_nb = assimp_object_mesh->mNumFaces * num_vertices_per_face;
-		auto object_indices = std::make_unique<GLuint[]>(static_cast<size_t>(object.indices_nb));
-		for (size_t i = 0u; i < assimp_object_mesh->mNumFaces; ++i) {
-			auto const& face = assimp_object_mesh->mFaces[i];
-			assert(face.mNumIndices <= 3);
-			object_indices[num_vertices_per_face * i + 0u] = face.mIndices[0u];
-			if (num_vertices_per_face >= 1u)
-				object_indices[num_vertices_per_face * i + 1u] = face.mIndices[1u];
-			if (num_vertices_per_face >= 2u)
-				object_indices[num_vertices_per_face * i + 2u] = face.mIndices[2u];
-		}
-		glGenBuffers(1, &object.ibo);
-		assert(object.ibo != 0u);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, object.ibo);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<unsigned int>(object.indices_nb) * sizeof(GL_UNSIGNED_INT), reinterpret_cast<GLvoid const*>(object_indices.get()), GL_STATIC_DRAW);
-		object_indices.reset(nullptr);
-
-		glBindVertexArray(0u);
-		glBindBuffer(GL_ARRAY_BUFFER, 0u);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
-
-		auto const material_id = assimp_object_mesh->mMaterialIndex;
-		if (material_id >= materials_bindings.size())
-			LogError("Object \"%s\" has a material index of %u, but only %u materials were retrieved.", assimp_object_mesh->mName.C_Str(), material_id, materials_bindings.size());
-		else
-			object.bindings = materials_bindings[material_id];
+	auto const textures = bonobo::acquireTextures2D(texture_requests);
+	std::vector<texture_bindings> materials_bindings(scene.materials.size());
+	auto referenced = std::unordered_set<GLuint>();
+	for (size_t i = 0; i < texture_targets.size(); ++i) {
+		auto const texture = textures[i];
+		if (texture == 0u)
+			continue;
+		if (!referenced.insert(texture).second)
+			bonobo::releaseTexture(texture);
+		materials_bindings[texture_targets[i].material_id].emplace(texture_targets[i].name, texture);
+	}
+	bonobo::logTextureRegistryStats();
 
+	objects.reserve(scene.meshes.size());
+	for (auto const& mesh : scene.meshes) {
+		auto object = uploadMesh(mesh);
+		if (mesh.material_id < materials_bindings.size())
+			object.bindings = materials_bindings[mesh.material_id];
 		objects.push_back(object);
-
-//		LogInfo("Loaded object \"%s\" with normals:%d, tangents&bitangents:%d, texcoords:%d",
-//		        assimp_object_mesh->mName.C_Str(), assimp_object_mesh->HasNormals(),
-//		        assimp_object_mesh->HasTangentsAndBitangents(), assimp_object_mesh->HasTextureCoords(0));
 	}
 
 	return objects;
 }
 
+void
+bonobo::releaseObjectTextures(std::vector<mesh_data> const& objects)
+{
+	auto textures = std::unordered_set<GLuint>();
+	for (auto const& object : objects)
+		for (auto const& binding : object.bindings)
+			textures.insert(binding.second);
+	for (auto const texture : textures)
+		bonobo::releaseTexture(texture);
+}
+
 GLuint
 bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint internal_format, GLenum format, GLenum type, GLvoid const* data)
 {
@@ -236,6 +402,7 @@ bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint inte
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexImage2D(target, 0, internal_format, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, format, type, data);
 	glBindTexture(target, 0u);
+	bonobo::gl_state::invalidate();
 
 	return texture;
 }
@@ -243,20 +410,37 @@ bonobo::createTexture(uint32_t width, uint32_t height, GLenum target, GLint inte
 GLuint
 bonobo::loadTexture2D(std::string const& filename, bool generate_mipmap)
 {
-	u32 width, height;
-	auto const data = getTextureData("textures/" + filename, width, height, true);
-	if (data.empty())
-		return 0u;
+	return bonobo::loadTextures2D({ { filename, generate_mipmap } }).front();
+}
 
-	GLuint texture = bonobo::createTexture(width, height, GL_TEXTURE_2D, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(data.data()));
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	if (generate_mipmap)
-		glGenerateMipmap(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, 0u);
+std::vector<GLuint>
+bonobo::loadTextures2D(std::vector<texture_request> const& requests)
+{
+	PROFILE_SCOPE("loadTextures2D");
+	auto filenames = std::vector<std::string>(requests.size());
+	for (size_t i = 0; i < requests.size(); ++i)
+		filenames[i] = "textures/" + requests[i].filename;
+	auto const images = decodeImages(filenames, true);
+
+	// Only the uploads are left for the thread owning the context.
+	auto textures = std::vector<GLuint>(requests.size(), 0u);
+	for (size_t i = 0; i < requests.size(); ++i) {
+		auto const& image = images[i];
+		if (image.texels.empty())
+			continue;
 
-	return texture;
+		GLuint texture = bonobo::createTexture(image.width, image.height, GL_TEXTURE_2D, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(image.texels.data()));
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, requests[i].generate_mipmap ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		if (requests[i].generate_mipmap)
+			glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0u);
+		textures[i] = texture;
+	}
+	bonobo::gl_state::invalidate();
+
+	return textures;
 }
 
 GLuint
@@ -293,14 +477,17 @@ bonobo::loadTextureCubeMap(std::string const& posx, std::string const& negx,
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 	// We need to fill in the cube map using the images passed in as
-	// argument. The function `getTextureData()` uses lodepng to read in
-	// the image files and return a `std::vector<u8>` containing all the
-	// texels.
-	u32 width, height;
-	auto data = getTextureData("cubemaps/" + negx, width, height, false);
-	if (data.empty()) {
-		glDeleteTextures(1, &texture);
-		return 0u;
+	// argument. The function `decodeImages()` uses lodepng to read in
+	// the image files, one per worker thread, and returns for each of
+	// them a `std::vector<u8>` containing all the texels.
+	auto const faces = decodeImages({ "cubemaps/" + negx, "cubemaps/" + posx,
+	                                  "cubemaps/" + negy, "cubemaps/" + posy,
+	                                  "cubemaps/" + negz, "cubemaps/" + posz }, false);
+	for (auto const& face : faces) {
+		if (face.texels.empty()) {
+			glDeleteTextures(1, &texture);
+			return 0u;
+		}
 	}
 	// With all the texels available on the CPU, we now want to push them
 	// to the GPU: this is done using `glTexImage2D()` (among others). You
@@ -314,48 +501,19 @@ bonobo::loadTextureCubeMap(std::string const& posx, std::string const& negx,
 	glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_X,
 	             /* mipmap level, you'll see that in EDAN35 */0,
 	             /* how are the components internally stored */GL_RGBA,
-	             /* the width of the cube map's face */static_cast<GLsizei>(width),
-	             /* the height of the cube map's face */static_cast<GLsizei>(height),
+	             /* the width of the cube map's face */static_cast<GLsizei>(faces[0].width),
+	             /* the height of the cube map's face */static_cast<GLsizei>(faces[0].height),
 	             /* must always be 0 */0,
 	             /* the format of the pixel data: which components are available */GL_RGBA,
 	             /* the type of each component */GL_UNSIGNED_BYTE,
-	             /* the pointer to the actual data on the CPU */reinterpret_cast<GLvoid const*>(data.data()));
+	             /* the pointer to the actual data on the CPU */reinterpret_cast<GLvoid const*>(faces[0].texels.data()));
 
 	// repeat the texture filling for the 5 remaining faces
-    data = getTextureData("cubemaps/" + posx, width, height, false);
-    if (data.empty()) {
-        glDeleteTextures(1, &texture);
-        return 0u;
-    }
-    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_RGBA, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(data.data()));
-    
-    data = getTextureData("cubemaps/" + negy, width, height, false);
-    if (data.empty()) {
-        glDeleteTextures(1, &texture);
-        return 0u;
-    }
-    glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, 0, GL_RGBA, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(data.data()));
-    
-    data = getTextureData("cubemaps/" + posy, width, height, false);
-    if (data.empty()) {
-        glDeleteTextures(1, &texture);
-        return 0u;
-    }
-    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Y, 0, GL_RGBA, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(data.data()));
-    
-    data = getTextureData("cubemaps/" + negz, width, height, false);
-    if (data.empty()) {
-        glDeleteTextures(1, &texture);
-        return 0u;
-    }
-    glTexImage2D(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, 0, GL_RGBA, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(data.data()));
-    
-    data = getTextureData("cubemaps/" + posz, width, height, false);
-    if (data.empty()) {
-        glDeleteTextures(1, &texture);
-        return 0u;
-    }
-    glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_Z, 0, GL_RGBA, static_cast<GLsizei>(width), static_cast<GLsizei>(height), 0, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(data.data()));
+	GLenum const remaining_targets[] = { GL_TEXTURE_CUBE_MAP_POSITIVE_X,
+	                                     GL_TEXTURE_CUBE_MAP_NEGATIVE_Y, GL_TEXTURE_CUBE_MAP_POSITIVE_Y,
+	                                     GL_TEXTURE_CUBE_MAP_NEGATIVE_Z, GL_TEXTURE_CUBE_MAP_POSITIVE_Z };
+	for (size_t i = 1; i < faces.size(); ++i)
+		glTexImage2D(remaining_targets[i - 1], 0, GL_RGBA, static_cast<GLsizei>(faces[i].width), static_cast<GLsizei>(faces[i].height), 0, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid const*>(faces[i].texels.data()));
 
 	if (generate_mipmap)
 		// Generate the mipmap hierarchy; wait for EDAN35 to understand
@@ -363,6 +521,7 @@ bonobo::loadTextureCubeMap(std::string const& posx, std::string const& negx,
 		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
 	glBindTexture(GL_TEXTURE_CUBE_MAP, 0u);
+	bonobo::gl_state::invalidate();
 
 	return texture;
 }
@@ -370,19 +529,35 @@ bonobo::loadTextureCubeMap(std::string const& posx, std::string const& negx,
 GLuint
 bonobo::createProgram(std::string const& vert_shader_source_path, std::string const& frag_shader_source_path)
 {
+	PROFILE_SCOPE("createProgram");
 	auto const vertex_shader_source = utils::slurp_file(config::shaders_path("EDAF80/" + vert_shader_source_path));
+	auto const fragment_shader_source = utils::slurp_file(config::shaders_path("EDAF80/" + frag_shader_source_path));
+
+	// Only programs whose sources changed since the last run need to be
+	// compiled again.
+	auto const use_cache = !vertex_shader_source.empty() && !fragment_shader_source.empty() && program_cache::isSupported();
+	auto const sources_hash = use_cache ? program_cache::hashSources({ vertex_shader_source, fragment_shader_source }) : 0u;
+	if (use_cache) {
+		auto const cached_program = program_cache::load(sources_hash);
+		if (cached_program != 0u)
+			return cached_program;
+	}
+
 	GLuint vertex_shader = utils::opengl::shader::generate_shader(GL_VERTEX_SHADER, vertex_shader_source);
 	if (vertex_shader == 0u)
 		return 0u;
 
-	auto const fragment_shader_source = utils::slurp_file(config::shaders_path("EDAF80/" + frag_shader_source_path));
 	GLuint fragment_shader = utils::opengl::shader::generate_shader(GL_FRAGMENT_SHADER, fragment_shader_source);
-	if (fragment_shader == 0u)
+	if (fragment_shader == 0u) {
+		glDeleteShader(vertex_shader);
 		return 0u;
+	}
 
 	GLuint program = utils::opengl::shader::generate_program({ vertex_shader, fragment_shader });
 	glDeleteShader(vertex_shader);
 	glDeleteShader(fragment_shader);
+	if (use_cache && program != 0u)
+		program_cache::store(sources_hash, program);
 	return program;
 }
 
@@ -401,20 +576,17 @@ bonobo::displayTexture(glm::vec2 const& lower_left, glm::vec2 const& upper_right
 	int const linearise = camera != nullptr;
 
 	glViewport(viewport_origin.x, viewport_origin.y, viewport_size.x, viewport_size.y);
-	glUseProgram(local::fullscreen_shader);
-	glBindVertexArray(local::display_vao);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, texture);
-	glBindSampler(0, sampler);
-	glUniform1i(glGetUniformLocation(local::fullscreen_shader, "tex"), 0);
-	glUniform4iv(glGetUniformLocation(local::fullscreen_shader, "swizzle"), 1, glm::value_ptr(swizzle));
-	glUniform1i(glGetUniformLocation(local::fullscreen_shader, "linearise"), linearise);
-	glUniform1f(glGetUniformLocation(local::fullscreen_shader, "near"), linearise ? camera->mNear : 0.0f);
-	glUniform1f(glGetUniformLocation(local::fullscreen_shader, "far"), linearise ? camera->mFar : 0.0f);
+	bonobo::gl_state::useProgram(local::fullscreen_shader);
+	bonobo::gl_state::bindVertexArray(local::display_vao);
+	bonobo::gl_state::bindTexture(0u, GL_TEXTURE_2D, texture);
+	bonobo::gl_state::bindSampler(0u, sampler);
+	glUniform1i(bonobo::getUniformLocation(local::fullscreen_shader, local::uniforms::tex), 0);
+	glUniform4iv(bonobo::getUniformLocation(local::fullscreen_shader, local::uniforms::swizzle), 1, glm::value_ptr(swizzle));
+	glUniform1i(bonobo::getUniformLocation(local::fullscreen_shader, local::uniforms::linearise), linearise);
+	glUniform1f(bonobo::getUniformLocation(local::fullscreen_shader, local::uniforms::z_near), linearise ? camera->mNear : 0.0f);
+	glUniform1f(bonobo::getUniformLocation(local::fullscreen_shader, local::uniforms::z_far), linearise ? camera->mFar : 0.0f);
 	glDrawArrays(GL_TRIANGLES, 0, 3);
-	glBindSampler(0, 0u);
-	glBindTexture(GL_TEXTURE_2D, 0);
-	glUseProgram(0);
+	bonobo::gl_state::bindSampler(0u, 0u);
 }
 
 GLuint
@@ -436,6 +608,7 @@ bonobo::createFBO(std::vector<GLuint> const& color_attachments, GLuint depth_att
 	if (depth_attachment != 0u)
 		attach(GL_DEPTH_ATTACHMENT, depth_attachment);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	bonobo::gl_state::invalidate();
 
 	return fbo;
 }
@@ -447,13 +620,13 @@ bonobo::createSampler(std::function<void (GLuint)> const& setup)
 	glGenSamplers(1, &sampler);
 	assert(sampler != 0u);
 	setup(sampler);
+	bonobo::gl_state::invalidate();
 	return sampler;
 }
 
 void
 bonobo::drawFullscreen()
 {
-	glBindVertexArray(local::display_vao);
+	bonobo::gl_state::bindVertexArray(local::display_vao);
 	glDrawArrays(GL_TRIANGLES, 0, 3);
-	glBindVertexArray(0u);
 }
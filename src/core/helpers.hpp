@@ -4,6 +4,8 @@
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
+#include "core/bounds.hpp"
+#include "core/lod.hpp"
 #include "core/FPSCamera.h" // As it includes OpenGL headers, import it after glad
 
 #include <functional>
@@ -20,8 +22,17 @@ namespace bonobo
 		vertices = 0u, //!< = 0, value of the binding point for vertices
 		normals,       //!< = 1, value of the binding point for normals
 		texcoords,     //!< = 2, value of the binding point for texcoords
-		tangents,      //!< = 3, value of the binding point for tangents
-		binormals      //!< = 4, value of the binding point for binormals
+		tangents,      //!< = 3, value of the binding point for tangents; the w component holds the handedness of the tangent frame when binormals are not stored
+		binormals,     //!< = 4, value of the binding point for binormals, left disabled when they are to be derived as `tangent.w * cross(normal, tangent.xyz)`
+		instance_model_to_world = 5u, //!< = 5, first of the four binding points (5 to 8) for the per-instance model-to-world matrix of instanced draws
+		instance_parameters = 9u      //!< = 9, value of the binding point for the per-instance parameters of instanced draws
+	};
+
+	//! \brief Layout of the vertex attributes in the Buffer Object of a
+	//!        mesh.
+	enum class vertex_format : unsigned int {
+		planar_float = 0u,  //!< one array of `glm::vec3` per attribute, one after the other (60 bytes per vertex)
+		interleaved_packed  //!< attributes interleaved per vertex: position as three floats, normal and tangent as GL_INT_2_10_10_10_REV, texcoord as two halves (24 bytes per vertex with all of them), and the binormal as three floats only when the normal or the tangent is missing, as it is otherwise rebuilt from them
 	};
 
 	//! \brief Association of a sampler name used in GLSL to a
@@ -34,11 +45,19 @@ namespace bonobo
 		GLuint bo;                 //!< OpenGL name of the Buffer Object
 		GLuint ibo;                //!< OpenGL name of the Buffer Object for indices
 		size_t vertices_nb;        //!< number of vertices stored in bo
-		size_t indices_nb;         //!< number of indices stored in ibo
+		size_t indices_nb;         //!< number of indices stored in ibo for the full detail
+		size_t first_index;        //!< position of the first index of this mesh in ibo, non-zero when ibo is shared
+		GLint base_vertex;         //!< value added to each index to fetch from bo, non-zero when bo is shared
 		texture_bindings bindings; //!< texture bindings for this mesh
 		GLenum drawing_mode;       //!< OpenGL drawing mode, i.e. GL_TRIANGLES, GL_LINES, etc.
-
-		mesh_data() : vao(0u), bo(0u), ibo(0u), vertices_nb(0u), indices_nb(0u), bindings(), drawing_mode(GL_TRIANGLES)
+		GLenum index_type;         //!< type of the indices in ibo, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT; its largest value restarts strips
+		vertex_format format;      //!< layout of the vertex attributes in bo
+		uint32_t attributes;       //!< bit i set if attribute `shader_bindings(i)` is stored in bo
+		aabb bounds;               //!< object-space bounding box of the vertices
+		bounding_sphere sphere;    //!< object-space bounding sphere of the vertices, with a negative radius if unknown
+		std::vector<mesh_lod> lods; //!< coarser levels of detail, from finest to coarsest, stored in bo and ibo after the full detail
+
+		mesh_data() : vao(0u), bo(0u), ibo(0u), vertices_nb(0u), indices_nb(0u), first_index(0u), base_vertex(0), bindings(), drawing_mode(GL_TRIANGLES), index_type(GL_UNSIGNED_INT), format(vertex_format::planar_float), attributes(0u), bounds(), sphere(), lods()
 		{
 		}
 	};
@@ -51,11 +70,24 @@ namespace bonobo
 
 	//! \brief Load objects found in an object/scene file, using assimp.
 	//!
+	//! Textures come from `bonobo::acquireTextures2D()`, each of them
+	//! referenced once per call, and must be released with
+	//! `releaseObjectTextures()`.
+	//!
 	//! @param [in] filename of the object/scene file to load, relative to
 	//!             the `res/scenes` folder
+	//! @param [in] format layout to store the vertex attributes in
 	//! @return a vector of filled in `mesh_data` structures, one per
 	//!         object found in the input file
-	std::vector<mesh_data> loadObjects(std::string const& filename);
+	std::vector<mesh_data> loadObjects(std::string const& filename,
+	                                   vertex_format format = vertex_format::interleaved_packed);
+
+	//! \brief Drop the references `loadObjects()` took on the textures of
+	//!        the objects it returned, deleting those no longer used.
+	//!
+	//! @param [in] objects everything returned by one call to
+	//!             `loadObjects()`
+	void releaseObjectTextures(std::vector<mesh_data> const& objects);
 
 	//! \brief Creates an OpenGL texture without any content nor parameterised.
 	//!
@@ -85,6 +117,23 @@ namespace bonobo
 	GLuint loadTexture2D(std::string const& filename,
 	                     bool generate_mipmap = true);
 
+	//! \brief Description of a 2D-texture for `loadTextures2D()`.
+	struct texture_request {
+		std::string filename; //!< PNG image, relative to the `textures` folder within the `resources` folder
+		bool generate_mipmap; //!< whether or not to generate a mipmap hierarchy
+	};
+
+	//! \brief Load several PNG images into OpenGL 2D-textures.
+	//!
+	//! The images are decoded in parallel on the worker threads of
+	//! `utils::thread_pool::instance()`; only the uploads happen on the
+	//! calling thread.
+	//!
+	//! @param [in] requests images to load and how
+	//! @return the names of the OpenGL 2D-textures, in the order of
+	//!         `requests`, with 0 for images that failed to load
+	std::vector<GLuint> loadTextures2D(std::vector<texture_request> const& requests);
+
 	//! \brief Load six PNG images into an OpenGL cubemap-texture.
 	//!
 	//! @param [in] posx path to the texture on the left of the cubemap
@@ -105,6 +154,9 @@ namespace bonobo
 	//! \brief Create an OpenGL program consisting of a vertex and a
 	//!        fragment shader.
 	//!
+	//! The linked program is saved by `bonobo::program_cache`, and loaded
+	//! back from there as long as neither source changes.
+	//!
 	//! @param [in] vert_shader_source_path of the vertex shader source
 	//!             code, relative to the `shaders/EDAF80` folder
 	//! @param [in] frag_shader_source_path of the fragment shader source
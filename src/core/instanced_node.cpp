@@ -0,0 +1,151 @@
+#include "instanced_node.hpp"
+#include "gl_state.hpp"
+#include "helpers.hpp"
+#include "vertex_format.hpp"
+
+#include "core/Log.h"
+#include "core/Profiler.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+namespace local
+{
+	static auto const vertex_world_to_clip_id = bonobo::getUniformID("vertex_world_to_clip");
+	static auto const has_textures_id         = bonobo::getUniformID("has_textures");
+}
+
+InstancedNode::InstancedNode() : _vao(0u), _vertices_nb(0u), _indices_nb(0u), _first_index(0u), _base_vertex(0), _drawing_mode(GL_TRIANGLES), _index_type(GL_UNSIGNED_INT), _has_indices(true), _instance_bo(0u), _instance_capacity(0u), _instances_nb(0u), _program(0u), _textures()
+{
+}
+
+InstancedNode::~InstancedNode()
+{
+	glDeleteBuffers(1, &_instance_bo);
+	glDeleteVertexArrays(1, &_vao);
+	bonobo::gl_state::invalidate();
+}
+
+void
+InstancedNode::render(glm::mat4 const& world_to_clip) const
+{
+	render(world_to_clip, _program, _set_uniforms);
+}
+
+void
+InstancedNode::render(glm::mat4 const& world_to_clip, GLuint program, std::function<void (GLuint)> const& set_uniforms) const
+{
+	if (_vao == 0u || program == 0u || _instances_nb == 0u)
+		return;
+
+	PROFILE_SCOPE("InstancedNode::render");
+	bonobo::gl_state::useProgram(program);
+
+	set_uniforms(program);
+
+	glUniformMatrix4fv(bonobo::getUniformLocation(program, local::vertex_world_to_clip_id), 1, GL_FALSE, glm::value_ptr(world_to_clip));
+
+	glUniform1i(bonobo::getUniformLocation(program, local::has_textures_id), !_textures.empty());
+	for (size_t i = 0u; i < _textures.size(); ++i) {
+		auto const& texture = _textures[i];
+		bonobo::gl_state::bindTexture(static_cast<GLuint>(i), std::get<2>(texture), std::get<1>(texture));
+		glUniform1i(bonobo::getUniformLocation(program, std::get<0>(texture)), static_cast<GLint>(i));
+	}
+
+	bonobo::gl_state::bindVertexArray(_vao);
+	if (_has_indices) {
+		bonobo::gl_state::primitiveRestart(_drawing_mode, _index_type);
+		glDrawElementsInstancedBaseVertex(_drawing_mode, _indices_nb, _index_type, reinterpret_cast<GLvoid const*>(_first_index * bonobo::indexSize(_index_type)),
+		                                  static_cast<GLsizei>(_instances_nb), _base_vertex);
+	} else {
+		glDrawArraysInstanced(_drawing_mode, _base_vertex, _vertices_nb, static_cast<GLsizei>(_instances_nb));
+	}
+}
+
+void
+InstancedNode::set_geometry(bonobo::mesh_data const& shape)
+{
+	if (_vao == 0u) {
+		glGenVertexArrays(1, &_vao);
+		assert(_vao != 0u);
+		glGenBuffers(1, &_instance_bo);
+		assert(_instance_bo != 0u);
+	}
+	_vertices_nb = static_cast<GLsizei>(shape.vertices_nb);
+	_indices_nb = static_cast<GLsizei>(shape.indices_nb);
+	_first_index = shape.first_index;
+	_base_vertex = shape.base_vertex;
+	_drawing_mode = shape.drawing_mode;
+	_index_type = shape.index_type;
+	_has_indices = shape.ibo != 0u;
+
+	glBindVertexArray(_vao);
+
+	glBindBuffer(GL_ARRAY_BUFFER, shape.bo);
+	bonobo::setVertexAttribPointers(shape.format, shape.attributes, shape.vertices_nb);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, shape.ibo);
+
+	// A mat4 attribute takes four consecutive binding points, one per
+	// column.
+	auto const stride = static_cast<GLsizei>(sizeof(instance));
+	glBindBuffer(GL_ARRAY_BUFFER, _instance_bo);
+	auto const matrix_binding = static_cast<GLuint>(bonobo::shader_bindings::instance_model_to_world);
+	for (GLuint column = 0u; column < 4u; ++column) {
+		glEnableVertexAttribArray(matrix_binding + column);
+		glVertexAttribPointer(matrix_binding + column, 4, GL_FLOAT, GL_FALSE, stride,
+		                      reinterpret_cast<GLvoid const*>(offsetof(instance, model_to_world) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(matrix_binding + column, 1u);
+	}
+	auto const parameters_binding = static_cast<GLuint>(bonobo::shader_bindings::instance_parameters);
+	glEnableVertexAttribArray(parameters_binding);
+	glVertexAttribPointer(parameters_binding, 4, GL_FLOAT, GL_FALSE, stride,
+	                      reinterpret_cast<GLvoid const*>(offsetof(instance, parameters)));
+	glVertexAttribDivisor(parameters_binding, 1u);
+
+	glBindVertexArray(0u);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+	bonobo::gl_state::invalidate();
+}
+
+void
+InstancedNode::set_instances(std::vector<instance> const& instances)
+{
+	if (_instance_bo == 0u) {
+		LogError("Instances were set before any geometry");
+		return;
+	}
+
+	_instances_nb = instances.size();
+	if (instances.empty())
+		return;
+
+	// Grow geometrically, so that a slowly increasing count does not
+	// change the size of the store every frame.
+	if (instances.size() > _instance_capacity)
+		_instance_capacity = std::max(instances.size(), 2u * _instance_capacity);
+
+	// Specifying the store anew orphans the previous one, which draws
+	// still in flight keep reading from.
+	glBindBuffer(GL_ARRAY_BUFFER, _instance_bo);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(_instance_capacity * sizeof(instance)), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, static_cast<GLsizeiptr>(instances.size() * sizeof(instance)), instances.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+}
+
+void
+InstancedNode::set_program(GLuint program, std::function<void (GLuint)> const& set_uniforms)
+{
+	_program = program;
+	_set_uniforms = set_uniforms;
+}
+
+void
+InstancedNode::add_texture(std::string const& name, GLuint tex_id, GLenum type)
+{
+	if (tex_id != 0u)
+		_textures.emplace_back(bonobo::getUniformID(name), tex_id, type);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "external/glad/glad.h"
+#include "core/uniform_cache.hpp"
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace bonobo
+{
+	struct mesh_data;
+}
+
+//! \brief Renders many copies of one mesh with a single instanced draw.
+//!
+//! Instead of one `Node` per copy, each with its own draw call and
+//! uniform uploads, the per-copy data lives in a buffer that is sourced
+//! by the vertex shader through the `instance_model_to_world` (binding
+//! points 5 to 8) and `instance_parameters` (binding point 9) attributes;
+//! see `shaders/EDAF80/instanced.vert`.
+class InstancedNode
+{
+public:
+	//! \brief Per-instance data, as laid out in the instance buffer.
+	struct instance {
+		glm::mat4 model_to_world; //!< transform from model-space to world-space
+		glm::vec4 parameters;     //!< free for the shader to interpret, e.g. a tint or an animation phase
+	};
+
+	//! \brief Default constructor.
+	InstancedNode();
+
+	//! \brief Release the OpenGL objects owned by this node; the mesh
+	//!        itself is left untouched.
+	~InstancedNode();
+
+	InstancedNode(InstancedNode const&) = delete;
+	InstancedNode& operator=(InstancedNode const&) = delete;
+
+	//! \brief Render all instances.
+	//!
+	//! @param [in] world_to_clip Matrix transforming from world-space to
+	//!             clip-space
+	void render(glm::mat4 const& world_to_clip) const;
+
+	//! \brief Render all instances with a specific shader program.
+	//!
+	//! @param [in] world_to_clip Matrix transforming from world-space to
+	//!             clip-space
+	//! @param [in] program OpenGL shader program to use; it should read
+	//!             the per-instance attributes
+	//! @param [in] set_uniforms function that will take as argument an
+	//!             OpenGL shader program, and will setup that program's
+	//!             uniforms
+	void render(glm::mat4 const& world_to_clip, GLuint program,
+	            std::function<void (GLuint)> const& set_uniforms) const;
+
+	//! \brief Set the geometry shared by all instances.
+	//!
+	//! The node gets its own Vertex Array Object sourcing the buffers of
+	//! `shape`, so several instanced nodes may share the same mesh; those
+	//! buffers must outlive the node.
+	//!
+	//! @param [in] shape OpenGL data to use as geometry
+	void set_geometry(bonobo::mesh_data const& shape);
+
+	//! \brief Replace the instances to render.
+	//!
+	//! The buffer is orphaned and refilled, so this can be called every
+	//! frame without waiting on draws still using the previous content.
+	//!
+	//! @param [in] instances data of each instance, in any order
+	void set_instances(std::vector<instance> const& instances);
+
+	//! \brief Get the number of instances drawn by `render()`.
+	size_t get_instances_nb() const { return _instances_nb; }
+
+	//! \brief Set the program of this node.
+	//!
+	//! @param [in] program OpenGL shader program to use
+	//! @param [in] set_uniforms function that will take as argument an
+	//!             OpenGL shader program, and will setup that program's
+	//!             uniforms
+	void set_program(GLuint program, std::function<void (GLuint)> const& set_uniforms);
+
+	//! \brief Add a texture to this node.
+	//!
+	//! @param [in] name the variable name used by the attached OpenGL
+	//!                  shader program
+	//! @param [in] tex_id the name of an OpenGL texture
+	//! @param [in] type the type of texture, i.e. GL_TEXTURE_2D,
+	//!                  GL_TEXTURE_CUBE_MAP, etc.
+	void add_texture(std::string const& name, GLuint tex_id, GLenum type);
+
+private:
+	// Geometry data
+	GLuint _vao;
+	GLsizei _vertices_nb;
+	GLsizei _indices_nb;
+	size_t _first_index;
+	GLint _base_vertex;
+	GLenum _drawing_mode;
+	GLenum _index_type;
+	bool _has_indices;
+
+	// Instance data
+	GLuint _instance_bo;
+	size_t _instance_capacity;
+	size_t _instances_nb;
+
+	// Program data
+	GLuint _program;
+	std::function<void (GLuint)> _set_uniforms;
+
+	// Textures data, as (interned sampler name, texture name, target)
+	std::vector<std::tuple<bonobo::uniform_id, GLuint, GLenum>> _textures;
+};
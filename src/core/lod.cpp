@@ -0,0 +1,60 @@
+#include "lod.hpp"
+
+#include "core/node.hpp"
+
+#include <algorithm>
+
+namespace local
+{
+	// Errors are projected from this distance at least, so that the
+	// camera touching a sphere does not divide by zero.
+	constexpr float min_distance = 1e-4f;
+
+	static size_t coarsest_below(std::vector<bonobo::mesh_lod> const& lods, float error_to_px, float limit_px)
+	{
+		size_t level = 0u;
+		for (size_t i = 0u; i < lods.size() && lods[i].error * error_to_px <= limit_px; ++i)
+			level = i + 1u;
+		return level;
+	}
+}
+
+size_t
+bonobo::selectLod(lod_view const& view, bounding_sphere const& sphere, float scale,
+                  std::vector<mesh_lod> const& lods, size_t current)
+{
+	if (lods.empty() || sphere.radius < 0.0f || view.pixels_per_unit <= 0.0f)
+		return 0u;
+
+	auto const distance = glm::length(sphere.center - view.position) - sphere.radius;
+	if (distance <= 0.0f)
+		return 0u;
+
+	// Levels are sorted from finest to coarsest, so their errors grow.
+	auto const error_to_px = scale * view.pixels_per_unit / std::max(distance, local::min_distance);
+	auto const level = local::coarsest_below(lods, error_to_px, view.max_error_px);
+	if (level <= current)
+		return level;
+
+	auto const coarser_level = local::coarsest_below(lods, error_to_px, view.max_error_px * (1.0f - view.hysteresis));
+	return std::max(coarser_level, std::min(current, lods.size()));
+}
+
+bonobo::lod_stats
+bonobo::selectLods(lod_view const& view, std::vector<Node>& nodes)
+{
+	lod_stats stats;
+	for (auto& node : nodes) {
+		if (node.get_vao() == 0u)
+			continue;
+		auto const full_indices_nb = node.get_lod_indices_nb(0u);
+		auto const level = node.select_lod(view, node.get_transform());
+
+		++stats.nodes_nb;
+		if (level > 0u)
+			++stats.coarser_nodes_nb;
+		stats.full_indices_nb += full_indices_nb;
+		stats.selected_indices_nb += node.get_indices_nb();
+	}
+	return stats;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "core/bounds.hpp"
+
+#include "external/glad/glad.h"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+class Node;
+
+namespace bonobo
+{
+	//! \brief Coarser version of a mesh, stored in the same buffers as
+	//!        its full-detail version.
+	struct mesh_lod {
+		size_t first_index; //!< position of its first index, relative to the mesh's `first_index`
+		size_t indices_nb;  //!< number of indices
+		GLint base_vertex;  //!< value added to its indices, on top of the mesh's `base_vertex`
+		float error;        //!< largest distance to the full-detail surface, in object space
+	};
+
+	//! \brief What level of detail selection needs to know of a camera,
+	//!        see `FPSCamera::GetLodView()`.
+	struct lod_view {
+		glm::vec3 position;    //!< world-space position of the camera
+		float pixels_per_unit; //!< height in pixels of one world unit, one unit in front of the camera
+		float max_error_px;    //!< largest error tolerated on screen, in pixels
+		float hysteresis;      //!< fraction of `max_error_px` an error must drop below before switching to a coarser level
+
+		lod_view() : position(0.0f), pixels_per_unit(0.0f), max_error_px(1.0f), hysteresis(0.25f)
+		{
+		}
+	};
+
+	//! \brief Geometry drawn by a set of nodes, at full detail and at the
+	//!        selected levels.
+	struct lod_stats {
+		size_t nodes_nb;            //!< nodes with geometry
+		size_t coarser_nodes_nb;    //!< nodes drawn at a coarser level than the full detail
+		size_t full_indices_nb;     //!< indices the nodes would draw at full detail
+		size_t selected_indices_nb; //!< indices the nodes draw at their selected level
+
+		lod_stats() : nodes_nb(0u), coarser_nodes_nb(0u), full_indices_nb(0u), selected_indices_nb(0u)
+		{
+		}
+
+		lod_stats& operator+=(lod_stats const& other)
+		{
+			nodes_nb += other.nodes_nb;
+			coarser_nodes_nb += other.coarser_nodes_nb;
+			full_indices_nb += other.full_indices_nb;
+			selected_indices_nb += other.selected_indices_nb;
+			return *this;
+		}
+	};
+
+	//! \brief Pick the coarsest level whose error covers at most
+	//!        `view.max_error_px` on screen.
+	//!
+	//! The error of a level is projected from the point of the bounding
+	//! sphere closest to the camera; from inside the sphere, the full
+	//! detail is always used. To avoid flickering between two levels
+	//! when the camera hovers around the distance separating them, a
+	//! coarser level is only picked once its error has dropped by
+	//! `view.hysteresis` below the limit.
+	//!
+	//! @param [in] view camera to select for
+	//! @param [in] sphere world-space bounding sphere of the geometry
+	//! @param [in] scale factor from object-space to world-space lengths
+	//! @param [in] lods coarser levels, from finest to coarsest
+	//! @param [in] current level currently used, 0 being the full detail
+	//!             and i being `lods[i - 1]`
+	//! @return the level to use, with the same numbering as `current`
+	size_t selectLod(lod_view const& view, bounding_sphere const& sphere, float scale,
+	                 std::vector<mesh_lod> const& lods, size_t current);
+
+	//! \brief Select the level of detail of many nodes, see
+	//!        `Node::select_lod()`.
+	//!
+	//! @param [in] view camera to select for
+	//! @param [in,out] nodes nodes placed in world-space by their own
+	//!                 transform; children are not visited
+	//! @return the geometry drawn by the nodes before and after selection
+	lod_stats selectLods(lod_view const& view, std::vector<Node>& nodes);
+}
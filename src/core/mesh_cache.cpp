@@ -0,0 +1,306 @@
+#include "mesh_cache.hpp"
+
+#include "core/Log.h"
+#include "core/vertex_format.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace local
+{
+	static char const magic[8] = { 'B', 'N', 'B', 'M', 'E', 'S', 'H', '\0' };
+
+	struct file_header {
+		char magic[8];
+		uint32_t version;
+		uint32_t materials_nb;
+		uint32_t meshes_nb;
+		uint32_t strings_size;
+		uint64_t source_hash;
+		uint64_t strings_offset;
+		uint64_t meshes_offset;
+	};
+
+	struct mesh_record {
+		uint32_t attributes;
+		uint32_t material_id;
+		uint32_t vertices_nb;
+		uint32_t indices_nb;
+		uint32_t drawing_mode;
+		uint32_t format;
+		float bounds_min[3];
+		float bounds_max[3];
+		float sphere_center[3];
+		float sphere_radius;
+		uint64_t vertex_data_offset;
+		uint64_t vertex_data_size;
+		uint64_t indices_offset;
+		uint64_t lods_offset;
+		uint64_t lods_nb;
+	};
+
+	struct lod_record {
+		uint32_t first_index;
+		uint32_t indices_nb;
+		int32_t base_vertex;
+		float error;
+	};
+
+	constexpr uint64_t blob_alignment = 16u;
+
+	static uint64_t align(uint64_t offset)
+	{
+		return (offset + blob_alignment - 1u) & ~(blob_alignment - 1u);
+	}
+
+	static bool in_bounds(uint64_t offset, uint64_t size, size_t file_size)
+	{
+		return offset <= file_size && size <= file_size - offset;
+	}
+
+	static bool indices_in_range(uint32_t const* indices, uint32_t indices_nb, int64_t base_vertex, uint32_t vertices_nb)
+	{
+		for (uint32_t i = 0u; i < indices_nb; ++i) {
+			auto const index = base_vertex + indices[i];
+			if (index < 0 || index >= vertices_nb)
+				return false;
+		}
+		return true;
+	}
+}
+
+uint64_t
+bonobo::mesh_cache::hashSource(std::string const& scene_path)
+{
+	auto const source = utils::mapped_file(scene_path);
+	if (!source.is_open())
+		return 0u;
+
+	auto hash = utils::hash_fnv1a(source.data(), source.size());
+
+	// Materials live in separate files that assimp reads on its own, so
+	// fold them in too: editing a .mtl has to invalidate the cache.
+	auto const directory_end = scene_path.find_last_of("/\\");
+	auto const directory = directory_end == std::string::npos ? std::string("") : scene_path.substr(0u, directory_end + 1u);
+	auto const begin = reinterpret_cast<char const*>(source.data());
+	auto const end = begin + source.size();
+	for (auto line = begin; line < end;) {
+		auto line_end = static_cast<char const*>(std::memchr(line, '\n', static_cast<size_t>(end - line)));
+		if (line_end == nullptr)
+			line_end = end;
+		if (line_end - line > 7 && std::strncmp(line, "mtllib ", 7) == 0) {
+			auto library = std::string(line + 7, line_end);
+			while (!library.empty() && (library.back() == '\r' || library.back() == ' '))
+				library.pop_back();
+			auto const material_library = utils::mapped_file(directory + library);
+			if (material_library.is_open())
+				hash = utils::hash_fnv1a(material_library.data(), material_library.size(), hash);
+		}
+		line = line_end + 1;
+	}
+
+	return hash != 0u ? hash : 1u;
+}
+
+std::string
+bonobo::mesh_cache::cachePath(std::string const& scene_path)
+{
+	return scene_path + ".meshcache";
+}
+
+bool
+bonobo::mesh_cache::read(std::string const& cache_path, uint64_t source_hash, scene& out)
+{
+	auto file = utils::mapped_file(cache_path);
+	if (!file.is_open() || file.size() < sizeof(local::file_header))
+		return false;
+
+	local::file_header header;
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, local::magic, sizeof(local::magic)) != 0
+	 || header.version != version
+	 || header.source_hash != source_hash) {
+		LogInfo("Mesh cache \"%s\" is out of date", cache_path.c_str());
+		return false;
+	}
+	if (!local::in_bounds(header.strings_offset, header.strings_size, file.size())
+	 || !local::in_bounds(header.meshes_offset, static_cast<uint64_t>(header.meshes_nb) * sizeof(local::mesh_record), file.size())) {
+		LogWarning("Mesh cache \"%s\" is corrupted", cache_path.c_str());
+		return false;
+	}
+
+	auto materials = std::vector<material>(header.materials_nb);
+	auto string_cursor = header.strings_offset;
+	auto const strings_end = header.strings_offset + header.strings_size;
+	for (auto& material : materials) {
+		for (auto& texture : material.textures) {
+			uint32_t length = 0u;
+			if (string_cursor + sizeof(length) > strings_end)
+				return false;
+			std::memcpy(&length, file.data() + string_cursor, sizeof(length));
+			string_cursor += sizeof(length);
+			if (string_cursor + length > strings_end)
+				return false;
+			texture.assign(reinterpret_cast<char const*>(file.data() + string_cursor), length);
+			string_cursor += length;
+		}
+	}
+
+	auto meshes = std::vector<mesh>(header.meshes_nb);
+	for (uint32_t i = 0u; i < header.meshes_nb; ++i) {
+		local::mesh_record record;
+		std::memcpy(&record, file.data() + header.meshes_offset + i * sizeof(local::mesh_record), sizeof(record));
+		if (!local::in_bounds(record.vertex_data_offset, record.vertex_data_size, file.size())
+		 || !local::in_bounds(record.indices_offset, static_cast<uint64_t>(record.indices_nb) * sizeof(uint32_t), file.size())
+		 || record.indices_offset % sizeof(uint32_t) != 0u
+		 || record.lods_nb > file.size() / sizeof(local::lod_record)
+		 || !local::in_bounds(record.lods_offset, record.lods_nb * sizeof(local::lod_record), file.size())
+		 || record.format > static_cast<uint32_t>(vertex_format::interleaved_packed)
+		 || record.vertex_data_size != vertexSize(static_cast<vertex_format>(record.format), record.attributes) * record.vertices_nb) {
+			LogWarning("Mesh cache \"%s\" is corrupted", cache_path.c_str());
+			return false;
+		}
+
+		auto& mesh = meshes[i];
+		mesh.attributes = record.attributes;
+		mesh.material_id = record.material_id;
+		mesh.vertices_nb = record.vertices_nb;
+		mesh.indices_nb = record.indices_nb;
+		mesh.drawing_mode = static_cast<GLenum>(record.drawing_mode);
+		mesh.format = static_cast<vertex_format>(record.format);
+		mesh.bounds.min = glm::vec3(record.bounds_min[0], record.bounds_min[1], record.bounds_min[2]);
+		mesh.bounds.max = glm::vec3(record.bounds_max[0], record.bounds_max[1], record.bounds_max[2]);
+		mesh.sphere.center = glm::vec3(record.sphere_center[0], record.sphere_center[1], record.sphere_center[2]);
+		mesh.sphere.radius = record.sphere_radius;
+		mesh.vertex_data = file.data() + record.vertex_data_offset;
+		mesh.vertex_data_size = static_cast<size_t>(record.vertex_data_size);
+		mesh.indices = reinterpret_cast<uint32_t const*>(file.data() + record.indices_offset);
+
+		mesh.lods.resize(static_cast<size_t>(record.lods_nb));
+		for (size_t l = 0u; l < mesh.lods.size(); ++l) {
+			local::lod_record lod_record;
+			std::memcpy(&lod_record, file.data() + record.lods_offset + l * sizeof(local::lod_record), sizeof(lod_record));
+			if (static_cast<uint64_t>(lod_record.first_index) + lod_record.indices_nb > record.indices_nb
+			 || !local::indices_in_range(mesh.indices + lod_record.first_index, lod_record.indices_nb, lod_record.base_vertex, record.vertices_nb)) {
+				LogWarning("Mesh cache \"%s\" is corrupted", cache_path.c_str());
+				return false;
+			}
+			mesh.lods[l] = mesh_lod{ lod_record.first_index, lod_record.indices_nb, lod_record.base_vertex, lod_record.error };
+		}
+
+		// An out-of-range index would make the draws read past the vertex
+		// buffer, so such a cache is rebuilt rather than trusted.
+		auto const full_detail_indices_nb = mesh.lods.empty() ? record.indices_nb : mesh.lods.front().first_index;
+		if (full_detail_indices_nb > record.indices_nb
+		 || !local::indices_in_range(mesh.indices, static_cast<uint32_t>(full_detail_indices_nb), 0, record.vertices_nb)) {
+			LogWarning("Mesh cache \"%s\" is corrupted", cache_path.c_str());
+			return false;
+		}
+	}
+
+	out.materials = std::move(materials);
+	out.meshes = std::move(meshes);
+	out.owned_vertex_data.clear();
+	out.owned_indices.clear();
+	out.file = std::move(file);
+	return true;
+}
+
+bool
+bonobo::mesh_cache::write(std::string const& cache_path, uint64_t source_hash, scene const& in)
+{
+	auto strings = std::vector<uint8_t>();
+	for (auto const& material : in.materials) {
+		for (auto const& texture : material.textures) {
+			auto const length = static_cast<uint32_t>(texture.size());
+			auto const position = strings.size();
+			strings.resize(position + sizeof(length) + length);
+			std::memcpy(strings.data() + position, &length, sizeof(length));
+			std::memcpy(strings.data() + position + sizeof(length), texture.data(), length);
+		}
+	}
+
+	local::file_header header;
+	std::memcpy(header.magic, local::magic, sizeof(local::magic));
+	header.version = version;
+	header.materials_nb = static_cast<uint32_t>(in.materials.size());
+	header.meshes_nb = static_cast<uint32_t>(in.meshes.size());
+	header.strings_size = static_cast<uint32_t>(strings.size());
+	header.source_hash = source_hash;
+	header.strings_offset = sizeof(header);
+	header.meshes_offset = local::align(header.strings_offset + header.strings_size);
+
+	auto records = std::vector<local::mesh_record>(in.meshes.size());
+	auto lod_records = std::vector<std::vector<local::lod_record>>(in.meshes.size());
+	auto blob_offset = local::align(header.meshes_offset + records.size() * sizeof(local::mesh_record));
+	for (size_t i = 0u; i < in.meshes.size(); ++i) {
+		auto const& mesh = in.meshes[i];
+		auto& record = records[i];
+		record.attributes = mesh.attributes;
+		record.material_id = mesh.material_id;
+		record.vertices_nb = mesh.vertices_nb;
+		record.indices_nb = mesh.indices_nb;
+		record.drawing_mode = static_cast<uint32_t>(mesh.drawing_mode);
+		record.format = static_cast<uint32_t>(mesh.format);
+		for (glm::length_t k = 0; k < 3; ++k) {
+			record.bounds_min[k] = mesh.bounds.min[k];
+			record.bounds_max[k] = mesh.bounds.max[k];
+			record.sphere_center[k] = mesh.sphere.center[k];
+		}
+		record.sphere_radius = mesh.sphere.radius;
+		record.vertex_data_offset = blob_offset;
+		record.vertex_data_size = mesh.vertex_data_size;
+		blob_offset = local::align(blob_offset + record.vertex_data_size);
+		record.indices_offset = blob_offset;
+		blob_offset = local::align(blob_offset + static_cast<uint64_t>(mesh.indices_nb) * sizeof(uint32_t));
+
+		for (auto const& lod : mesh.lods)
+			lod_records[i].push_back(local::lod_record{ static_cast<uint32_t>(lod.first_index), static_cast<uint32_t>(lod.indices_nb),
+			                                            static_cast<int32_t>(lod.base_vertex), lod.error });
+		record.lods_offset = blob_offset;
+		record.lods_nb = lod_records[i].size();
+		blob_offset = local::align(blob_offset + record.lods_nb * sizeof(local::lod_record));
+	}
+
+	auto const temporary_path = cache_path + ".tmp";
+	{
+		auto file = std::ofstream(temporary_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			LogWarning("Could not create mesh cache \"%s\"", temporary_path.c_str());
+			return false;
+		}
+
+		char const padding[local::blob_alignment] = { 0 };
+		uint64_t position = 0u;
+		auto const write_at = [&file,&position,&padding](uint64_t offset, void const* data, uint64_t size){
+			file.write(padding, static_cast<std::streamsize>(offset - position));
+			file.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+			position = offset + size;
+		};
+
+		write_at(0u, &header, sizeof(header));
+		write_at(header.strings_offset, strings.data(), strings.size());
+		write_at(header.meshes_offset, records.data(), records.size() * sizeof(local::mesh_record));
+		for (size_t i = 0u; i < in.meshes.size(); ++i) {
+			write_at(records[i].vertex_data_offset, in.meshes[i].vertex_data, records[i].vertex_data_size);
+			write_at(records[i].indices_offset, in.meshes[i].indices, static_cast<uint64_t>(records[i].indices_nb) * sizeof(uint32_t));
+			write_at(records[i].lods_offset, lod_records[i].data(), records[i].lods_nb * sizeof(local::lod_record));
+		}
+
+		if (!file.good()) {
+			LogWarning("Failed to write mesh cache \"%s\"", temporary_path.c_str());
+			file.close();
+			std::remove(temporary_path.c_str());
+			return false;
+		}
+	}
+
+	std::remove(cache_path.c_str()); // std::rename() does not overwrite on Windows
+	if (std::rename(temporary_path.c_str(), cache_path.c_str()) != 0) {
+		LogWarning("Failed to move mesh cache into \"%s\"", cache_path.c_str());
+		std::remove(temporary_path.c_str());
+		return false;
+	}
+	return true;
+}
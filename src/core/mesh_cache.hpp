@@ -0,0 +1,112 @@
+#pragma once
+
+#include "core/helpers.hpp"
+#include "core/various.hpp"
+
+#include "external/glad/glad.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief On-disk cache of scenes imported through assimp.
+	//!
+	//! A cache file sits next to the scene it was built from and stores
+	//! the vertex and index data exactly as they are uploaded to OpenGL,
+	//! already reordered by `bonobo::optimizeMesh()` and followed by the
+	//! levels of detail of `bonobo::buildLodChain()`, along with the
+	//! textures used by each material. It is memory-mapped when read
+	//! back, so the blobs go straight into `glBufferData()`.
+	namespace mesh_cache
+	{
+		//! \brief Bumped whenever the layout of the file changes; older
+		//!        caches are then rebuilt.
+		constexpr uint32_t version = 5u;
+
+		//! \brief Texture slots stored for each material, in order.
+		enum class texture_slot : unsigned int {
+			diffuse = 0u,
+			specular,
+			normals,
+			opacity,
+			count
+		};
+
+		//! \brief Textures used by a material, as paths relative to the
+		//!        scene file; an empty path means no texture.
+		struct material {
+			std::array<std::string, static_cast<size_t>(texture_slot::count)> textures;
+		};
+
+		//! \brief View onto the data of one mesh.
+		//!
+		//! The vertex data is laid out according to `format`, as produced
+		//! by `bonobo::packVertices()`; only the attributes whose bit is
+		//! set in `attributes` are present.
+		struct mesh {
+			uint32_t attributes;       //!< bit i set if attribute `bonobo::shader_bindings(i)` is present
+			vertex_format format;      //!< layout of vertex_data
+			uint32_t material_id;      //!< index into `scene::materials`
+			uint32_t vertices_nb;      //!< number of vertices
+			uint32_t indices_nb;       //!< number of 32-bit indices, of every level of detail
+			GLenum drawing_mode;       //!< GL_TRIANGLES, GL_LINES or GL_POINTS
+			aabb bounds;               //!< object-space bounding box of the vertices
+			bounding_sphere sphere;    //!< object-space bounding sphere of the vertices
+			uint8_t const* vertex_data;
+			size_t vertex_data_size;
+			uint32_t const* indices;
+			std::vector<mesh_lod> lods; //!< coarser levels of detail, whose indices follow the full-detail ones
+		};
+
+		//! \brief Content of a cache file, or of a freshly imported scene.
+		//!
+		//! The views in `meshes` point either into `file` or into the
+		//! owned buffers, so a scene must not be copied.
+		struct scene {
+			std::vector<material> materials;
+			std::vector<mesh> meshes;
+
+			utils::mapped_file file;
+			std::vector<std::vector<uint8_t>> owned_vertex_data;
+			std::vector<std::vector<uint32_t>> owned_indices;
+
+			scene() = default;
+			scene(scene const&) = delete;
+			scene& operator=(scene const&) = delete;
+		};
+
+		//! \brief Hash a scene file along with the material libraries it
+		//!        references.
+		//!
+		//! @param [in] scene_path path to the source `.obj` file
+		//! @return hash of the content, 0 if the file could not be read
+		uint64_t hashSource(std::string const& scene_path);
+
+		//! \brief Path of the cache file for a given scene.
+		std::string cachePath(std::string const& scene_path);
+
+		//! \brief Map a cache file and check it was built from the
+		//!        expected source.
+		//!
+		//! @param [in] cache_path path to the cache file
+		//! @param [in] source_hash value returned by `hashSource()`
+		//! @param [out] out scene whose views will point into the mapping
+		//! @return whether the cache was valid and has been loaded
+		bool read(std::string const& cache_path, uint64_t source_hash, scene& out);
+
+		//! \brief Write a scene to a cache file.
+		//!
+		//! The file is first written under a temporary name and then
+		//! renamed, so that an interrupted write never leaves a
+		//! truncated cache behind.
+		//!
+		//! @param [in] cache_path path to the cache file
+		//! @param [in] source_hash value returned by `hashSource()`
+		//! @param [in] in scene to write
+		//! @return whether writing succeeded
+		bool write(std::string const& cache_path, uint64_t source_hash, scene const& in);
+	}
+}
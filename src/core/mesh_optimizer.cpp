@@ -0,0 +1,382 @@
+#include "mesh_optimizer.hpp"
+
+#include "core/vertex_format.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace local
+{
+	constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+	constexpr size_t fetch_line_size = 64u;
+	constexpr size_t fetch_lines_nb = 256u;
+
+	// Planar attributes are fetched from as many streams, which all
+	// behave the same; interleaved ones from a single stream.
+	static size_t stream_element_size(bonobo::vertex_format format, uint32_t attributes)
+	{
+		return format == bonobo::vertex_format::planar_float ? sizeof(glm::vec3)
+		                                                     : bonobo::vertexSize(format, attributes);
+	}
+
+	// FIFO cache: a vertex is in it if fewer than cache_size misses
+	// happened since it was loaded.
+	struct vertex_cache {
+		std::vector<size_t> loaded_at;
+		size_t clock;
+		size_t size;
+
+		vertex_cache(size_t vertices_nb, size_t cache_size) : loaded_at(vertices_nb, 0u), clock(cache_size), size(cache_size)
+		{
+		}
+
+		bool load(uint32_t v)
+		{
+			if (clock - loaded_at[v] < size)
+				return false;
+			loaded_at[v] = clock++;
+			return true;
+		}
+
+		size_t load_triangle(uint32_t const* triangle)
+		{
+			return static_cast<size_t>(load(triangle[0])) + load(triangle[1]) + load(triangle[2]);
+		}
+
+		void flush()
+		{
+			clock += size;
+		}
+	};
+
+	// Triangles using each vertex, stored contiguously.
+	struct adjacency {
+		std::vector<uint32_t> counts;
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> triangles;
+
+		adjacency(uint32_t const* indices, size_t indices_nb, size_t vertices_nb) : counts(vertices_nb, 0u), offsets(vertices_nb + 1u, 0u), triangles(indices_nb)
+		{
+			for (size_t i = 0u; i < indices_nb; ++i)
+				++counts[indices[i]];
+			for (size_t v = 0u; v < vertices_nb; ++v)
+				offsets[v + 1u] = offsets[v] + counts[v];
+
+			auto cursors = std::vector<uint32_t>(offsets.begin(), offsets.end() - 1);
+			for (size_t i = 0u; i < indices_nb; ++i)
+				triangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3u);
+		}
+	};
+}
+
+bonobo::vertex_cache_stats
+bonobo::analyzeVertexCache(uint32_t const* indices, size_t indices_nb, size_t vertices_nb, unsigned int cache_size)
+{
+	assert(indices_nb % 3u == 0u);
+
+	auto cache = local::vertex_cache(vertices_nb, cache_size);
+	auto used = std::vector<bool>(vertices_nb, false);
+	size_t misses_nb = 0u, used_nb = 0u;
+	for (size_t i = 0u; i < indices_nb; ++i) {
+		auto const v = indices[i];
+		assert(v < vertices_nb);
+		if (!used[v]) {
+			used[v] = true;
+			++used_nb;
+		}
+		if (cache.load(v))
+			++misses_nb;
+	}
+
+	vertex_cache_stats stats;
+	stats.acmr = indices_nb > 0u ? static_cast<float>(misses_nb) / static_cast<float>(indices_nb / 3u) : 0.0f;
+	stats.atvr = used_nb > 0u ? static_cast<float>(misses_nb) / static_cast<float>(used_nb) : 0.0f;
+	return stats;
+}
+
+float
+bonobo::analyzeVertexFetch(uint32_t const* indices, size_t indices_nb, size_t vertices_nb, size_t vertex_size)
+{
+	if (vertices_nb == 0u || vertex_size == 0u)
+		return 0.0f;
+
+	// Direct-mapped, which is pessimistic but enough to compare orders.
+	auto lines = std::vector<size_t>(local::fetch_lines_nb, std::numeric_limits<size_t>::max());
+	size_t fetched_bytes = 0u;
+	for (size_t i = 0u; i < indices_nb; ++i) {
+		auto const begin = static_cast<size_t>(indices[i]) * vertex_size;
+		auto const end = begin + vertex_size;
+		for (auto line = begin / local::fetch_line_size; line <= (end - 1u) / local::fetch_line_size; ++line) {
+			auto& slot = lines[line % local::fetch_lines_nb];
+			if (slot == line)
+				continue;
+			slot = line;
+			fetched_bytes += local::fetch_line_size;
+		}
+	}
+
+	return static_cast<float>(fetched_bytes) / static_cast<float>(vertices_nb * vertex_size);
+}
+
+std::vector<uint32_t>
+bonobo::optimizeVertexCache(uint32_t* indices, size_t indices_nb, size_t vertices_nb, unsigned int cache_size)
+{
+	assert(indices_nb % 3u == 0u);
+
+	auto clusters = std::vector<uint32_t>();
+	if (indices_nb == 0u)
+		return clusters;
+
+	auto const adjacency = local::adjacency(indices, indices_nb, vertices_nb);
+	auto live_triangles = adjacency.counts;
+	auto emitted = std::vector<bool>(indices_nb / 3u, false);
+	auto cache = local::vertex_cache(vertices_nb, cache_size);
+
+	auto output = std::vector<uint32_t>();
+	output.reserve(indices_nb);
+	auto dead_ends = std::vector<uint32_t>();
+	auto candidates = std::vector<uint32_t>();
+	size_t cursor = 0u;
+
+	// Prefer recently used vertices, which are likely still cached,
+	// then scan for any vertex with triangles left.
+	auto const skip_dead_end = [&]() -> uint32_t {
+		while (!dead_ends.empty()) {
+			auto const v = dead_ends.back();
+			dead_ends.pop_back();
+			if (live_triangles[v] > 0u)
+				return v;
+		}
+		for (; cursor < vertices_nb; ++cursor)
+			if (live_triangles[cursor] > 0u)
+				return static_cast<uint32_t>(cursor);
+		return local::none;
+	};
+
+	// Pick the candidate that will still be cached after its whole fan
+	// is emitted, and among those the one loaded the longest ago.
+	auto const next_vertex = [&]() -> uint32_t {
+		auto best = local::none;
+		long best_priority = -1;
+		for (auto const v : candidates) {
+			if (live_triangles[v] == 0u)
+				continue;
+			long priority = 0;
+			auto const age = static_cast<long>(cache.clock - cache.loaded_at[v]);
+			if (age + 2 * static_cast<long>(live_triangles[v]) <= static_cast<long>(cache_size))
+				priority = age;
+			if (priority > best_priority) {
+				best_priority = priority;
+				best = v;
+			}
+		}
+		return best;
+	};
+
+	auto fan = skip_dead_end();
+	while (fan != local::none) {
+		candidates.clear();
+		for (auto k = adjacency.offsets[fan]; k < adjacency.offsets[fan + 1u]; ++k) {
+			auto const triangle = adjacency.triangles[k];
+			if (emitted[triangle])
+				continue;
+			emitted[triangle] = true;
+			for (size_t corner = 0u; corner < 3u; ++corner) {
+				auto const v = indices[3u * triangle + corner];
+				output.push_back(v);
+				dead_ends.push_back(v);
+				candidates.push_back(v);
+				--live_triangles[v];
+				cache.load(v);
+			}
+		}
+
+		fan = next_vertex();
+		if (fan == local::none) {
+			// Jumping elsewhere ends the current cluster.
+			auto const triangles_nb = static_cast<uint32_t>(output.size() / 3u);
+			if (clusters.empty() || clusters.back() != triangles_nb)
+				clusters.push_back(triangles_nb);
+			fan = skip_dead_end();
+		}
+	}
+	assert(output.size() == indices_nb);
+
+	// The first cluster starts at 0, and the last boundary is the end.
+	clusters.pop_back();
+	clusters.insert(clusters.begin(), 0u);
+
+	std::memcpy(indices, output.data(), indices_nb * sizeof(uint32_t));
+	return clusters;
+}
+
+size_t
+bonobo::optimizeOverdraw(uint32_t* indices, size_t indices_nb, glm::vec3 const* positions, size_t vertices_nb,
+                         std::vector<uint32_t> const& clusters, float threshold, unsigned int cache_size)
+{
+	assert(indices_nb % 3u == 0u);
+
+	auto const triangles_nb = static_cast<uint32_t>(indices_nb / 3u);
+	if (triangles_nb == 0u || clusters.empty())
+		return 0u;
+
+	// Split each cluster wherever its ACMR so far, starting from an
+	// empty cache, is within the threshold of its whole ACMR; each split
+	// empties the cache again, and splits are undone if the cluster then
+	// ends up over the threshold.
+	auto cache = local::vertex_cache(vertices_nb, cache_size);
+	auto boundaries = std::vector<uint32_t>();
+	for (size_t c = 0u; c < clusters.size(); ++c) {
+		auto const begin = clusters[c];
+		auto const end = c + 1u < clusters.size() ? clusters[c + 1u] : triangles_nb;
+
+		cache.flush();
+		size_t misses_nb = 0u;
+		for (auto t = begin; t < end; ++t)
+			misses_nb += cache.load_triangle(indices + 3u * t);
+		auto const target_acmr = threshold * static_cast<float>(misses_nb) / static_cast<float>(end - begin);
+
+		auto const first_boundary = boundaries.size();
+		boundaries.push_back(begin);
+		cache.flush();
+		size_t split_misses_nb = 0u, running_misses_nb = 0u, running_triangles_nb = 0u;
+		for (auto t = begin; t < end; ++t) {
+			auto const triangle_misses_nb = cache.load_triangle(indices + 3u * t);
+			split_misses_nb += triangle_misses_nb;
+			running_misses_nb += triangle_misses_nb;
+			++running_triangles_nb;
+			if (t + 1u < end && static_cast<float>(running_misses_nb) <= target_acmr * static_cast<float>(running_triangles_nb)) {
+				boundaries.push_back(t + 1u);
+				cache.flush();
+				running_misses_nb = 0u;
+				running_triangles_nb = 0u;
+			}
+		}
+		if (static_cast<float>(split_misses_nb) > target_acmr * static_cast<float>(end - begin))
+			boundaries.resize(first_boundary + 1u);
+	}
+
+	// Area-weighted centroid and normal of each cluster.
+	struct cluster {
+		uint32_t begin;
+		uint32_t end;
+		glm::vec3 centroid;
+		glm::vec3 normal;
+		float area;
+		float sort_key;
+	};
+	auto sorted = std::vector<cluster>(boundaries.size());
+	auto mesh_centroid = glm::vec3(0.0f);
+	auto mesh_area = 0.0f;
+	for (size_t c = 0u; c < boundaries.size(); ++c) {
+		auto& cl = sorted[c];
+		cl.begin = boundaries[c];
+		cl.end = c + 1u < boundaries.size() ? boundaries[c + 1u] : triangles_nb;
+		cl.centroid = glm::vec3(0.0f);
+		cl.normal = glm::vec3(0.0f);
+		cl.area = 0.0f;
+		for (auto t = cl.begin; t < cl.end; ++t) {
+			auto const& a = positions[indices[3u * t]];
+			auto const& b = positions[indices[3u * t + 1u]];
+			auto const& d = positions[indices[3u * t + 2u]];
+			auto const normal = glm::cross(b - a, d - a);
+			auto const area = glm::length(normal);
+			cl.centroid += (a + b + d) * (area / 3.0f);
+			cl.normal += normal;
+			cl.area += area;
+		}
+		mesh_centroid += cl.centroid;
+		mesh_area += cl.area;
+		cl.centroid = cl.area > 0.0f ? cl.centroid / cl.area : positions[indices[3u * cl.begin]];
+	}
+	if (mesh_area > 0.0f)
+		mesh_centroid /= mesh_area;
+
+	for (auto& cl : sorted) {
+		auto const length = glm::length(cl.normal);
+		cl.sort_key = length > 0.0f ? glm::dot(cl.centroid - mesh_centroid, cl.normal / length) : 0.0f;
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](cluster const& a, cluster const& b){
+		return a.sort_key > b.sort_key;
+	});
+
+	auto output = std::vector<uint32_t>();
+	output.reserve(indices_nb);
+	for (auto const& cl : sorted)
+		output.insert(output.end(), indices + 3u * cl.begin, indices + 3u * cl.end);
+	std::memcpy(indices, output.data(), indices_nb * sizeof(uint32_t));
+
+	return sorted.size();
+}
+
+std::vector<uint32_t>
+bonobo::optimizeVertexFetch(uint32_t* indices, size_t indices_nb, size_t vertices_nb)
+{
+	auto remap = std::vector<uint32_t>(vertices_nb, local::none);
+	uint32_t next = 0u;
+	for (size_t i = 0u; i < indices_nb; ++i) {
+		auto& position = remap[indices[i]];
+		if (position == local::none)
+			position = next++;
+		indices[i] = position;
+	}
+	for (auto& position : remap)
+		if (position == local::none)
+			position = next++;
+	assert(next == vertices_nb);
+
+	return remap;
+}
+
+void
+bonobo::remapVertices(vertex_format format, uint32_t attributes, size_t vertices_nb, uint8_t* data,
+                      std::vector<uint32_t> const& remap)
+{
+	assert(remap.size() == vertices_nb);
+
+	auto const element_size = local::stream_element_size(format, attributes);
+	if (element_size == 0u)
+		return;
+	auto const streams_nb = vertexSize(format, attributes) / element_size;
+	auto const stream_size = element_size * vertices_nb;
+
+	auto original = std::vector<uint8_t>(stream_size);
+	for (size_t s = 0u; s < streams_nb; ++s) {
+		auto const stream = data + s * stream_size;
+		std::memcpy(original.data(), stream, stream_size);
+		for (size_t v = 0u; v < vertices_nb; ++v)
+			std::memcpy(stream + remap[v] * element_size, original.data() + v * element_size, element_size);
+	}
+}
+
+bonobo::mesh_optimization_stats
+bonobo::optimizeMesh(vertex_format format, uint32_t attributes, glm::vec3 const* positions,
+                     size_t vertices_nb, uint8_t* vertex_data, uint32_t* indices, size_t indices_nb,
+                     std::vector<uint32_t>* remap)
+{
+	auto const element_size = local::stream_element_size(format, attributes);
+
+	mesh_optimization_stats stats;
+	stats.input = analyzeVertexCache(indices, indices_nb, vertices_nb);
+	stats.input_overfetch = analyzeVertexFetch(indices, indices_nb, vertices_nb, element_size);
+
+	auto const clusters = optimizeVertexCache(indices, indices_nb, vertices_nb);
+	stats.vertex_cache = analyzeVertexCache(indices, indices_nb, vertices_nb);
+
+	// Positions are still in their original order, as are the indices.
+	stats.clusters_nb = optimizeOverdraw(indices, indices_nb, positions, vertices_nb, clusters);
+	stats.overdraw = analyzeVertexCache(indices, indices_nb, vertices_nb);
+
+	auto fetch_remap = optimizeVertexFetch(indices, indices_nb, vertices_nb);
+	remapVertices(format, attributes, vertices_nb, vertex_data, fetch_remap);
+	stats.overfetch = analyzeVertexFetch(indices, indices_nb, vertices_nb, element_size);
+
+	if (remap != nullptr)
+		*remap = std::move(fetch_remap);
+
+	return stats;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "helpers.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Number of entries of the FIFO post-transform vertex cache
+	//!        simulated by the functions below; small enough to be a
+	//!        conservative estimate of most GPUs.
+	constexpr unsigned int vertex_cache_size = 16u;
+
+	//! \brief How well an index buffer uses the post-transform vertex
+	//!        cache.
+	struct vertex_cache_stats {
+		float acmr; //!< average cache miss ratio: vertices transformed per triangle, from about 0.5 to 3
+		float atvr; //!< average transform to vertex ratio: vertices transformed per vertex used, 1 at best
+	};
+
+	//! \brief Statistics gathered by `optimizeMesh()`.
+	struct mesh_optimization_stats {
+		vertex_cache_stats input;        //!< before any reordering
+		vertex_cache_stats vertex_cache; //!< after `optimizeVertexCache()`
+		vertex_cache_stats overdraw;     //!< after `optimizeOverdraw()`
+		float input_overfetch;           //!< before `optimizeVertexFetch()`, see `analyzeVertexFetch()`
+		float overfetch;                 //!< after `optimizeVertexFetch()`
+		size_t clusters_nb;              //!< number of clusters sorted by `optimizeOverdraw()`
+	};
+
+	//! \brief Simulate a FIFO vertex cache over triangles.
+	//!
+	//! @param [in] indices of the triangles
+	//! @param [in] indices_nb number of indices, a multiple of 3
+	//! @param [in] vertices_nb number of vertices the indices refer to
+	//! @param [in] cache_size number of entries in the cache
+	vertex_cache_stats analyzeVertexCache(uint32_t const* indices, size_t indices_nb, size_t vertices_nb,
+	                                      unsigned int cache_size = vertex_cache_size);
+
+	//! \brief Estimate how much vertex memory is read when fetching the
+	//!        vertices of triangles, through a 16 KiB cache of 64-byte
+	//!        lines.
+	//!
+	//! @param [in] indices of the triangles
+	//! @param [in] indices_nb number of indices
+	//! @param [in] vertices_nb number of vertices the indices refer to
+	//! @param [in] vertex_size size of a vertex in the buffer fetched from
+	//! @return bytes read over the size of the vertex data, 1 at best
+	float analyzeVertexFetch(uint32_t const* indices, size_t indices_nb, size_t vertices_nb, size_t vertex_size);
+
+	//! \brief Reorder triangles for the post-transform vertex cache, using
+	//!        Tipsify (Sander et al., "Fast Triangle Reordering for Vertex
+	//!        Locality and Reduced Overdraw", 2007).
+	//!
+	//! Triangles are emitted in fans around vertices; the next fan is
+	//! chosen among the vertices still in the cache, and when none is,
+	//! the algorithm jumps elsewhere in the mesh. Those jumps split the
+	//! result into clusters, which `optimizeOverdraw()` can then sort
+	//! without hurting the cache much. Runs in linear time.
+	//!
+	//! @param [in,out] indices of the triangles, reordered in place
+	//! @param [in] indices_nb number of indices, a multiple of 3
+	//! @param [in] vertices_nb number of vertices the indices refer to
+	//! @param [in] cache_size number of entries in the targeted cache
+	//! @return index of the first triangle of each cluster, starting with 0
+	std::vector<uint32_t> optimizeVertexCache(uint32_t* indices, size_t indices_nb, size_t vertices_nb,
+	                                          unsigned int cache_size = vertex_cache_size);
+
+	//! \brief Reorder clusters of triangles so that those facing away from
+	//!        the centre of the mesh are drawn first, as they are the most
+	//!        likely to occlude the others.
+	//!
+	//! Clusters are first split further wherever the ACMR of the part
+	//! drawn so far, starting from an empty cache, is within `threshold`
+	//! of the ACMR of the whole cluster, also measured from an empty
+	//! cache; smaller clusters sort better, while cutting them there
+	//! costs little. A cluster is left whole if its parts would end up
+	//! over that threshold.
+	//!
+	//! @param [in,out] indices of the triangles, as output by
+	//!                 `optimizeVertexCache()`, reordered in place
+	//! @param [in] indices_nb number of indices, a multiple of 3
+	//! @param [in] positions of the vertices
+	//! @param [in] vertices_nb number of vertices
+	//! @param [in] clusters value returned by `optimizeVertexCache()`
+	//! @param [in] threshold largest tolerated ratio between the ACMR of
+	//!             the parts of a cluster and the ACMR of that cluster
+	//! @param [in] cache_size number of entries in the targeted cache
+	//! @return number of clusters sorted
+	size_t optimizeOverdraw(uint32_t* indices, size_t indices_nb, glm::vec3 const* positions, size_t vertices_nb,
+	                        std::vector<uint32_t> const& clusters, float threshold = 1.05f,
+	                        unsigned int cache_size = vertex_cache_size);
+
+	//! \brief Renumber vertices in the order they are first used, so that
+	//!        fetching them walks through memory.
+	//!
+	//! Unused vertices are moved to the end.
+	//!
+	//! @param [in,out] indices of the primitives, rewritten in place
+	//! @param [in] indices_nb number of indices
+	//! @param [in] vertices_nb number of vertices
+	//! @return new position of each vertex, to pass to `remapVertices()`
+	std::vector<uint32_t> optimizeVertexFetch(uint32_t* indices, size_t indices_nb, size_t vertices_nb);
+
+	//! \brief Move vertices packed by `bonobo::packVertices()` to new
+	//!        positions.
+	//!
+	//! @param [in] format layout of the data
+	//! @param [in] attributes bit i set if attribute
+	//!             `bonobo::shader_bindings(i)` is stored in the data
+	//! @param [in] vertices_nb number of vertices in the data
+	//! @param [in,out] data vertex data, rewritten in place
+	//! @param [in] remap new position of each vertex
+	void remapVertices(vertex_format format, uint32_t attributes, size_t vertices_nb, uint8_t* data,
+	                   std::vector<uint32_t> const& remap);
+
+	//! \brief Reorder the triangles and vertices of a mesh for the vertex
+	//!        cache, then for overdraw, then for vertex fetch.
+	//!
+	//! Only uses the CPU, so can be run from worker threads and ahead of
+	//! time; the result is the same mesh, drawn faster.
+	//!
+	//! @param [in] format layout of `vertex_data`
+	//! @param [in] attributes bit i set if attribute
+	//!             `bonobo::shader_bindings(i)` is stored in `vertex_data`
+	//! @param [in] positions of the vertices, in their original order
+	//! @param [in] vertices_nb number of vertices
+	//! @param [in,out] vertex_data vertices, as output by
+	//!                 `bonobo::packVertices()`
+	//! @param [in,out] indices of the triangles
+	//! @param [in] indices_nb number of indices, a multiple of 3
+	//! @param [out] remap if not null, receives the new position of each
+	//!              vertex, see `optimizeVertexFetch()`
+	//! @return the effect of each step
+	mesh_optimization_stats optimizeMesh(vertex_format format, uint32_t attributes, glm::vec3 const* positions,
+	                                     size_t vertices_nb, uint8_t* vertex_data, uint32_t* indices,
+	                                     size_t indices_nb, std::vector<uint32_t>* remap = nullptr);
+}
@@ -0,0 +1,331 @@
+#include "mesh_simplifier.hpp"
+
+#include "core/mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+namespace local
+{
+	// Collapses moving a triangle's normal by more than about 75 degrees
+	// are rejected, as they fold the surface onto itself.
+	constexpr float min_normal_cosine = 0.25f;
+
+	// Levels smaller than this cost more in draw calls than they save.
+	constexpr size_t min_lod_indices_nb = 3u * 32u;
+
+	// Levels keeping more than this fraction of the previous one's
+	// indices are not worth storing.
+	constexpr float max_lod_ratio = 0.75f;
+
+	// Sum of squared distances to a set of planes, as the symmetric 4x4
+	// matrix of Garland and Heckbert, stored as its upper triangle.
+	struct quadric {
+		double m[10];
+
+		quadric() : m()
+		{
+		}
+
+		void add_plane(glm::vec3 const& n, float d)
+		{
+			double const p[4] = { n.x, n.y, n.z, d };
+			size_t k = 0u;
+			for (size_t i = 0u; i < 4u; ++i)
+				for (size_t j = i; j < 4u; ++j)
+					m[k++] += p[i] * p[j];
+		}
+
+		quadric& operator+=(quadric const& other)
+		{
+			for (size_t k = 0u; k < 10u; ++k)
+				m[k] += other.m[k];
+			return *this;
+		}
+
+		double evaluate(glm::vec3 const& v) const
+		{
+			double const x = v.x, y = v.y, z = v.z;
+			return m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x
+			     + m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y
+			     + m[7] * z * z + 2.0 * m[8] * z
+			     + m[9];
+		}
+	};
+
+	struct collapse {
+		uint32_t from;
+		uint32_t to;
+		double cost;
+	};
+
+	static uint64_t edge_key(uint32_t a, uint32_t b)
+	{
+		return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+	}
+
+	// Edges of a closed, continuous surface are shared by exactly two
+	// triangles; any other count marks a border, a seam or a non-manifold
+	// edge, whose vertices must stay put.
+	static std::vector<bool> find_locked_vertices(uint32_t const* indices, size_t indices_nb, size_t vertices_nb)
+	{
+		auto edges = std::unordered_map<uint64_t, uint32_t>();
+		edges.reserve(indices_nb);
+		for (size_t t = 0u; t < indices_nb; t += 3u)
+			for (size_t k = 0u; k < 3u; ++k)
+				++edges[edge_key(indices[t + k], indices[t + (k + 1u) % 3u])];
+
+		auto locked = std::vector<bool>(vertices_nb, false);
+		for (auto const& edge : edges) {
+			if (edge.second == 2u)
+				continue;
+			locked[static_cast<uint32_t>(edge.first >> 32)] = true;
+			locked[static_cast<uint32_t>(edge.first)] = true;
+		}
+		return locked;
+	}
+
+	static glm::vec3 triangle_normal(glm::vec3 const& a, glm::vec3 const& b, glm::vec3 const& c)
+	{
+		return glm::cross(b - a, c - a);
+	}
+
+	// Distance from p to the closest point of triangle abc, following
+	// Ericson, "Real-Time Collision Detection", 5.1.5.
+	static float triangle_distance(glm::vec3 const& p, glm::vec3 const& a, glm::vec3 const& b, glm::vec3 const& c)
+	{
+		auto const ab = b - a, ac = c - a, ap = p - a;
+		auto const d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0.0f && d2 <= 0.0f)
+			return glm::length(ap);
+
+		auto const bp = p - b;
+		auto const d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0.0f && d4 <= d3)
+			return glm::length(bp);
+
+		auto const vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+			return glm::length(ap - ab * (d1 / (d1 - d3)));
+
+		auto const cp = p - c;
+		auto const d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0.0f && d5 <= d6)
+			return glm::length(cp);
+
+		auto const vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+			return glm::length(ap - ac * (d2 / (d2 - d6)));
+
+		auto const va = d3 * d6 - d5 * d4;
+		if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+			return glm::length(bp - (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6))));
+
+		auto const denominator = 1.0f / (va + vb + vc);
+		return glm::length(ap - ab * (vb * denominator) - ac * (vc * denominator));
+	}
+
+	// Triangles using each vertex v are triangles[offsets[v]] up to
+	// triangles[offsets[v + 1]].
+	static void build_adjacency(std::vector<uint32_t> const& indices, size_t vertices_nb,
+	                            std::vector<uint32_t>& offsets, std::vector<uint32_t>& triangles)
+	{
+		offsets.assign(vertices_nb + 1u, 0u);
+		for (auto const v : indices)
+			++offsets[v + 1u];
+		for (size_t v = 0u; v < vertices_nb; ++v)
+			offsets[v + 1u] += offsets[v];
+
+		triangles.resize(indices.size());
+		auto cursors = std::vector<uint32_t>(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0u; i < indices.size(); ++i)
+			triangles[cursors[indices[i]]++] = static_cast<uint32_t>(i / 3u);
+	}
+}
+
+std::vector<uint32_t>
+bonobo::simplifyMesh(uint32_t const* indices, size_t indices_nb, glm::vec3 const* positions,
+                     size_t vertices_nb, size_t target_indices_nb, float& error)
+{
+	assert(indices_nb % 3u == 0u);
+
+	error = 0.0f;
+	auto current = std::vector<uint32_t>(indices, indices + indices_nb);
+	auto const locked = local::find_locked_vertices(indices, indices_nb, vertices_nb);
+
+	auto quadrics = std::vector<local::quadric>(vertices_nb);
+	for (size_t t = 0u; t < indices_nb; t += 3u) {
+		auto const normal = local::triangle_normal(positions[indices[t]], positions[indices[t + 1u]], positions[indices[t + 2u]]);
+		auto const length = glm::length(normal);
+		if (length <= 0.0f)
+			continue;
+		auto const n = normal / length;
+		auto const d = -glm::dot(n, positions[indices[t]]);
+		for (size_t k = 0u; k < 3u; ++k)
+			quadrics[indices[t + k]].add_plane(n, d);
+	}
+
+	auto offsets = std::vector<uint32_t>(vertices_nb + 1u);
+	auto triangles = std::vector<uint32_t>();
+	auto candidates = std::vector<local::collapse>();
+	auto remap = std::vector<uint32_t>(vertices_nb);
+	auto touched = std::vector<bool>(vertices_nb);
+	auto marks = std::vector<size_t>(vertices_nb, 0u);
+	size_t mark = 0u;
+	auto collapsed_to = std::vector<uint32_t>(vertices_nb);
+	for (size_t v = 0u; v < vertices_nb; ++v)
+		collapsed_to[v] = static_cast<uint32_t>(v);
+
+	// Each pass collapses the cheapest edges whose neighbourhoods do not
+	// overlap, so that the triangles tested are still those of the mesh.
+	while (current.size() > target_indices_nb) {
+		local::build_adjacency(current, vertices_nb, offsets, triangles);
+
+		candidates.clear();
+		for (size_t t = 0u; t < current.size(); t += 3u) {
+			for (size_t k = 0u; k < 3u; ++k) {
+				auto const a = current[t + k], b = current[t + (k + 1u) % 3u];
+				auto q = quadrics[a];
+				q += quadrics[b];
+				if (!locked[a])
+					candidates.push_back(local::collapse{ a, b, q.evaluate(positions[b]) });
+				if (!locked[b])
+					candidates.push_back(local::collapse{ b, a, q.evaluate(positions[a]) });
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [](local::collapse const& x, local::collapse const& y){
+			return x.cost < y.cost;
+		});
+
+		// Each collapse removes about two triangles.
+		auto const collapses_budget = (current.size() - target_indices_nb) / 6u + 1u;
+		size_t collapses_nb = 0u;
+		for (size_t v = 0u; v < vertices_nb; ++v)
+			remap[v] = static_cast<uint32_t>(v);
+		std::fill(touched.begin(), touched.end(), false);
+
+		for (auto const& c : candidates) {
+			if (collapses_nb >= collapses_budget)
+				break;
+			if (touched[c.from] || touched[c.to])
+				continue;
+
+			// Vertices adjacent to both ends must be exactly the ones
+			// opposite the collapsed edge, or the surface would pinch.
+			auto const ring_begin = offsets[c.from], ring_end = offsets[c.from + 1u];
+			mark += 2u;
+			size_t shared_triangles_nb = 0u;
+			bool flips = false;
+			for (auto r = ring_begin; r < ring_end && !flips; ++r) {
+				auto const triangle = current.data() + 3u * triangles[r];
+				if (triangle[0] == c.to || triangle[1] == c.to || triangle[2] == c.to) {
+					++shared_triangles_nb;
+					continue;
+				}
+				for (size_t k = 0u; k < 3u; ++k)
+					marks[triangle[k]] = mark;
+				auto const before = local::triangle_normal(positions[triangle[0]], positions[triangle[1]], positions[triangle[2]]);
+				auto const moved = [&c,&positions](uint32_t v){ return positions[v == c.from ? c.to : v]; };
+				auto const after = local::triangle_normal(moved(triangle[0]), moved(triangle[1]), moved(triangle[2]));
+				flips = glm::dot(before, after) <= local::min_normal_cosine * glm::length(before) * glm::length(after);
+			}
+			if (flips)
+				continue;
+			for (auto r = ring_begin; r < ring_end; ++r) {
+				auto const triangle = current.data() + 3u * triangles[r];
+				if (triangle[0] == c.to || triangle[1] == c.to || triangle[2] == c.to)
+					for (size_t k = 0u; k < 3u; ++k)
+						marks[triangle[k]] = mark;
+			}
+			size_t common_nb = 0u;
+			for (auto r = offsets[c.to]; r < offsets[c.to + 1u]; ++r) {
+				auto const triangle = current.data() + 3u * triangles[r];
+				for (size_t k = 0u; k < 3u; ++k) {
+					auto const v = triangle[k];
+					if (v == c.from || v == c.to || marks[v] != mark)
+						continue;
+					marks[v] = mark + 1u;
+					++common_nb;
+				}
+			}
+			if (common_nb != shared_triangles_nb)
+				continue;
+
+			remap[c.from] = c.to;
+			quadrics[c.to] += quadrics[c.from];
+			touched[c.to] = true;
+			for (auto r = ring_begin; r < ring_end; ++r)
+				for (size_t k = 0u; k < 3u; ++k)
+					touched[current[3u * triangles[r] + k]] = true;
+			++collapses_nb;
+		}
+		if (collapses_nb == 0u)
+			break;
+		for (auto& v : collapsed_to)
+			v = remap[v];
+
+		size_t kept_nb = 0u;
+		for (size_t t = 0u; t < current.size(); t += 3u) {
+			auto const a = remap[current[t]], b = remap[current[t + 1u]], d = remap[current[t + 2u]];
+			if (a == b || b == d || d == a)
+				continue;
+			current[kept_nb++] = a;
+			current[kept_nb++] = b;
+			current[kept_nb++] = d;
+		}
+		current.resize(kept_nb);
+	}
+
+	// Quadrics add up the same planes several times, which makes them
+	// good for ranking collapses but overestimates the error; measure
+	// instead how far each removed vertex lies from the triangles around
+	// the vertex it was merged into. The surface cannot be further away
+	// than the closest of them.
+	local::build_adjacency(current, vertices_nb, offsets, triangles);
+	for (size_t v = 0u; v < vertices_nb; ++v) {
+		auto const to = collapsed_to[v];
+		if (to == v || offsets[to] == offsets[to + 1u])
+			continue;
+		auto distance = std::numeric_limits<float>::max();
+		for (auto r = offsets[to]; r < offsets[to + 1u]; ++r) {
+			auto const triangle = current.data() + 3u * triangles[r];
+			distance = std::min(distance, local::triangle_distance(positions[v], positions[triangle[0]],
+			                                                       positions[triangle[1]], positions[triangle[2]]));
+		}
+		error = std::max(error, distance);
+	}
+
+	return current;
+}
+
+std::vector<bonobo::mesh_lod>
+bonobo::buildLodChain(std::vector<uint32_t>& indices, glm::vec3 const* positions, size_t vertices_nb, size_t max_lods_nb)
+{
+	auto lods = std::vector<mesh_lod>();
+	auto const full_indices_nb = indices.size();
+	auto previous_indices_nb = full_indices_nb;
+	auto previous_error = 0.0f;
+	while (lods.size() < max_lods_nb) {
+		auto const target_indices_nb = previous_indices_nb / 6u * 3u;
+		if (target_indices_nb < local::min_lod_indices_nb)
+			break;
+
+		// Simplifying from the full detail every time keeps the error
+		// measured against it.
+		auto error = 0.0f;
+		auto lod = simplifyMesh(indices.data(), full_indices_nb, positions, vertices_nb, target_indices_nb, error);
+		if (static_cast<float>(lod.size()) > local::max_lod_ratio * static_cast<float>(previous_indices_nb))
+			break;
+		optimizeVertexCache(lod.data(), lod.size(), vertices_nb);
+
+		error = std::max(error, previous_error);
+		lods.push_back(mesh_lod{ indices.size(), lod.size(), 0, error });
+		indices.insert(indices.end(), lod.begin(), lod.end());
+		previous_indices_nb = lod.size();
+		previous_error = error;
+	}
+	return lods;
+}
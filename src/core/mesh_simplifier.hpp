@@ -0,0 +1,54 @@
+#pragma once
+
+#include "core/lod.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Remove triangles by collapsing edges, following the
+	//!        quadric error metric of Garland and Heckbert ("Surface
+	//!        Simplification Using Quadric Error Metrics", 1997).
+	//!
+	//! Each collapse moves a vertex onto one of its neighbours, so the
+	//! result only uses existing vertices and can share their buffer.
+	//! Vertices on an edge used by a single triangle, i.e. on a border or
+	//! on a seam between texture coordinates or normals, never move, so
+	//! that the mesh cannot crack open. Collapses that would flip a
+	//! triangle are rejected.
+	//!
+	//! @param [in] indices of the triangles
+	//! @param [in] indices_nb number of indices, a multiple of 3
+	//! @param [in] positions of the vertices
+	//! @param [in] vertices_nb number of vertices
+	//! @param [in] target_indices_nb number of indices to stop at; fewer
+	//!             triangles may be removed if collapses run out
+	//! @param [out] error largest distance from a removed vertex to the
+	//!              closest triangle around the vertex it was merged
+	//!              into
+	//! @return the indices of the remaining triangles
+	std::vector<uint32_t> simplifyMesh(uint32_t const* indices, size_t indices_nb, glm::vec3 const* positions,
+	                                   size_t vertices_nb, size_t target_indices_nb, float& error);
+
+	//! \brief Build coarser levels of detail of a mesh, each with about
+	//!        half the triangles of the previous one.
+	//!
+	//! Every level is simplified from the full detail with
+	//! `simplifyMesh()`, then reordered with
+	//! `bonobo::optimizeVertexCache()`, and its indices are appended to
+	//! `indices`. Building stops once a level would be too small, or
+	//! would not remove enough triangles to be worth it.
+	//!
+	//! @param [in,out] indices of the full-detail triangles, followed by
+	//!                 the indices of every level built
+	//! @param [in] positions of the vertices
+	//! @param [in] vertices_nb number of vertices
+	//! @param [in] max_lods_nb largest number of levels to build
+	//! @return the levels built, from finest to coarsest
+	std::vector<mesh_lod> buildLodChain(std::vector<uint32_t>& indices, glm::vec3 const* positions,
+	                                    size_t vertices_nb, size_t max_lods_nb = 4u);
+}
@@ -1,12 +1,28 @@
 #include "node.hpp"
+#include "gl_state.hpp"
 #include "helpers.hpp"
+#include "uniform_cache.hpp"
+#include "vertex_format.hpp"
 
 #include "core/Log.h"
+#include "core/Profiler.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-Node::Node() : _vao(0u), _vertices_nb(0u), _indices_nb(0u), _drawing_mode(GL_TRIANGLES), _has_indices(true), _program(0u), _textures(), _scaling(1.0f, 1.0f, 1.0f), _rotation(), _translation(), _children()
+namespace local
+{
+	static auto const vertex_model_to_world_id = bonobo::getUniformID("vertex_model_to_world");
+	static auto const normal_model_to_world_id = bonobo::getUniformID("normal_model_to_world");
+	static auto const vertex_world_to_clip_id  = bonobo::getUniformID("vertex_world_to_clip");
+	static auto const has_textures_id          = bonobo::getUniformID("has_textures");
+	static auto const has_diffuse_texture_id   = bonobo::getUniformID("has_diffuse_texture");
+	static auto const has_opacity_texture_id   = bonobo::getUniformID("has_opacity_texture");
+	static auto const diffuse_texture_id       = bonobo::getUniformID("diffuse_texture");
+	static auto const opacity_texture_id       = bonobo::getUniformID("opacity_texture");
+}
+
+Node::Node() : _vao(0u), _vertices_nb(0u), _indices_nb(0u), _first_index(0u), _base_vertex(0), _drawing_mode(GL_TRIANGLES), _index_type(GL_UNSIGNED_INT), _has_indices(true), _bounds(), _bounding_sphere(), _lods(), _lod(0u), _program(0u), _textures(), _scaling(1.0f, 1.0f, 1.0f), _rotation(), _translation(), _children()
 {
 }
 
@@ -22,39 +38,64 @@ Node::render(glm::mat4 const& WVP, glm::mat4 const& world, GLuint program, std::
 	if (_vao == 0u || program == 0u)
 		return;
 
-	glUseProgram(program);
+	PROFILE_SCOPE("Node::render");
+
+	bind(WVP, world, program, set_uniforms);
+
+	if (!_has_indices) {
+		glDrawArrays(_drawing_mode, _base_vertex, _vertices_nb);
+		return;
+	}
+
+	bonobo::gl_state::primitiveRestart(_drawing_mode, _index_type);
+	auto const indices_nb = static_cast<GLsizei>(get_indices_nb());
+	auto const first_index = reinterpret_cast<GLvoid const*>(get_first_index() * bonobo::indexSize(_index_type));
+	auto const base_vertex = get_base_vertex();
+	if (base_vertex != 0)
+		glDrawElementsBaseVertex(_drawing_mode, indices_nb, _index_type, first_index, base_vertex);
+	else
+		glDrawElements(_drawing_mode, indices_nb, _index_type, first_index);
+}
+
+void
+Node::bind(glm::mat4 const& WVP, glm::mat4 const& world) const
+{
+	bind(WVP, world, _program, _set_uniforms);
+}
+
+void
+Node::bind(glm::mat4 const& WVP, glm::mat4 const& world, GLuint program, std::function<void (GLuint)> const& set_uniforms) const
+{
+	if (_vao == 0u || program == 0u)
+		return;
+
+	bonobo::gl_state::useProgram(program);
 
 	auto const normal_model_to_world = glm::transpose(glm::inverse(world));
 
 	set_uniforms(program);
 
-	glUniformMatrix4fv(glGetUniformLocation(program, "vertex_model_to_world"), 1, GL_FALSE, glm::value_ptr(world));
-	glUniformMatrix4fv(glGetUniformLocation(program, "normal_model_to_world"), 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
-	glUniformMatrix4fv(glGetUniformLocation(program, "vertex_world_to_clip"), 1, GL_FALSE, glm::value_ptr(WVP));
+	glUniformMatrix4fv(bonobo::getUniformLocation(program, local::vertex_model_to_world_id), 1, GL_FALSE, glm::value_ptr(world));
+	glUniformMatrix4fv(bonobo::getUniformLocation(program, local::normal_model_to_world_id), 1, GL_FALSE, glm::value_ptr(normal_model_to_world));
+	glUniformMatrix4fv(bonobo::getUniformLocation(program, local::vertex_world_to_clip_id), 1, GL_FALSE, glm::value_ptr(WVP));
 
-	glUniform1i(glGetUniformLocation(program, "has_textures"), !_textures.empty());
+	glUniform1i(bonobo::getUniformLocation(program, local::has_textures_id), !_textures.empty());
 	bool has_diffuse_texture = false, has_opacity_texture = false;
 	for (size_t i = 0u; i < _textures.size(); ++i) {
-		auto const texture = _textures[i];
-		glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
-		glBindTexture(std::get<2>(texture), std::get<1>(texture));
-		glUniform1i(glGetUniformLocation(program, std::get<0>(texture).c_str()), static_cast<GLint>(i));
-		if (std::get<0>(texture) == "diffuse_texture")
+		auto const& texture = _textures[i];
+		bonobo::gl_state::bindTexture(static_cast<GLuint>(i), std::get<2>(texture), std::get<1>(texture));
+		glUniform1i(bonobo::getUniformLocation(program, std::get<0>(texture)), static_cast<GLint>(i));
+		if (std::get<0>(texture) == local::diffuse_texture_id)
 			has_diffuse_texture = true;
-		else if (std::get<0>(texture) == "opacity_texture")
+		else if (std::get<0>(texture) == local::opacity_texture_id)
 			has_opacity_texture = true;
 	}
-	glUniform1i(glGetUniformLocation(program, "has_diffuse_texture"), has_diffuse_texture);
-	glUniform1i(glGetUniformLocation(program, "has_opacity_texture"), has_opacity_texture);
-
-	glBindVertexArray(_vao);
-	if (_has_indices)
-		glDrawElements(_drawing_mode, _indices_nb, GL_UNSIGNED_INT, reinterpret_cast<GLvoid const*>(0x0));
-	else
-		glDrawArrays(_drawing_mode, 0, _vertices_nb);
-	glBindVertexArray(0u);
+	glUniform1i(bonobo::getUniformLocation(program, local::has_diffuse_texture_id), has_diffuse_texture);
+	glUniform1i(bonobo::getUniformLocation(program, local::has_opacity_texture_id), has_opacity_texture);
 
-	glUseProgram(0u);
+	// The program and VAO are left bound: the next node very likely uses
+	// the same program, and binding them again would then be skipped.
+	bonobo::gl_state::bindVertexArray(_vao);
 }
 
 void
@@ -63,8 +104,15 @@ Node::set_geometry(bonobo::mesh_data const& shape)
 	_vao = shape.vao;
 	_vertices_nb = static_cast<GLsizei>(shape.vertices_nb);
 	_indices_nb = static_cast<GLsizei>(shape.indices_nb);
+	_first_index = shape.first_index;
+	_base_vertex = shape.base_vertex;
 	_drawing_mode = shape.drawing_mode;
+	_index_type = shape.index_type;
 	_has_indices = shape.ibo != 0u;
+	_bounds = shape.bounds;
+	_bounding_sphere = shape.sphere;
+	_lods = shape.lods;
+	_lod = 0u;
 
 	if (!shape.bindings.empty()) {
 		for (auto const& binding : shape.bindings)
@@ -79,23 +127,35 @@ Node::set_program(GLuint program, std::function<void (GLuint)> const& set_unifor
 	_set_uniforms = set_uniforms;
 }
 
+void
+Node::set_indices_nb(size_t const& indices_nb)
+{
+	_indices_nb = static_cast<GLsizei>(indices_nb);
+}
+
 size_t
-Node::get_indices_nb() const
+Node::select_lod(bonobo::lod_view const& view, glm::mat4 const& world)
 {
-	return static_cast<size_t>(_indices_nb);
+	if (_lods.empty())
+		return 0u;
+
+	auto const sphere = bonobo::transformBounds(_bounding_sphere, world);
+	auto const scale = _bounding_sphere.radius > 0.0f ? sphere.radius / _bounding_sphere.radius : 1.0f;
+	_lod = bonobo::selectLod(view, sphere, scale, _lods, _lod);
+	return _lod;
 }
 
-void
-Node::set_indices_nb(size_t const& indices_nb)
+size_t
+Node::get_lod_indices_nb(size_t lod) const
 {
-	_indices_nb = static_cast<GLsizei>(indices_nb);
+	return lod == 0u ? static_cast<size_t>(_indices_nb) : _lods[lod - 1u].indices_nb;
 }
 
 void
 Node::add_texture(std::string const& name, GLuint tex_id, GLenum type)
 {
 	if (tex_id != 0u)
-		_textures.emplace_back(name, tex_id, type);
+		_textures.emplace_back(bonobo::getUniformID(name), tex_id, type);
 }
 
 void
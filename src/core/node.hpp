@@ -1,10 +1,14 @@
 #pragma once
 
 #include "external/glad/glad.h"
+#include "core/bounds.hpp"
+#include "core/lod.hpp"
+#include "core/uniform_cache.hpp"
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 
 #include <functional>
+#include <string>
 #include <tuple>
 #include <vector>
 
@@ -42,6 +46,31 @@ public:
 	            GLuint program,
 	            std::function<void (GLuint)> const& set_uniforms) const;
 
+	//! \brief Set up the program, uniforms, textures and VAO as
+	//!        `render()` would, without drawing anything.
+	//!
+	//! This lets several nodes sharing that state be drawn by a single
+	//! call, as done by `bonobo::render_queue`.
+	//!
+	//! @param [in] WVP Matrix transforming from world-space to clip-space
+	//! @param [in] world Matrix transforming from model-space to
+	//!             world-space
+	void bind(glm::mat4 const& WVP, glm::mat4 const& world) const;
+
+	//! \brief Set up the state as `render()` would with a specific
+	//!        shader program, without drawing anything.
+	//!
+	//! @param [in] WVP Matrix transforming from world-space to clip-space
+	//! @param [in] world Matrix transforming from model-space to
+	//!             world-space
+	//! @param [in] program OpenGL shader program to use
+	//! @param [in] set_uniforms function that will take as argument an
+	//!             OpenGL shader program, and will setup that program's
+	//!             uniforms
+	void bind(glm::mat4 const& WVP, glm::mat4 const& world,
+	          GLuint program,
+	          std::function<void (GLuint)> const& set_uniforms) const;
+
 	//! \brief Set the geometry of this node.
 	//!
 	//! A node without any geometry will not render itself, but its
@@ -50,16 +79,67 @@ public:
 	//! @param [in] shape OpenGL data to use as geometry
 	void set_geometry(bonobo::mesh_data const& shape);
 
+	//! \brief Get the Vertex Array Object used as geometry.
+	//!
+	//! @return the name of the OpenGL VAO, or 0 if there is no geometry
+	GLuint get_vao() const { return _vao; }
+
+	//! \brief Get the model-space bounding box of the geometry.
+	bonobo::aabb const& get_bounds() const { return _bounds; }
+
+	//! \brief Get the model-space bounding sphere of the geometry.
+	//!
+	//! @return the sphere, with a negative radius if the bounds are unknown
+	bonobo::bounding_sphere const& get_bounding_sphere() const { return _bounding_sphere; }
+
+	//! \brief Get the OpenGL drawing mode, i.e. GL_TRIANGLES, GL_LINES, etc.
+	GLenum get_drawing_mode() const { return _drawing_mode; }
+
+	//! \brief Get the type of the indices, see `bonobo::mesh_data::index_type`.
+	GLenum get_index_type() const { return _index_type; }
+
+	//! \brief Whether the geometry is drawn through an index buffer.
+	bool has_indices() const { return _has_indices; }
+
+	//! \brief Get the position of the first index to use in the index
+	//!        buffer, which is shared when the mesh lives in a
+	//!        `bonobo::geometry_arena`, at the selected level of detail.
+	size_t get_first_index() const { return _lod == 0u ? _first_index : _first_index + _lods[_lod - 1u].first_index; }
+
+	//! \brief Get the value added to every index before fetching
+	//!        vertices, at the selected level of detail.
+	GLint get_base_vertex() const { return _lod == 0u ? _base_vertex : _base_vertex + _lods[_lod - 1u].base_vertex; }
+
 	//! \brief Get the number of indices to use.
 	//!
-	//! @return how many indices to use when rendering
-	size_t get_indices_nb() const;
+	//! @return how many indices to use when rendering, at the selected
+	//!         level of detail
+	size_t get_indices_nb() const { return get_lod_indices_nb(_lod); }
 
-	//! \brief Set the number of indices to use.
+	//! \brief Set the number of indices to use at full detail.
 	//!
 	//! @param [in] indices_nb how many indices to use when rendering
 	void set_indices_nb(size_t const& indices_nb);
 
+	//! \brief Pick the level of detail to render from now on, see
+	//!        `bonobo::selectLod()`.
+	//!
+	//! @param [in] view camera the node will be seen through
+	//! @param [in] world Matrix transforming from model-space to
+	//!             world-space
+	//! @return the level picked, 0 being the full detail
+	size_t select_lod(bonobo::lod_view const& view, glm::mat4 const& world);
+
+	//! \brief Get the level of detail used, 0 being the full detail.
+	size_t get_lod() const { return _lod; }
+
+	//! \brief Get the number of levels of detail, including the full
+	//!        detail.
+	size_t get_lods_nb() const { return _lods.size() + 1u; }
+
+	//! \brief Get the number of indices drawn at a given level of detail.
+	size_t get_lod_indices_nb(size_t lod) const;
+
 	//! \brief Set the program of this node.
 	//!
 	//! A node without a program will not render itself, but its children
@@ -71,6 +151,16 @@ public:
 	//!             uniforms
 	void set_program(GLuint program, std::function<void (GLuint)> const& set_uniforms);
 
+	//! \brief Get the program of this node.
+	//!
+	//! @return the name of the OpenGL shader program, or 0 if none was set
+	GLuint get_program() const { return _program; }
+
+	//! \brief Get the textures of this node.
+	//!
+	//! @return the textures as (interned sampler name, texture name, target)
+	std::vector<std::tuple<bonobo::uniform_id, GLuint, GLenum>> const& get_textures() const { return _textures; }
+
 	//! \brief Add a texture to this node.
 	//!
 	//! @param [in] name the variable name used by the attached OpenGL
@@ -172,15 +262,22 @@ private:
 	GLuint _vao;
 	GLsizei _vertices_nb;
 	GLsizei _indices_nb;
+	size_t _first_index;
+	GLint _base_vertex;
 	GLenum _drawing_mode;
+	GLenum _index_type;
 	bool _has_indices;
+	bonobo::aabb _bounds;
+	bonobo::bounding_sphere _bounding_sphere;
+	std::vector<bonobo::mesh_lod> _lods;
+	size_t _lod;
 
 	// Program data
 	GLuint _program;
 	std::function<void (GLuint)> _set_uniforms;
 
-	// Textures data
-	std::vector<std::tuple<std::string, GLuint, GLenum>> _textures;
+	// Textures data, as (interned sampler name, texture name, target)
+	std::vector<std::tuple<bonobo::uniform_id, GLuint, GLenum>> _textures;
 
 	// Transformation data
 	glm::vec3 _scaling;
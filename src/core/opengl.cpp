@@ -1,5 +1,7 @@
 #include "Log.h"
 #include "opengl.hpp"
+#include "uniform_buffer.hpp"
+#include "uniform_cache.hpp"
 #include "various.hpp"
 
 #include <cassert>
@@ -202,7 +204,11 @@ reload_program(GLuint id, std::vector<GLuint> const& ids, std::vector<std::strin
 	for (unsigned int i = 0u; i < ids.size(); ++i)
 		source_and_build_shader(ids[i], sources[i]);
 
-	link_program(id);
+	bonobo::forgetProgramUniforms(id);
+	if (link_program(id)) {
+		bonobo::reflectProgramUniforms(id);
+		bonobo::bindProgramUniformBlocks(id);
+	}
 }
 
 GLuint
@@ -213,10 +219,18 @@ generate_program(std::vector<GLuint> const& shaders_id)
 	for (auto shader_id : shaders_id)
 		glAttachShader(id, shader_id);
 
+	// Lets bonobo::program_cache save the result of the link.
+	glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 	auto const success = link_program(id);
 	if (success) {
+		// Program names get recycled by the driver once deleted, so this
+		// also discards whatever was cached for a previous program.
+		bonobo::reflectProgramUniforms(id);
+		bonobo::bindProgramUniformBlocks(id);
 		return id;
 	} else {
+		bonobo::forgetProgramUniforms(id);
 		glDeleteProgram(id);
 		return 0u;
 	}
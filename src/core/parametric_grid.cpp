@@ -0,0 +1,84 @@
+#include "parametric_grid.hpp"
+
+#include "core/gl_state.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+std::vector<glm::vec2>
+bonobo::computeAngleTable(unsigned int res, float begin, float end)
+{
+	auto table = std::vector<glm::vec2>(res);
+	if (res == 0u)
+		return table;
+
+	auto const step = res > 1u ? (static_cast<double>(end) - begin) / static_cast<double>(res - 1u) : 0.0;
+	auto const cos_step = std::cos(step), sin_step = std::sin(step);
+	auto c = std::cos(static_cast<double>(begin)), s = std::sin(static_cast<double>(begin));
+	for (unsigned int i = 0u; i < res; ++i) {
+		table[i] = glm::vec2(static_cast<float>(c), static_cast<float>(s));
+		auto const next_c = c * cos_step - s * sin_step;
+		s = s * cos_step + c * sin_step;
+		c = next_c;
+	}
+	return table;
+}
+
+bonobo::mesh_data
+bonobo::uploadGridSurface(grid_geometry const& geometry, vertex_format format)
+{
+	bonobo::mesh_data data;
+	glGenVertexArrays(1, &data.vao);
+	assert(data.vao != 0u);
+	glBindVertexArray(data.vao);
+
+	bonobo::vertex_attributes attributes;
+	attributes.vertices_nb = geometry.vertices.size();
+	attributes.vertices  = geometry.vertices.data();
+	attributes.normals   = geometry.normals.data();
+	attributes.texcoords = geometry.texcoords.data();
+	attributes.tangents  = geometry.tangents.data();
+	attributes.binormals = geometry.binormals.data();
+	bonobo::uploadVertices(data, format, attributes);
+
+	bonobo::uploadIndices(data, geometry.indices.data(), geometry.indices.size());
+	data.drawing_mode = geometry.drawing_mode;
+
+	glBindVertexArray(0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0u);
+	bonobo::gl_state::invalidate();
+
+	return data;
+}
+
+bonobo::mesh_data
+bonobo::uploadGridSurface(std::vector<grid_geometry> const& levels, vertex_format format)
+{
+	assert(!levels.empty());
+	if (levels.size() == 1u)
+		return uploadGridSurface(levels.front(), format);
+
+	// Restart indices are compared before the base vertex gets added, so
+	// strips can be concatenated as they are.
+	grid_geometry all;
+	all.drawing_mode = levels.front().drawing_mode;
+	all.error = levels.front().error;
+	auto lods = std::vector<mesh_lod>();
+	for (auto const& level : levels) {
+		assert(level.drawing_mode == all.drawing_mode);
+		if (&level != &levels.front())
+			lods.push_back(mesh_lod{ all.indices.size(), level.indices.size(), static_cast<GLint>(all.vertices.size()), level.error });
+		all.vertices.insert(all.vertices.end(), level.vertices.begin(), level.vertices.end());
+		all.normals.insert(all.normals.end(), level.normals.begin(), level.normals.end());
+		all.texcoords.insert(all.texcoords.end(), level.texcoords.begin(), level.texcoords.end());
+		all.tangents.insert(all.tangents.end(), level.tangents.begin(), level.tangents.end());
+		all.binormals.insert(all.binormals.end(), level.binormals.begin(), level.binormals.end());
+		all.indices.insert(all.indices.end(), level.indices.begin(), level.indices.end());
+	}
+
+	auto data = uploadGridSurface(all, format);
+	data.indices_nb = levels.front().indices.size();
+	data.lods = std::move(lods);
+	return data;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "helpers.hpp"
+#include "vertex_format.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Position and tangent frame of a surface at one grid point.
+	struct surface_point {
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec3 tangent;  //!< along increasing u
+		glm::vec3 binormal; //!< along increasing v
+	};
+
+	//! \brief Vertices and triangles of a grid surface, before upload.
+	struct grid_geometry {
+		std::vector<glm::vec3> vertices;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec3> texcoords;
+		std::vector<glm::vec3> tangents;
+		std::vector<glm::vec3> binormals;
+		std::vector<GLuint> indices;
+		GLenum drawing_mode; //!< GL_TRIANGLES or GL_TRIANGLE_STRIP
+		float error;         //!< largest distance to the exact surface, 0 unless set by the caller
+	};
+
+	//! \brief Cosines and sines of evenly spaced angles.
+	//!
+	//! Only the step is evaluated with `std::cos()` and `std::sin()`;
+	//! angles are then obtained by rotating the previous one, in double
+	//! precision so that the error stays well below a float's even after
+	//! thousands of steps.
+	//!
+	//! @param [in] res number of angles
+	//! @param [in] begin first angle, in radians
+	//! @param [in] end last angle, in radians
+	//! @return `res` pairs of (cos, sin), from `begin` to `end` included
+	std::vector<glm::vec2> computeAngleTable(unsigned int res, float begin, float end);
+
+	//! \brief Sample a surface over a grid of `res_u` by `res_v` points.
+	//!
+	//! Vertex `v * res_u + u` is `surface(u, v)`, textured with
+	//! (u / (res_u - 1), v / (res_v - 1)), and each grid cell is split
+	//! into two triangles. As a strip, each row of cells is one strip of
+	//! 2 * res_u indices, separated from the next by
+	//! `bonobo::primitive_restart_index`; that is about a third of the
+	//! indices of the list, for the same triangles. Rows are spread over
+	//! `utils::thread_pool::instance()`, so `surface` must be safe to
+	//! call from several threads at once, and must not use OpenGL.
+	//!
+	//! @param [in] res_u number of points along u, at least 2
+	//! @param [in] res_v number of points along v, at least 2
+	//! @param [in] surface callable as `surface_point(unsigned int u, unsigned int v)`
+	//! @param [in] drawing_mode GL_TRIANGLES or GL_TRIANGLE_STRIP
+	//! @return the sampled geometry
+	template<typename Surface>
+	grid_geometry sampleGridSurface(unsigned int res_u, unsigned int res_v, Surface const& surface,
+	                                GLenum drawing_mode = GL_TRIANGLES);
+
+	//! \brief Upload sampled geometry into a new mesh; requires a
+	//!        current OpenGL context.
+	//!
+	//! Indices are stored on 16 bits when the vertices allow it, see
+	//! `bonobo::uploadIndices()`.
+	//!
+	//! @param [in] geometry vertices and triangles to upload
+	//! @param [in] format layout to store the vertex attributes in
+	//! @return wrapper around OpenGL objects' name containing the geometry
+	//!         data
+	mesh_data uploadGridSurface(grid_geometry const& geometry, vertex_format format);
+
+	//! \brief Upload several samplings of the same surface into a new
+	//!        mesh, the first one as its full detail and the others as
+	//!        its coarser levels of detail, see `bonobo::mesh_lod`.
+	//!
+	//! Levels are stored one after the other in the same buffers; each
+	//! keeps its own indices and is offset by its base vertex.
+	//!
+	//! @param [in] levels samplings, from finest to coarsest, all drawn
+	//!             with the same mode; their `error` is used as the error
+	//!             of the matching level of detail
+	//! @param [in] format layout to store the vertex attributes in
+	//! @return wrapper around OpenGL objects' name containing the geometry
+	//!         data
+	mesh_data uploadGridSurface(std::vector<grid_geometry> const& levels, vertex_format format);
+
+	//! \brief Sample a surface and upload it, see `sampleGridSurface()`.
+	template<typename Surface>
+	mesh_data createGridSurface(unsigned int res_u, unsigned int res_v, Surface const& surface,
+	                            vertex_format format = vertex_format::interleaved_packed,
+	                            GLenum drawing_mode = GL_TRIANGLES);
+}
+
+#include "parametric_grid.inl"
@@ -0,0 +1,135 @@
+#include "core/thread_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define BONOBO_GRID_USE_SSE 1
+#	include <emmintrin.h>
+#else
+#	define BONOBO_GRID_USE_SSE 0
+#endif
+
+namespace bonobo
+{
+	namespace grid_detail
+	{
+		// Below this, handing rows over to other threads costs more than
+		// sampling them.
+		constexpr size_t min_vertices_per_task = 4096u;
+	}
+}
+
+/*----------------------------------------------------------------------------*/
+
+template<typename Surface>
+bonobo::grid_geometry
+bonobo::sampleGridSurface(unsigned int res_u, unsigned int res_v, Surface const& surface, GLenum drawing_mode)
+{
+	assert(res_u >= 2u && res_v >= 2u);
+	assert(drawing_mode == GL_TRIANGLES || drawing_mode == GL_TRIANGLE_STRIP);
+
+	auto const vertices_nb = static_cast<size_t>(res_u) * res_v;
+	auto const strip = drawing_mode == GL_TRIANGLE_STRIP;
+	// A strip row is 2 * res_u indices plus the restart index, the last
+	// row omitting it.
+	auto const indices_per_row_nb = strip ? 2u * static_cast<size_t>(res_u) + 1u
+	                                      : 6u * static_cast<size_t>(res_u - 1u);
+
+	grid_geometry geometry;
+	geometry.vertices.resize(vertices_nb);
+	geometry.normals.resize(vertices_nb);
+	geometry.texcoords.resize(vertices_nb);
+	geometry.tangents.resize(vertices_nb);
+	geometry.binormals.resize(vertices_nb);
+	geometry.indices.resize(indices_per_row_nb * (res_v - 1u) - (strip ? 1u : 0u));
+	geometry.drawing_mode = drawing_mode;
+	geometry.error = 0.0f;
+
+	auto const rows_per_task = std::max<size_t>(grid_detail::min_vertices_per_task / res_u, 1u);
+	auto const tasks_nb = (static_cast<size_t>(res_v) + rows_per_task - 1u) / rows_per_task;
+	auto const du = 1.0f / static_cast<float>(res_u - 1u);
+	auto const dv = 1.0f / static_cast<float>(res_v - 1u);
+
+	utils::thread_pool::instance().parallel_for(tasks_nb, [&](size_t task){
+		auto const first_row = static_cast<unsigned int>(task * rows_per_task);
+		auto const last_row = static_cast<unsigned int>(std::min<size_t>(first_row + rows_per_task, res_v));
+		for (unsigned int v = first_row; v < last_row; ++v) {
+			auto const row = static_cast<size_t>(v) * res_u;
+			auto const t = static_cast<float>(v) * dv;
+			for (unsigned int u = 0u; u < res_u; ++u) {
+				auto const p = surface(u, v);
+				geometry.vertices[row + u] = p.position;
+				geometry.normals[row + u] = p.normal;
+				geometry.texcoords[row + u] = glm::vec3(static_cast<float>(u) * du, t, 0.0f);
+				geometry.tangents[row + u] = p.tangent;
+				geometry.binormals[row + u] = p.binormal;
+			}
+
+			if (v + 1u == res_v)
+				continue;
+			auto index = geometry.indices.begin() + static_cast<std::ptrdiff_t>(indices_per_row_nb * v);
+			auto const first = static_cast<GLuint>(row);
+			if (strip) {
+				// Same winding as the list below.
+				unsigned int u = 0u;
+#if BONOBO_GRID_USE_SSE
+				// Four columns at a time, the upper and lower rows
+				// interleaved.
+				auto const lanes = _mm_setr_epi32(0, 1, 2, 3);
+				auto const row_offset = _mm_set1_epi32(static_cast<int>(res_u));
+				for (; u + 4u <= res_u; u += 4u) {
+					auto const lower = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(first + u)), lanes);
+					auto const upper = _mm_add_epi32(lower, row_offset);
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(&*index), _mm_unpacklo_epi32(upper, lower));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(&*index + 4), _mm_unpackhi_epi32(upper, lower));
+					index += 8;
+				}
+#endif
+				for (; u < res_u; ++u) {
+					*index++ = first + res_u + u;
+					*index++ = first + u;
+				}
+				if (v + 2u < res_v)
+					*index = bonobo::primitive_restart_index;
+				continue;
+			}
+			unsigned int u = 0u;
+#if BONOBO_GRID_USE_SSE
+			// Two cells, i.e. twelve indices, at a time.
+			auto const r = static_cast<int>(res_u);
+			auto const offsets0 = _mm_setr_epi32(0, 1, 1 + r, 0);
+			auto const offsets1 = _mm_setr_epi32(1 + r, r, 1, 2);
+			auto const offsets2 = _mm_setr_epi32(2 + r, 1, 2 + r, 1 + r);
+			for (; u + 2u < res_u; u += 2u) {
+				auto const i = _mm_set1_epi32(static_cast<int>(first + u));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&*index), _mm_add_epi32(i, offsets0));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&*index + 4), _mm_add_epi32(i, offsets1));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&*index + 8), _mm_add_epi32(i, offsets2));
+				index += 12;
+			}
+#endif
+			for (; u + 1u < res_u; ++u) {
+				auto const i = first + u;
+				*index++ = i;
+				*index++ = i + 1u;
+				*index++ = i + 1u + res_u;
+				*index++ = i;
+				*index++ = i + 1u + res_u;
+				*index++ = i + res_u;
+			}
+		}
+	});
+
+	return geometry;
+}
+
+/*----------------------------------------------------------------------------*/
+
+template<typename Surface>
+bonobo::mesh_data
+bonobo::createGridSurface(unsigned int res_u, unsigned int res_v, Surface const& surface, vertex_format format,
+                          GLenum drawing_mode)
+{
+	return uploadGridSurface(sampleGridSurface(res_u, res_v, surface, drawing_mode), format);
+}
@@ -0,0 +1,155 @@
+#include "config.hpp"
+#include "program_cache.hpp"
+
+#include "core/Log.h"
+#include "core/uniform_buffer.hpp"
+#include "core/uniform_cache.hpp"
+#include "core/various.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace local
+{
+	static char const magic[8] = { 'B', 'N', 'B', 'P', 'R', 'O', 'G', '\0' };
+
+	struct file_header {
+		char magic[8];
+		uint32_t version;
+		uint32_t binary_format;
+		uint64_t sources_hash;
+		uint64_t binary_size;
+	};
+
+	static uint64_t hash_string(char const* string, uint64_t seed)
+	{
+		if (string == nullptr)
+			return seed;
+		return utils::hash_fnv1a(string, std::strlen(string), seed);
+	}
+}
+
+bool
+bonobo::program_cache::isSupported()
+{
+	GLint formats_nb = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats_nb);
+	return formats_nb > 0;
+}
+
+uint64_t
+bonobo::program_cache::hashSources(std::vector<std::string> const& sources)
+{
+	// Binaries are only guaranteed to be accepted by the exact driver
+	// which produced them.
+	auto hash = utils::hash_fnv1a(nullptr, 0u);
+	hash = local::hash_string(reinterpret_cast<char const*>(glGetString(GL_VENDOR)), hash);
+	hash = local::hash_string(reinterpret_cast<char const*>(glGetString(GL_RENDERER)), hash);
+	hash = local::hash_string(reinterpret_cast<char const*>(glGetString(GL_VERSION)), hash);
+
+	// Hashing the sizes too keeps "ab" + "c" and "a" + "bc" apart.
+	for (auto const& source : sources) {
+		auto const size = static_cast<uint64_t>(source.size());
+		hash = utils::hash_fnv1a(&size, sizeof(size), hash);
+		hash = utils::hash_fnv1a(source.data(), source.size(), hash);
+	}
+
+	return hash;
+}
+
+std::string
+bonobo::program_cache::cachePath(uint64_t sources_hash)
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016" PRIx64 ".glprogram", sources_hash);
+	return config::cache_path(name);
+}
+
+GLuint
+bonobo::program_cache::load(uint64_t sources_hash)
+{
+	auto const cache_path = cachePath(sources_hash);
+	auto const file = utils::mapped_file(cache_path);
+	if (!file.is_open() || file.size() < sizeof(local::file_header))
+		return 0u;
+
+	local::file_header header;
+	std::memcpy(&header, file.data(), sizeof(header));
+	if (std::memcmp(header.magic, local::magic, sizeof(local::magic)) != 0
+	 || header.version != version
+	 || header.sources_hash != sources_hash
+	 || header.binary_size > file.size() - sizeof(header)) {
+		LogWarning("Program cache \"%s\" is corrupted", cache_path.c_str());
+		return 0u;
+	}
+
+	auto const program = glCreateProgram();
+	glProgramBinary(program, static_cast<GLenum>(header.binary_format),
+	                file.data() + sizeof(header), static_cast<GLsizei>(header.binary_size));
+	GLint state = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &state);
+	if (state == GL_FALSE) {
+		// Drivers may reject their own binaries, for example after an
+		// update which did not change the version string.
+		LogInfo("Program cache \"%s\" was rejected by the driver", cache_path.c_str());
+		glDeleteProgram(program);
+		return 0u;
+	}
+
+	bonobo::reflectProgramUniforms(program);
+	bonobo::bindProgramUniformBlocks(program);
+	return program;
+}
+
+bool
+bonobo::program_cache::store(uint64_t sources_hash, GLuint program)
+{
+	GLint binary_size = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_size);
+	if (binary_size <= 0)
+		return false;
+
+	auto binary = std::vector<uint8_t>(static_cast<size_t>(binary_size));
+	GLenum binary_format = 0u;
+	GLsizei written = 0;
+	glGetProgramBinary(program, binary_size, &written, &binary_format, binary.data());
+	if (written <= 0)
+		return false;
+
+	local::file_header header;
+	std::memcpy(header.magic, local::magic, sizeof(local::magic));
+	header.version = version;
+	header.binary_format = static_cast<uint32_t>(binary_format);
+	header.sources_hash = sources_hash;
+	header.binary_size = static_cast<uint64_t>(written);
+
+	auto const cache_path = cachePath(sources_hash);
+	auto const temporary_path = cache_path + ".tmp";
+	{
+		auto file = std::ofstream(temporary_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			LogWarning("Could not create program cache \"%s\"", temporary_path.c_str());
+			return false;
+		}
+
+		file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+		file.write(reinterpret_cast<char const*>(binary.data()), written);
+
+		if (!file.good()) {
+			LogWarning("Failed to write program cache \"%s\"", temporary_path.c_str());
+			file.close();
+			std::remove(temporary_path.c_str());
+			return false;
+		}
+	}
+
+	std::remove(cache_path.c_str()); // std::rename() does not overwrite on Windows
+	if (std::rename(temporary_path.c_str(), cache_path.c_str()) != 0) {
+		LogWarning("Failed to move program cache into \"%s\"", cache_path.c_str());
+		std::remove(temporary_path.c_str());
+		return false;
+	}
+	return true;
+}
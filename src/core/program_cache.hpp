@@ -0,0 +1,61 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief On-disk cache of linked shader programs.
+	//!
+	//! Programs are stored as returned by `glGetProgramBinary()`, in the
+	//! `cache` folder of the build directory, under a name derived from
+	//! a hash of their sources and of the driver; a program is thus only
+	//! compiled again when one of its sources changed, or when the driver
+	//! got updated. Binaries a driver refuses are silently discarded, and
+	//! the program compiled from source instead.
+	namespace program_cache
+	{
+		//! \brief Bumped whenever the layout of the file changes; older
+		//!        caches are then rebuilt.
+		constexpr uint32_t version = 1u;
+
+		//! \brief Whether the driver supports at least one binary format.
+		bool isSupported();
+
+		//! \brief Hash the sources of all stages of a program, along with
+		//!        the vendor, renderer and version of the driver.
+		//!
+		//! @param [in] sources source code of each stage, in order; any
+		//!             define has to be part of the source itself
+		//! @return hash identifying the program binary
+		uint64_t hashSources(std::vector<std::string> const& sources);
+
+		//! \brief Path of the cache file for a given hash.
+		std::string cachePath(uint64_t sources_hash);
+
+		//! \brief Create a program from its cached binary.
+		//!
+		//! On success the program is reflected and has its uniform blocks
+		//! bound, like programs created by
+		//! `utils::opengl::shader::generate_program()`.
+		//!
+		//! @param [in] sources_hash value returned by `hashSources()`
+		//! @return the name of the program, or 0 if there was no usable
+		//!         binary
+		GLuint load(uint64_t sources_hash);
+
+		//! \brief Save the binary of a linked program.
+		//!
+		//! The program must have been linked with
+		//! `GL_PROGRAM_BINARY_RETRIEVABLE_HINT` set, which
+		//! `utils::opengl::shader::generate_program()` does.
+		//!
+		//! @param [in] sources_hash value returned by `hashSources()`
+		//! @param [in] program OpenGL name of a successfully linked program
+		//! @return whether writing succeeded
+		bool store(uint64_t sources_hash, GLuint program);
+	}
+}
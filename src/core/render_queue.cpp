@@ -0,0 +1,203 @@
+#include "render_queue.hpp"
+#include "gl_state.hpp"
+#include "node.hpp"
+#include "various.hpp"
+#include "vertex_format.hpp"
+
+#include "core/Misc.h"
+#include "core/Profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+namespace local
+{
+	constexpr unsigned int depth_shift    = 0u;
+	constexpr unsigned int vao_shift      = 16u;
+	constexpr unsigned int material_shift = 32u;
+	constexpr unsigned int program_shift  = 48u;
+	constexpr unsigned int pass_shift     = 60u;
+
+	constexpr std::uint32_t max_pass     = 0xfu;
+	constexpr std::uint32_t max_program  = 0xfffu;
+	constexpr std::uint32_t max_material = 0xffffu;
+	constexpr std::uint32_t max_vao      = 0xffffu;
+
+	// Positive floats compare like their bit patterns, so keeping the
+	// upper half of those gives a coarse but ordered depth.
+	static std::uint64_t quantise_depth(float depth)
+	{
+		depth = std::max(depth, 0.0f);
+		std::uint32_t bits = 0u;
+		std::memcpy(&bits, &depth, sizeof(bits));
+		return static_cast<std::uint64_t>(bits >> 16u);
+	}
+
+	static std::uint64_t state_of(std::uint64_t key)
+	{
+		return key >> vao_shift;
+	}
+
+	static size_t count_changes(std::uint64_t previous, std::uint64_t current)
+	{
+		auto const program_mask  = static_cast<std::uint64_t>(max_program)  << (program_shift - vao_shift);
+		auto const material_mask = static_cast<std::uint64_t>(max_material) << (material_shift - vao_shift);
+		auto const vao_mask      = static_cast<std::uint64_t>(max_vao);
+		auto const differences = previous ^ current;
+		return ((differences & program_mask) != 0u ? 1u : 0u)
+		     + ((differences & material_mask) != 0u ? 1u : 0u)
+		     + ((differences & vao_mask) != 0u ? 1u : 0u);
+	}
+
+	static size_t count_changes(std::vector<std::uint64_t> const& states)
+	{
+		size_t changes_nb = 0u;
+		for (size_t i = 1u; i < states.size(); ++i)
+			changes_nb += count_changes(states[i - 1u], states[i]);
+		return changes_nb;
+	}
+}
+
+bonobo::render_queue::render_queue() : _draws(), _entries(), _program_ids(), _material_ids(), _vao_ids(), _merge_draws(false), _merged_counts(), _merged_first_indices(), _merged_base_vertices(), _frame_stats(), _last_frame_stats()
+{
+}
+
+void
+bonobo::render_queue::submit(Node const& node, glm::mat4 const& WVP, glm::mat4 const& world, unsigned int pass)
+{
+	push(node, WVP, world, node.get_program(), std::function<void (GLuint)>(), pass);
+}
+
+void
+bonobo::render_queue::submit(Node const& node, glm::mat4 const& WVP, glm::mat4 const& world,
+                             GLuint program, std::function<void (GLuint)> const& set_uniforms,
+                             unsigned int pass)
+{
+	push(node, WVP, world, program, set_uniforms, pass);
+}
+
+void
+bonobo::render_queue::push(Node const& node, glm::mat4 const& WVP, glm::mat4 const& world,
+                           GLuint program, std::function<void (GLuint)> const& set_uniforms,
+                           unsigned int pass)
+{
+	if (node.get_vao() == 0u || program == 0u)
+		return;
+
+	std::uint64_t material_hash = 0u;
+	for (auto const& texture : node.get_textures()) {
+		auto const texture_name = std::get<1>(texture);
+		material_hash = utils::hash_fnv1a(&texture_name, sizeof(texture_name), material_hash);
+	}
+
+	auto const clip_origin = WVP * world[3];
+	auto const key = (static_cast<std::uint64_t>(std::min(pass, local::max_pass)) << local::pass_shift)
+	               | (static_cast<std::uint64_t>(get_id(_program_ids, program, local::max_program)) << local::program_shift)
+	               | (static_cast<std::uint64_t>(get_id(_material_ids, material_hash, local::max_material)) << local::material_shift)
+	               | (static_cast<std::uint64_t>(get_id(_vao_ids, node.get_vao(), local::max_vao)) << local::vao_shift)
+	               | (local::quantise_depth(clip_origin.w) << local::depth_shift);
+
+	_entries.push_back({ key, static_cast<std::uint32_t>(_draws.size()) });
+	_draws.push_back({ &node, WVP, world, program, set_uniforms });
+}
+
+std::uint32_t
+bonobo::render_queue::get_id(std::unordered_map<std::uint64_t, std::uint32_t>& ids, std::uint64_t value, std::uint32_t max_id)
+{
+	auto const it = ids.find(value);
+	if (it != ids.end())
+		return it->second;
+
+	// Once all ids are taken, everything else shares the last one: it
+	// still sorts correctly, just not as tightly.
+	auto const id = std::min(static_cast<std::uint32_t>(ids.size()), max_id);
+	ids.emplace(value, id);
+	return id;
+}
+
+bool
+bonobo::render_queue::can_merge(draw const& first, draw const& other) const
+{
+	// Ids saturate once too many programs, texture sets or VAOs are seen,
+	// so equal keys are not enough: compare the actual state.
+	return first.set_uniforms && other.set_uniforms
+	    && first.program == other.program
+	    && first.node->get_vao() == other.node->get_vao()
+	    && first.node->has_indices() && other.node->has_indices()
+	    && first.node->get_drawing_mode() == other.node->get_drawing_mode()
+	    && first.node->get_index_type() == other.node->get_index_type()
+	    && first.node->get_textures() == other.node->get_textures()
+	    && std::memcmp(&first.WVP, &other.WVP, sizeof(first.WVP)) == 0
+	    && std::memcmp(&first.world, &other.world, sizeof(first.world)) == 0;
+}
+
+void
+bonobo::render_queue::flush()
+{
+	PROFILE_SCOPE("render_queue::flush");
+	if (_entries.empty())
+		return;
+
+	auto const start_time = GetTimeMilliseconds();
+
+	auto states = std::vector<std::uint64_t>(_entries.size());
+	for (size_t i = 0u; i < _entries.size(); ++i)
+		states[i] = local::state_of(_entries[i].key);
+	_frame_stats.unsorted_changes += local::count_changes(states);
+
+	std::sort(_entries.begin(), _entries.end(), [](sort_entry const& a, sort_entry const& b){
+		return a.key < b.key || (a.key == b.key && a.draw_index < b.draw_index);
+	});
+
+	for (size_t i = 0u; i < _entries.size(); ++i)
+		states[i] = local::state_of(_entries[i].key);
+	_frame_stats.state_changes += local::count_changes(states);
+	_frame_stats.draws_nb += _entries.size();
+
+	for (size_t i = 0u; i < _entries.size();) {
+		auto const& draw = _draws[_entries[i].draw_index];
+		auto run_end = i + 1u;
+		if (_merge_draws)
+			while (run_end < _entries.size() && can_merge(draw, _draws[_entries[run_end].draw_index]))
+				++run_end;
+
+		if (run_end - i == 1u) {
+			if (draw.set_uniforms)
+				draw.node->render(draw.WVP, draw.world, draw.program, draw.set_uniforms);
+			else
+				draw.node->render(draw.WVP, draw.world);
+		} else {
+			_merged_counts.clear();
+			_merged_first_indices.clear();
+			_merged_base_vertices.clear();
+			auto const index_type = draw.node->get_index_type();
+			auto const index_size = bonobo::indexSize(index_type);
+			for (auto j = i; j < run_end; ++j) {
+				auto const node = _draws[_entries[j].draw_index].node;
+				_merged_counts.push_back(static_cast<GLsizei>(node->get_indices_nb()));
+				_merged_first_indices.push_back(reinterpret_cast<GLvoid const*>(node->get_first_index() * index_size));
+				_merged_base_vertices.push_back(node->get_base_vertex());
+			}
+			draw.node->bind(draw.WVP, draw.world, draw.program, draw.set_uniforms);
+			bonobo::gl_state::primitiveRestart(draw.node->get_drawing_mode(), index_type);
+			glMultiDrawElementsBaseVertex(draw.node->get_drawing_mode(), _merged_counts.data(), index_type,
+			                              _merged_first_indices.data(), static_cast<GLsizei>(_merged_counts.size()),
+			                              _merged_base_vertices.data());
+		}
+		++_frame_stats.calls_nb;
+		i = run_end;
+	}
+
+	_entries.clear();
+	_draws.clear();
+
+	_frame_stats.submission_ms += GetTimeMilliseconds() - start_time;
+}
+
+void
+bonobo::render_queue::new_frame()
+{
+	_last_frame_stats = _frame_stats;
+	_frame_stats = stats();
+}
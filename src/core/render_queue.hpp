@@ -0,0 +1,138 @@
+#pragma once
+
+#include "external/glad/glad.h"
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class Node;
+
+namespace bonobo
+{
+	//! \brief Collects the draws of a frame and issues them sorted, so
+	//!        that draws sharing a program, a set of textures and a VAO
+	//!        end up next to each other.
+	//!
+	//! Each draw is given a 64-bit key made of, from the most significant
+	//! bits down: the pass (4 bits), the program (12 bits), the set of
+	//! textures (16 bits), the VAO (16 bits) and the depth (16 bits).
+	//! Draws are then rendered in increasing key order through
+	//! `Node::render()`, and hence front-to-back within a state bucket.
+	//!
+	//! When merging is enabled, consecutive draws that end up with the
+	//! same program, textures, VAO and matrices are issued as a single
+	//! `glMultiDrawElementsBaseVertex()`; this pays off for meshes living
+	//! in a `bonobo::geometry_arena`, which all share their VAO.
+	//!
+	//! Nodes are referenced, not copied: they must stay alive until
+	//! `flush()`.
+	class render_queue
+	{
+	public:
+		//! \brief Counters of a frame.
+		struct stats {
+			size_t draws_nb;          //!< number of draws issued
+			size_t state_changes;     //!< program, texture set and VAO changes between consecutive draws, once sorted
+			size_t unsorted_changes;  //!< the same changes had the draws been issued in submission order
+			size_t calls_nb;          //!< draw calls issued to OpenGL, fewer than draws_nb when draws are merged
+			double submission_ms;     //!< CPU time spent sorting and issuing draws in `flush()`
+
+			size_t saved_changes() const { return unsorted_changes - state_changes; }
+		};
+
+		render_queue();
+
+		//! \brief Queue a node for rendering with its own program.
+		//!
+		//! @param [in] node node to render; nodes without geometry or
+		//!             program are ignored
+		//! @param [in] WVP Matrix transforming from world-space to clip-space
+		//! @param [in] world Matrix transforming from model-space to
+		//!             world-space
+		//! @param [in] pass index of the pass, from 0 to 15; lower passes
+		//!             are rendered first
+		void submit(Node const& node, glm::mat4 const& WVP, glm::mat4 const& world,
+		            unsigned int pass = 0u);
+
+		//! \brief Queue a node for rendering with a specific program.
+		//!
+		//! @param [in] node node to render; nodes without geometry are
+		//!             ignored
+		//! @param [in] WVP Matrix transforming from world-space to clip-space
+		//! @param [in] world Matrix transforming from model-space to
+		//!             world-space
+		//! @param [in] program OpenGL shader program to use
+		//! @param [in] set_uniforms function that will take as argument an
+		//!             OpenGL shader program, and will setup that program's
+		//!             uniforms
+		//! @param [in] pass index of the pass, from 0 to 15; lower passes
+		//!             are rendered first
+		void submit(Node const& node, glm::mat4 const& WVP, glm::mat4 const& world,
+		            GLuint program, std::function<void (GLuint)> const& set_uniforms,
+		            unsigned int pass = 0u);
+
+		//! \brief Sort and render all queued draws, then empty the queue.
+		void flush();
+
+		//! \brief Enable or disable the merging of draws, off by default.
+		//!
+		//! Only draws submitted with an explicit program are merged, and
+		//! all draws of a merged run are set up with the uniforms of the
+		//! first one: the `set_uniforms` functions of the other draws are
+		//! not called. Only enable merging when draws sharing a program
+		//! within a pass also share their `set_uniforms`.
+		//!
+		//! @param [in] merge whether to merge draws
+		void set_merge_draws(bool merge) { _merge_draws = merge; }
+
+		//! \brief Start counting for a new frame; the counts of the frame
+		//!        that just ended remain available through
+		//!        `get_last_frame_stats()`.
+		void new_frame();
+
+		//! \brief Counters for the last frame ended by `new_frame()`.
+		stats const& get_last_frame_stats() const { return _last_frame_stats; }
+
+	private:
+		struct draw {
+			Node const* node;
+			glm::mat4 WVP;
+			glm::mat4 world;
+			GLuint program;
+			std::function<void (GLuint)> set_uniforms; //!< empty to use the node's own program
+		};
+
+		struct sort_entry {
+			std::uint64_t key;
+			std::uint32_t draw_index;
+		};
+
+		void push(Node const& node, glm::mat4 const& WVP, glm::mat4 const& world,
+		          GLuint program, std::function<void (GLuint)> const& set_uniforms,
+		          unsigned int pass);
+		std::uint32_t get_id(std::unordered_map<std::uint64_t, std::uint32_t>& ids,
+		                     std::uint64_t value, std::uint32_t max_id);
+		bool can_merge(draw const& first, draw const& other) const;
+
+		std::vector<draw> _draws;
+		std::vector<sort_entry> _entries;
+
+		// Programs, texture sets and VAOs are remapped to small
+		// consecutive integers, so that they fit in their bits of the key.
+		std::unordered_map<std::uint64_t, std::uint32_t> _program_ids;
+		std::unordered_map<std::uint64_t, std::uint32_t> _material_ids;
+		std::unordered_map<std::uint64_t, std::uint32_t> _vao_ids;
+
+		bool _merge_draws;
+		std::vector<GLsizei> _merged_counts;
+		std::vector<GLvoid const*> _merged_first_indices;
+		std::vector<GLint> _merged_base_vertices;
+
+		stats _frame_stats;
+		stats _last_frame_stats;
+	};
+}
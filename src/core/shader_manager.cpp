@@ -0,0 +1,334 @@
+#include "config.hpp"
+#include "shader_manager.hpp"
+
+#include "core/helpers.hpp"
+#include "core/Log.h"
+#include "core/Misc.h"
+#include "core/Profiler.h"
+#include "core/program_cache.hpp"
+#include "core/uniform_buffer.hpp"
+#include "core/uniform_cache.hpp"
+#include "core/various.hpp"
+
+#include <sys/stat.h>
+
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+#if defined(__linux__)
+#	include <poll.h>
+#	include <sys/inotify.h>
+#	include <unistd.h>
+#endif
+
+namespace local
+{
+	// GL_COMPLETION_STATUS_KHR, which the generated loader lacks.
+	constexpr GLenum completion_status = 0x91B1u;
+
+	constexpr int watch_period_ms = 100;
+
+	static bool has_parallel_compile()
+	{
+		GLint extensions_nb = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensions_nb);
+		for (GLint i = 0; i < extensions_nb; ++i) {
+			auto const name = reinterpret_cast<char const*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+			if (name != nullptr && (std::strcmp(name, "GL_KHR_parallel_shader_compile") == 0
+			                     || std::strcmp(name, "GL_ARB_parallel_shader_compile") == 0))
+				return true;
+		}
+		return false;
+	}
+
+	static std::time_t modification_time(std::string const& path)
+	{
+		struct stat status;
+		return stat(path.c_str(), &status) == 0 ? status.st_mtime : 0;
+	}
+
+	static std::string directory_of(std::string const& path)
+	{
+		auto const end = path.find_last_of("/\\");
+		return end == std::string::npos ? std::string(".") : path.substr(0u, end);
+	}
+
+	static GLuint start_shader(GLenum type, std::string const& source)
+	{
+		auto const shader = glCreateShader(type);
+		auto const source_str = source.c_str();
+		glShaderSource(shader, 1, &source_str, nullptr);
+		glCompileShader(shader);
+		return shader;
+	}
+
+	static bool check_shader(GLuint shader, std::string const& path)
+	{
+		GLint state = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &state);
+		if (state == GL_TRUE)
+			return true;
+
+		GLint log_length = 0;
+		glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
+		auto log = std::make_unique<GLchar[]>(static_cast<size_t>(log_length) + 1u);
+		glGetShaderInfoLog(shader, log_length, nullptr, log.get());
+		LogError("Failed to compile \"%s\":\n%s", path.c_str(), log.get());
+		return false;
+	}
+}
+
+bonobo::shader_manager::shader_manager() : _entries(), _parallel_compile(local::has_parallel_compile()), _updates_nb(0u), _mutex(), _changed_files(), _watched_directories(), _watched_files(), _stop(false), _inotify_fd(-1), _watcher()
+{
+#if defined(__linux__)
+	_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (_inotify_fd < 0)
+		LogWarning("Failed to initialise inotify: shaders will only be reloaded on request");
+#endif
+	LogInfo("Shader hot reload: %s compilation",
+	        _parallel_compile ? "parallel" : "deferred");
+	_watcher = std::thread(&shader_manager::run_watcher, this);
+}
+
+bonobo::shader_manager::~shader_manager()
+{
+	_stop = true;
+	_watcher.join();
+#if defined(__linux__)
+	if (_inotify_fd >= 0)
+		close(_inotify_fd);
+#endif
+
+	for (auto& e : _entries) {
+		discard_build(e);
+		if (e.program != e.fallback) {
+			forgetProgramUniforms(e.program);
+			glDeleteProgram(e.program);
+		}
+	}
+}
+
+bonobo::shader_manager::program_id
+bonobo::shader_manager::add(std::string const& vert_shader_source_path, std::string const& frag_shader_source_path, GLuint fallback)
+{
+	entry e;
+	e.vertex_path = config::shaders_path("EDAF80/" + vert_shader_source_path);
+	e.fragment_path = config::shaders_path("EDAF80/" + frag_shader_source_path);
+	e.program = createProgram(vert_shader_source_path, frag_shader_source_path);
+	e.fallback = fallback;
+	e.pending = build();
+	if (e.program == 0u) {
+		LogError("Failed to load \"%s\" and \"%s\"", vert_shader_source_path.c_str(), frag_shader_source_path.c_str());
+		e.program = fallback;
+	}
+
+	watch(e.vertex_path);
+	watch(e.fragment_path);
+
+	_entries.push_back(e);
+	return _entries.size() - 1u;
+}
+
+GLuint
+bonobo::shader_manager::get(program_id id) const
+{
+	return _entries[id].program;
+}
+
+void
+bonobo::shader_manager::reload_all()
+{
+	for (auto& e : _entries)
+		start_build(e);
+}
+
+bool
+bonobo::shader_manager::update()
+{
+	PROFILE_SCOPE("shader_manager::update");
+	++_updates_nb;
+	auto changed_files = std::vector<std::string>();
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		changed_files.swap(_changed_files);
+	}
+	for (auto& e : _entries) {
+		for (auto const& path : changed_files) {
+			if (path == e.vertex_path || path == e.fragment_path) {
+				start_build(e);
+				break;
+			}
+		}
+	}
+
+	auto swapped = false;
+	for (auto& e : _entries) {
+		if (e.pending.program == 0u)
+			continue;
+
+		// Without the extension, the status is queried by the update
+		// following the one the build started in, i.e. a frame later,
+		// leaving the driver that frame to work on it.
+		if (_parallel_compile) {
+			GLint completed = GL_FALSE;
+			glGetProgramiv(e.pending.program, local::completion_status, &completed);
+			if (completed == GL_FALSE)
+				continue;
+		} else if (e.pending.start_update == _updates_nb) {
+			continue;
+		}
+
+		swapped = finish_build(e) || swapped;
+	}
+	return swapped;
+}
+
+void
+bonobo::shader_manager::start_build(entry& e)
+{
+	// A build still in progress is outdated by the new sources.
+	discard_build(e);
+
+	auto const vertex_source = utils::slurp_file(e.vertex_path);
+	auto const fragment_source = utils::slurp_file(e.fragment_path);
+	if (vertex_source.empty() || fragment_source.empty()) {
+		LogError("Failed to read \"%s\" or \"%s\"", e.vertex_path.c_str(), e.fragment_path.c_str());
+		return;
+	}
+
+	e.pending.start_time = GetTimeMilliseconds();
+	e.pending.start_update = _updates_nb;
+	e.pending.sources_hash = program_cache::hashSources({ vertex_source, fragment_source });
+	e.pending.vertex_shader = local::start_shader(GL_VERTEX_SHADER, vertex_source);
+	e.pending.fragment_shader = local::start_shader(GL_FRAGMENT_SHADER, fragment_source);
+
+	// Linking is requested right away, without checking the shaders: a
+	// failed compilation simply makes the link fail too.
+	e.pending.program = glCreateProgram();
+	glAttachShader(e.pending.program, e.pending.vertex_shader);
+	glAttachShader(e.pending.program, e.pending.fragment_shader);
+	glProgramParameteri(e.pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(e.pending.program);
+}
+
+bool
+bonobo::shader_manager::finish_build(entry& e)
+{
+	auto const vertex_ok = local::check_shader(e.pending.vertex_shader, e.vertex_path);
+	auto const fragment_ok = local::check_shader(e.pending.fragment_shader, e.fragment_path);
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(e.pending.program, GL_LINK_STATUS, &linked);
+	if (vertex_ok && fragment_ok && linked == GL_FALSE) {
+		GLint log_length = 0;
+		glGetProgramiv(e.pending.program, GL_INFO_LOG_LENGTH, &log_length);
+		auto log = std::make_unique<GLchar[]>(static_cast<size_t>(log_length) + 1u);
+		glGetProgramInfoLog(e.pending.program, log_length, nullptr, log.get());
+		LogError("Failed to link \"%s\" and \"%s\":\n%s", e.vertex_path.c_str(), e.fragment_path.c_str(), log.get());
+	}
+	if (!vertex_ok || !fragment_ok || linked == GL_FALSE) {
+		LogWarning("Keeping the previous program for \"%s\" and \"%s\"", e.vertex_path.c_str(), e.fragment_path.c_str());
+		discard_build(e);
+		return false;
+	}
+
+	auto const program = e.pending.program;
+	reflectProgramUniforms(program);
+	bindProgramUniformBlocks(program);
+	if (program_cache::isSupported())
+		program_cache::store(e.pending.sources_hash, program);
+
+	if (e.program != e.fallback) {
+		forgetProgramUniforms(e.program);
+		glDeleteProgram(e.program);
+	}
+	e.program = program;
+
+	LogInfo("Reloaded \"%s\" and \"%s\" in %.1f ms", e.vertex_path.c_str(), e.fragment_path.c_str(),
+	        GetTimeMilliseconds() - e.pending.start_time);
+
+	// The program keeps working once its shaders are gone.
+	glDeleteShader(e.pending.vertex_shader);
+	glDeleteShader(e.pending.fragment_shader);
+	e.pending = build();
+	return true;
+}
+
+void
+bonobo::shader_manager::discard_build(entry& e)
+{
+	if (e.pending.program == 0u)
+		return;
+	glDeleteProgram(e.pending.program);
+	glDeleteShader(e.pending.vertex_shader);
+	glDeleteShader(e.pending.fragment_shader);
+	e.pending = build();
+}
+
+void
+bonobo::shader_manager::watch(std::string const& path)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+#if defined(__linux__)
+	if (_inotify_fd >= 0) {
+		auto const directory = local::directory_of(path);
+		for (auto const& watched : _watched_directories)
+			if (watched.second == directory)
+				return;
+
+		// Editors often save by writing a new file and renaming it over
+		// the old one, hence IN_MOVED_TO.
+		auto const wd = inotify_add_watch(_inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (wd >= 0)
+			_watched_directories[wd] = directory;
+		else
+			LogWarning("Failed to watch \"%s\"", directory.c_str());
+		return;
+	}
+#endif
+	for (auto const& watched : _watched_files)
+		if (watched.path == path)
+			return;
+	_watched_files.push_back({ path, local::modification_time(path) });
+}
+
+// Runs on its own thread, so must neither log nor touch OpenGL.
+void
+bonobo::shader_manager::run_watcher()
+{
+	while (!_stop) {
+#if defined(__linux__)
+		if (_inotify_fd >= 0) {
+			pollfd fd = { _inotify_fd, POLLIN, 0 };
+			if (poll(&fd, 1, local::watch_period_ms) <= 0)
+				continue;
+
+			alignas(inotify_event) char buffer[4096];
+			auto const length = read(_inotify_fd, buffer, sizeof(buffer));
+			if (length <= 0)
+				continue;
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			for (auto cursor = buffer; cursor < buffer + length;) {
+				auto const event = reinterpret_cast<inotify_event const*>(cursor);
+				auto const directory = _watched_directories.find(event->wd);
+				if (event->len > 0u && directory != _watched_directories.end())
+					_changed_files.push_back(directory->second + "/" + event->name);
+				cursor += sizeof(inotify_event) + event->len;
+			}
+			continue;
+		}
+#endif
+		std::this_thread::sleep_for(std::chrono::milliseconds(local::watch_period_ms));
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (auto& watched : _watched_files) {
+			auto const time = local::modification_time(watched.path);
+			if (time != watched.modification_time) {
+				watched.modification_time = time;
+				_changed_files.push_back(watched.path);
+			}
+		}
+	}
+}
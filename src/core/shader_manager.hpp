@@ -0,0 +1,115 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Owns shader programs and rebuilds them when their sources
+	//!        change on disk.
+	//!
+	//! A background thread watches the folders containing the registered
+	//! sources, using inotify on Linux and polling modification times
+	//! elsewhere. Only the programs using a modified file are rebuilt;
+	//! their compilation is started by `update()` and, where
+	//! `GL_KHR_parallel_shader_compile` is available, only checked once
+	//! the driver reports it complete, so that the frame never waits on
+	//! it; otherwise it is checked by the next call to `update()`, giving
+	//! the driver a frame to work on it first. The new program then replaces the old one, which remains in
+	//! use if anything failed.
+	//!
+	//! Programs should be looked up through `get()` every frame, rather
+	//! than kept around, to pick up replacements.
+	class shader_manager
+	{
+	public:
+		using program_id = size_t;
+
+		//! \brief Start watching; requires a current OpenGL context.
+		shader_manager();
+
+		//! \brief Stop watching and delete all programs, except the
+		//!        fallbacks.
+		~shader_manager();
+
+		shader_manager(shader_manager const&) = delete;
+		shader_manager& operator=(shader_manager const&) = delete;
+
+		//! \brief Build a program and watch its sources.
+		//!
+		//! @param [in] vert_shader_source_path of the vertex shader source
+		//!             code, relative to the `shaders/EDAF80` folder
+		//! @param [in] frag_shader_source_path of the fragment shader source
+		//!             code, relative to the `shaders/EDAF80` folder
+		//! @param [in] fallback program returned by `get()` until the
+		//!             sources build successfully; it is not owned
+		//! @return identifier of the program within the manager
+		program_id add(std::string const& vert_shader_source_path,
+		               std::string const& frag_shader_source_path,
+		               GLuint fallback = 0u);
+
+		//! \brief Get the current name of a program.
+		GLuint get(program_id id) const;
+
+		//! \brief Rebuild all programs, whether they changed or not.
+		void reload_all();
+
+		//! \brief Start rebuilding the programs whose sources changed, and
+		//!        swap in those which finished building; to be called at
+		//!        the start of a frame.
+		//!
+		//! @return whether any program got replaced
+		bool update();
+
+	private:
+		struct build {
+			GLuint program;
+			GLuint vertex_shader;
+			GLuint fragment_shader;
+			uint64_t sources_hash;
+			double start_time;
+			size_t start_update; //!< value of `_updates_nb` when started
+		};
+
+		struct entry {
+			std::string vertex_path;
+			std::string fragment_path;
+			GLuint program;
+			GLuint fallback;
+			build pending;
+		};
+
+		struct watched_file {
+			std::string path;
+			std::time_t modification_time;
+		};
+
+		void start_build(entry& e);
+		bool finish_build(entry& e);
+		void discard_build(entry& e);
+		void watch(std::string const& path);
+		void run_watcher();
+
+		std::vector<entry> _entries;
+		bool _parallel_compile;
+		size_t _updates_nb;
+
+		// Shared with the watcher thread.
+		std::mutex _mutex;
+		std::vector<std::string> _changed_files;
+		std::unordered_map<int, std::string> _watched_directories;
+		std::vector<watched_file> _watched_files;
+		std::atomic<bool> _stop;
+		int _inotify_fd;
+		std::thread _watcher;
+	};
+}
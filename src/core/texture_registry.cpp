@@ -0,0 +1,148 @@
+#include "texture_registry.hpp"
+
+#include "core/gl_state.hpp"
+#include "core/Log.h"
+#include "core/Misc.h"
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+namespace local
+{
+	struct texture_entry {
+		GLuint texture;
+		size_t references_nb;
+		size_t bytes;
+		double load_time_ms;
+	};
+
+	static std::unordered_map<std::string, texture_entry> entries;
+	static std::unordered_map<GLuint, std::string> keys;
+	static bonobo::texture_registry_stats stats = {};
+
+	static std::string make_key(std::string const& filename, bool generate_mipmap)
+	{
+		auto key = filename;
+		std::replace(key.begin(), key.end(), '\\', '/');
+		key += generate_mipmap ? "|mipmapped" : "|single";
+		return key;
+	}
+
+	static size_t texture_size(GLuint texture, bool generate_mipmap)
+	{
+		GLint width = 0, height = 0;
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+		glBindTexture(GL_TEXTURE_2D, 0u);
+		bonobo::gl_state::invalidate();
+
+		// Textures are stored as RGBA8; a full mipmap chain adds a third.
+		auto const base_size = static_cast<size_t>(width) * static_cast<size_t>(height) * 4u;
+		return generate_mipmap ? base_size + base_size / 3u : base_size;
+	}
+}
+
+GLuint
+bonobo::acquireTexture2D(std::string const& filename, bool generate_mipmap)
+{
+	return bonobo::acquireTextures2D({ { filename, generate_mipmap } }).front();
+}
+
+std::vector<GLuint>
+bonobo::acquireTextures2D(std::vector<texture_request> const& requests)
+{
+	auto textures = std::vector<GLuint>(requests.size(), 0u);
+
+	// Gather the textures to load, each of them once even if requested
+	// several times within the batch.
+	auto keys = std::vector<std::string>(requests.size());
+	auto missing = std::vector<texture_request>();
+	auto missing_keys = std::unordered_map<std::string, size_t>();
+	for (size_t i = 0u; i < requests.size(); ++i) {
+		keys[i] = local::make_key(requests[i].filename, requests[i].generate_mipmap);
+		if (local::entries.find(keys[i]) == local::entries.end()
+		 && missing_keys.emplace(keys[i], missing.size()).second)
+			missing.push_back(requests[i]);
+	}
+
+	if (!missing.empty()) {
+		auto const start_time = StartTimer();
+		auto const loaded = bonobo::loadTextures2D(missing);
+		// Images are decoded concurrently, so only the time of the whole
+		// batch is known; spread it evenly.
+		auto const load_time_ms = static_cast<double>(EndTimerNanoseconds(start_time)) * 0.000001;
+		auto const load_time_per_texture_ms = load_time_ms / static_cast<double>(missing.size());
+		local::stats.load_time_ms += load_time_ms;
+
+		for (auto const& missing_key : missing_keys) {
+			auto const texture = loaded[missing_key.second];
+			if (texture == 0u)
+				continue;
+
+			auto const bytes = local::texture_size(texture, missing[missing_key.second].generate_mipmap);
+			local::entries.emplace(missing_key.first, local::texture_entry{ texture, 0u, bytes, load_time_per_texture_ms });
+			local::keys.emplace(texture, missing_key.first);
+
+			++local::stats.textures_nb;
+			++local::stats.loads_nb;
+			local::stats.bytes_resident += bytes;
+		}
+	}
+
+	for (size_t i = 0u; i < requests.size(); ++i) {
+		auto const it = local::entries.find(keys[i]);
+		if (it == local::entries.end())
+			continue;
+
+		auto& entry = it->second;
+		if (entry.references_nb++ > 0u) {
+			++local::stats.hits_nb;
+			local::stats.bytes_saved += entry.bytes;
+			local::stats.load_time_saved_ms += entry.load_time_ms;
+		}
+		textures[i] = entry.texture;
+	}
+
+	return textures;
+}
+
+void
+bonobo::releaseTexture(GLuint texture)
+{
+	auto const key_it = local::keys.find(texture);
+	if (key_it == local::keys.end()) {
+		LogWarning("Texture %u was not obtained from the texture registry", texture);
+		return;
+	}
+
+	auto const entry_it = local::entries.find(key_it->second);
+	assert(entry_it != local::entries.end());
+	auto& entry = entry_it->second;
+	if (--entry.references_nb > 0u)
+		return;
+
+	glDeleteTextures(1, &entry.texture);
+	bonobo::gl_state::invalidate();
+	--local::stats.textures_nb;
+	local::stats.bytes_resident -= entry.bytes;
+	local::entries.erase(entry_it);
+	local::keys.erase(key_it);
+}
+
+bonobo::texture_registry_stats
+bonobo::getTextureRegistryStats()
+{
+	return local::stats;
+}
+
+void
+bonobo::logTextureRegistryStats()
+{
+	auto const& stats = local::stats;
+	LogInfo("Texture registry: %zu textures resident (%.1f MB), %zu loads taking %.1f ms; %zu duplicate requests saved %.1f MB and %.1f ms",
+	        stats.textures_nb, static_cast<double>(stats.bytes_resident) / (1024.0 * 1024.0),
+	        stats.loads_nb, stats.load_time_ms,
+	        stats.hits_nb, static_cast<double>(stats.bytes_saved) / (1024.0 * 1024.0), stats.load_time_saved_ms);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "helpers.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Statistics on how much work the texture registry avoided.
+	struct texture_registry_stats {
+		size_t textures_nb;      //!< number of distinct textures currently loaded
+		size_t loads_nb;         //!< number of textures actually decoded and uploaded
+		size_t hits_nb;          //!< number of requests served from the registry
+		size_t bytes_resident;   //!< estimated GPU memory used by loaded textures
+		size_t bytes_saved;      //!< estimated GPU memory that duplicates would have used
+		double load_time_ms;     //!< time spent decoding and uploading
+		double load_time_saved_ms; //!< time duplicates would have spent decoding and uploading
+	};
+
+	//! \brief Get a 2D-texture for a PNG image, loading it only if it is
+	//!        not already resident.
+	//!
+	//! Textures are keyed by path and by whether they have mipmaps, and
+	//! are reference counted: every successful call must eventually be
+	//! matched by a call to `releaseTexture()`.
+	//!
+	//! @param [in] filename of the PNG image, relative to the `textures`
+	//!             folder within the `resources` folder
+	//! @param [in] generate_mipmap whether or not to generate a mipmap hierarchy
+	//! @return the name of the OpenGL 2D-texture, or 0 on failure
+	GLuint acquireTexture2D(std::string const& filename,
+	                        bool generate_mipmap = true);
+
+	//! \brief Batched version of `acquireTexture2D()`: all images not
+	//!        yet resident are decoded in parallel through
+	//!        `loadTextures2D()`.
+	//!
+	//! @param [in] requests images to acquire and how
+	//! @return the names of the OpenGL 2D-textures, in the order of
+	//!         `requests`, with 0 for images that failed to load
+	std::vector<GLuint> acquireTextures2D(std::vector<texture_request> const& requests);
+
+	//! \brief Drop one reference to a texture obtained from
+	//!        `acquireTexture2D()`, deleting it once unused.
+	//!
+	//! @param [in] texture the OpenGL name of the texture
+	void releaseTexture(GLuint texture);
+
+	//! \brief Retrieve the current registry statistics.
+	texture_registry_stats getTextureRegistryStats();
+
+	//! \brief Log the current registry statistics.
+	void logTextureRegistryStats();
+}
@@ -0,0 +1,125 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace local
+{
+	struct parallel_for_job {
+		std::function<void(std::size_t)> const* fn;
+		std::size_t count;
+		std::atomic<std::size_t> next;
+		std::atomic<std::size_t> done;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	// Run iterations until none are left. The job is shared so that
+	// helpers only dequeued after the caller returned find nothing to do
+	// rather than a dangling job.
+	static void work_on(std::shared_ptr<parallel_for_job> const& job)
+	{
+		for (;;) {
+			auto const i = job->next.fetch_add(1u);
+			if (i >= job->count)
+				return;
+			(*job->fn)(i);
+			if (job->done.fetch_add(1u) + 1u == job->count) {
+				std::lock_guard<std::mutex> lock(job->mutex);
+				job->finished.notify_all();
+			}
+		}
+	}
+}
+
+utils::thread_pool::thread_pool(std::size_t threads_nb) : _stopping(false)
+{
+	if (threads_nb == 0u) {
+		auto const hardware_threads_nb = static_cast<std::size_t>(std::thread::hardware_concurrency());
+		threads_nb = std::max<std::size_t>(hardware_threads_nb, 2u) - 1u;
+	}
+
+	_workers.reserve(threads_nb);
+	for (std::size_t i = 0u; i < threads_nb; ++i)
+		_workers.emplace_back([this](){ run(); });
+}
+
+utils::thread_pool::~thread_pool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_wake_up.notify_all();
+	for (auto& worker : _workers)
+		worker.join();
+}
+
+utils::thread_pool&
+utils::thread_pool::instance()
+{
+	static thread_pool pool;
+	return pool;
+}
+
+void
+utils::thread_pool::submit(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_tasks.push_back(std::move(task));
+	}
+	_wake_up.notify_one();
+}
+
+void
+utils::thread_pool::parallel_for(std::size_t count, std::function<void(std::size_t)> const& fn)
+{
+	if (count == 0u)
+		return;
+	if (count == 1u || _workers.empty()) {
+		for (std::size_t i = 0u; i < count; ++i)
+			fn(i);
+		return;
+	}
+
+	auto job = std::make_shared<local::parallel_for_job>();
+	job->fn = &fn;
+	job->count = count;
+	job->next = 0u;
+	job->done = 0u;
+
+	// The caller works too, so one helper less than iterations is enough.
+	auto const helpers_nb = std::min(_workers.size(), count - 1u);
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (std::size_t i = 0u; i < helpers_nb; ++i)
+			_tasks.push_back([job](){ local::work_on(job); });
+	}
+	_wake_up.notify_all();
+
+	local::work_on(job);
+
+	// Wait on completed iterations rather than on the helpers themselves:
+	// when called from a worker, the helpers may never get to start.
+	std::unique_lock<std::mutex> lock(job->mutex);
+	job->finished.wait(lock, [&job](){ return job->done.load() == job->count; });
+}
+
+void
+utils::thread_pool::run()
+{
+	for (;;) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake_up.wait(lock, [this](){ return _stopping || !_tasks.empty(); });
+			if (_stopping && _tasks.empty())
+				return;
+			task = std::move(_tasks.front());
+			_tasks.pop_front();
+		}
+		task();
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils
+{
+
+//! \brief Fixed set of worker threads running queued tasks.
+//!
+//! Tasks must not touch OpenGL: the context is only current on the main
+//! thread. Use the pool to prepare data, then upload it from the main
+//! thread once `parallel_for()` returns.
+class thread_pool
+{
+public:
+	//! \brief Start a pool.
+	//!
+	//! @param [in] threads_nb number of workers; 0 picks one less than
+	//!             the number of hardware threads, as the calling thread
+	//!             takes part in `parallel_for()`
+	explicit thread_pool(std::size_t threads_nb = 0u);
+	thread_pool(thread_pool const&) = delete;
+	thread_pool& operator=(thread_pool const&) = delete;
+	~thread_pool();
+
+	//! \brief Pool shared by the whole framework, started on first use.
+	static thread_pool& instance();
+
+	//! \brief Number of worker threads, not counting the caller.
+	std::size_t threads_nb() const { return _workers.size(); }
+
+	//! \brief Queue a task, to be run by whichever worker is free first.
+	void submit(std::function<void()> task);
+
+	//! \brief Call `fn(i)` for every i in [0, count), spreading the calls
+	//!        over the workers and the calling thread, and return once
+	//!        all of them are done.
+	void parallel_for(std::size_t count, std::function<void(std::size_t)> const& fn);
+
+private:
+	void run();
+
+	std::vector<std::thread> _workers;
+	std::deque<std::function<void()>> _tasks;
+	std::mutex _mutex;
+	std::condition_variable _wake_up;
+	bool _stopping;
+};
+
+} // end of namespace
@@ -0,0 +1,137 @@
+#include "uniform_buffer.hpp"
+
+#include "core/Log.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace local
+{
+	static char const* const block_names[] = {
+		"PerFrame",
+		"PerView",
+		"PerLight"
+	};
+	static_assert(sizeof(block_names) / sizeof(block_names[0]) == static_cast<size_t>(bonobo::uniform_block_binding::count),
+	              "Every binding point needs a block name");
+
+	// How long to block at once on a fence before checking the result.
+	constexpr GLuint64 fence_timeout_ns = 1000000000u;
+
+	static size_t align(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1u) / alignment * alignment;
+	}
+}
+
+void
+bonobo::bindProgramUniformBlocks(GLuint program)
+{
+	for (GLuint binding = 0u; binding < static_cast<GLuint>(uniform_block_binding::count); ++binding) {
+		auto const index = glGetUniformBlockIndex(program, local::block_names[binding]);
+		if (index != GL_INVALID_INDEX)
+			glUniformBlockBinding(program, index, binding);
+	}
+}
+
+bonobo::uniform_ring::uniform_ring(size_t region_size, size_t regions_nb) : _ubo(0u), _region_size(0u), _alignment(0u), _current(0u), _used(0u), _mapped(nullptr), _fences(regions_nb, nullptr)
+{
+	assert(regions_nb > 0u);
+
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	_alignment = alignment > 0 ? static_cast<size_t>(alignment) : 256u;
+	_region_size = local::align(region_size, _alignment);
+
+	glGenBuffers(1, &_ubo);
+	assert(_ubo != 0u);
+	glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+	glBufferData(GL_UNIFORM_BUFFER, static_cast<GLsizeiptr>(_region_size * regions_nb), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+}
+
+bonobo::uniform_ring::~uniform_ring()
+{
+	if (_mapped != nullptr)
+		end_frame();
+	for (auto fence : _fences)
+		if (fence != nullptr)
+			glDeleteSync(fence);
+	glDeleteBuffers(1, &_ubo);
+}
+
+void
+bonobo::uniform_ring::begin_frame()
+{
+	if (_mapped != nullptr)
+		end_frame();
+
+	// All draws reading from the region of the previous frame have been
+	// issued by now.
+	if (_fences[_current] != nullptr)
+		glDeleteSync(_fences[_current]);
+	_fences[_current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	_current = (_current + 1u) % _fences.size();
+	if (_fences[_current] != nullptr) {
+		auto status = glClientWaitSync(_fences[_current], GL_SYNC_FLUSH_COMMANDS_BIT, local::fence_timeout_ns);
+		while (status == GL_TIMEOUT_EXPIRED)
+			status = glClientWaitSync(_fences[_current], 0, local::fence_timeout_ns);
+		if (status == GL_WAIT_FAILED)
+			LogError("Failed to wait on uniform buffer region %u", static_cast<unsigned int>(_current));
+		glDeleteSync(_fences[_current]);
+		_fences[_current] = nullptr;
+	}
+
+	// The fence guarantees the GPU is done with the region, so the
+	// driver does not need to synchronise anything itself.
+	glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+	_mapped = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER,
+	                                                       static_cast<GLintptr>(_current * _region_size),
+	                                                       static_cast<GLsizeiptr>(_region_size),
+	                                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+	glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+	if (_mapped == nullptr)
+		LogError("Failed to map uniform buffer region %u", static_cast<unsigned int>(_current));
+	_used = 0u;
+}
+
+GLintptr
+bonobo::uniform_ring::write(void const* data, size_t size)
+{
+	if (_mapped == nullptr) {
+		LogError("Uniform blocks can only be written between begin_frame() and end_frame()");
+		return -1;
+	}
+	if (_used + size > _region_size) {
+		LogError("Uniform buffer region is full: %u bytes requested, %u available",
+		         static_cast<unsigned int>(size), static_cast<unsigned int>(_region_size - _used));
+		return -1;
+	}
+
+	std::memcpy(_mapped + _used, data, size);
+	auto const offset = static_cast<GLintptr>(_current * _region_size + _used);
+	_used = local::align(_used + size, _alignment);
+	return offset;
+}
+
+void
+bonobo::uniform_ring::end_frame()
+{
+	if (_mapped == nullptr)
+		return;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, _ubo);
+	if (glUnmapBuffer(GL_UNIFORM_BUFFER) == GL_FALSE)
+		LogWarning("Uniform buffer content got corrupted; it will be rewritten next frame");
+	glBindBuffer(GL_UNIFORM_BUFFER, 0u);
+	_mapped = nullptr;
+}
+
+void
+bonobo::uniform_ring::bind(uniform_block_binding binding, GLintptr offset, size_t size) const
+{
+	if (offset < 0)
+		return;
+	glBindBufferRange(GL_UNIFORM_BUFFER, static_cast<GLuint>(binding), _ubo, offset, static_cast<GLsizeiptr>(size));
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Binding points of the uniform blocks shared by all programs.
+	//!
+	//! A program declaring a block named `PerFrame`, `PerView` or
+	//! `PerLight` gets it assigned to the matching binding point when
+	//! linked through `utils::opengl::shader::generate_program()`, so
+	//! there is no need for `layout(binding = …)`, which GLSL 4.10 lacks.
+	enum class uniform_block_binding : GLuint {
+		per_frame = 0u, //!< constants changing at most once per frame: time, resolution, …
+		per_view  = 1u, //!< constants of the camera being rendered from
+		per_light = 2u, //!< constants of one light, selected per draw by its offset
+		count
+	};
+
+	//! \brief Assign the blocks of a program to the binding points of
+	//!        `uniform_block_binding`, based on their names.
+	//!
+	//! @param [in] program OpenGL name of a successfully linked program
+	void bindProgramUniformBlocks(GLuint program);
+
+	//! \brief Uniform buffer written once per frame and read by all draws
+	//!        of that frame.
+	//!
+	//! The buffer is split in a few regions used in turn, one per frame:
+	//! while the GPU still reads from the regions of the previous frames,
+	//! the current one can be written without any synchronisation. A
+	//! fence is only waited on when the CPU gets a full ring ahead of the
+	//! GPU.
+	//!
+	//! Blocks are written between `begin_frame()` and `end_frame()`, which
+	//! return their offset in the buffer; draws then select them through
+	//! `bind()`, a single `glBindBufferRange()`, instead of re-uploading
+	//! each uniform.
+	class uniform_ring
+	{
+	public:
+		//! \brief Create the buffer.
+		//!
+		//! @param [in] region_size maximum number of bytes written per
+		//!             frame, alignment padding included
+		//! @param [in] regions_nb number of frames that can be in flight
+		uniform_ring(size_t region_size, size_t regions_nb = 3u);
+		~uniform_ring();
+
+		uniform_ring(uniform_ring const&) = delete;
+		uniform_ring& operator=(uniform_ring const&) = delete;
+
+		//! \brief Move to the next region and map it for writing.
+		void begin_frame();
+
+		//! \brief Copy a block into the current region.
+		//!
+		//! @param [in] data content of the block, laid out as std140
+		//! @param [in] size size of the block, in bytes
+		//! @return the offset of the block in the buffer, or -1 if the
+		//!         region is full or not mapped
+		GLintptr write(void const* data, size_t size);
+
+		template<typename T>
+		GLintptr write(T const& block) { return write(&block, sizeof(T)); }
+
+		//! \brief Unmap the current region; it has to be done before
+		//!        issuing any draw reading from it.
+		void end_frame();
+
+		//! \brief Bind a block previously returned by `write()`.
+		//!
+		//! @param [in] binding binding point the block is read from
+		//! @param [in] offset value returned by `write()`
+		//! @param [in] size size of the block, in bytes
+		void bind(uniform_block_binding binding, GLintptr offset, size_t size) const;
+
+		template<typename T>
+		void bind(uniform_block_binding binding, GLintptr offset) const { bind(binding, offset, sizeof(T)); }
+
+	private:
+		GLuint _ubo;
+		size_t _region_size;
+		size_t _alignment;
+		size_t _current;
+		size_t _used;
+		unsigned char* _mapped;
+		std::vector<GLsync> _fences;
+	};
+}
@@ -0,0 +1,119 @@
+#include "uniform_cache.hpp"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace local
+{
+	// Both tables are only ever touched from the thread owning the OpenGL
+	// context, so they are not protected.
+	static std::unordered_map<std::string, bonobo::uniform_id>& names()
+	{
+		static std::unordered_map<std::string, bonobo::uniform_id> table;
+		return table;
+	}
+
+	static std::unordered_map<GLuint, std::vector<GLint>>& programs()
+	{
+		static std::unordered_map<GLuint, std::vector<GLint>> table;
+		return table;
+	}
+
+	// Consecutive draws very often use the same program, so remember the
+	// last table looked up to skip even the hash of the program name.
+	static GLuint last_program = 0u;
+	static std::vector<GLint> const* last_locations = nullptr;
+
+	static std::string strip_array_suffix(std::string const& name)
+	{
+		auto const suffix = std::string("[0]");
+		if (name.size() > suffix.size()
+		 && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0)
+			return name.substr(0u, name.size() - suffix.size());
+		return name;
+	}
+
+	static std::vector<GLint> const& reflect(GLuint program)
+	{
+		GLint uniforms_nb = 0, max_name_length = 0;
+		glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniforms_nb);
+		glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_name_length);
+
+		auto locations = std::vector<GLint>();
+		auto name_buffer = std::make_unique<GLchar[]>(static_cast<size_t>(max_name_length) + 1u);
+		for (GLint i = 0; i < uniforms_nb; ++i) {
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type = GL_NONE;
+			glGetActiveUniform(program, static_cast<GLuint>(i), max_name_length, &length, &size, &type, name_buffer.get());
+			auto const location = glGetUniformLocation(program, name_buffer.get());
+			if (location < 0) // Part of a uniform block
+				continue;
+
+			auto const id = bonobo::getUniformID(std::string(name_buffer.get(), static_cast<size_t>(length)));
+			if (id >= locations.size())
+				locations.resize(id + 1u, -1);
+			locations[id] = location;
+		}
+
+		auto& entry = programs()[program];
+		entry = std::move(locations);
+		last_program = program;
+		last_locations = &entry;
+		return entry;
+	}
+}
+
+bonobo::uniform_id
+bonobo::getUniformID(std::string const& name)
+{
+	auto& names = local::names();
+	auto const key = local::strip_array_suffix(name);
+	auto const it = names.find(key);
+	if (it != names.end())
+		return it->second;
+
+	auto const id = static_cast<uniform_id>(names.size());
+	names.emplace(key, id);
+	return id;
+}
+
+GLint
+bonobo::getUniformLocation(GLuint program, uniform_id id)
+{
+	if (program == 0u)
+		return -1;
+
+	std::vector<GLint> const* locations = nullptr;
+	if (program == local::last_program && local::last_locations != nullptr) {
+		locations = local::last_locations;
+	} else {
+		auto& programs = local::programs();
+		auto const it = programs.find(program);
+		locations = (it != programs.end()) ? &it->second : &local::reflect(program);
+		local::last_program = program;
+		local::last_locations = locations;
+	}
+
+	// A name interned after the program was reflected cannot be one of
+	// its active uniforms, as reflection interns all of them.
+	return id < locations->size() ? (*locations)[id] : -1;
+}
+
+void
+bonobo::reflectProgramUniforms(GLuint program)
+{
+	if (program != 0u)
+		local::reflect(program);
+}
+
+void
+bonobo::forgetProgramUniforms(GLuint program)
+{
+	local::programs().erase(program);
+	if (local::last_program == program) {
+		local::last_program = 0u;
+		local::last_locations = nullptr;
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "external/glad/glad.h"
+
+#include <cstdint>
+#include <string>
+
+namespace bonobo
+{
+	//! \brief Interned identifier of a GLSL uniform name.
+	//!
+	//! Identifiers are small consecutive integers, so that looking up the
+	//! location of a uniform for a given program is an array access rather
+	//! than a string lookup done by the driver.
+	using uniform_id = uint32_t;
+
+	//! \brief Retrieve the identifier associated to a uniform name,
+	//!        creating it if that name was never seen before.
+	//!
+	//! This hashes the name, so it should be called once, outside of the
+	//! render loop, and its result kept around.
+	//!
+	//! @param [in] name of the uniform as written in GLSL; for arrays,
+	//!             both `name` and `name[0]` map to the same identifier
+	//! @return the identifier for that name
+	uniform_id getUniformID(std::string const& name);
+
+	//! \brief Retrieve the location of a uniform in a program.
+	//!
+	//! Programs created through `utils::opengl::shader::generate_program()`
+	//! (and hence `bonobo::createProgram()`) are reflected at link time;
+	//! other programs are reflected on first use.
+	//!
+	//! @param [in] program OpenGL name of a linked shader program
+	//! @param [in] id identifier returned by `getUniformID()`
+	//! @return the location of the uniform, or -1 if the program has no
+	//!         active uniform with that name
+	GLint getUniformLocation(GLuint program, uniform_id id);
+
+	//! \brief Query all active uniforms of a program and fill in its
+	//!        location cache, replacing any previous entry for that name.
+	//!
+	//! @param [in] program OpenGL name of a successfully linked program
+	void reflectProgramUniforms(GLuint program);
+
+	//! \brief Drop the location cache of a program, for example before
+	//!        deleting or relinking it.
+	//!
+	//! @param [in] program OpenGL name of the program to forget
+	void forgetProgramUniforms(GLuint program);
+}
@@ -1,8 +1,18 @@
 #include "various.hpp"
 
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <utility>
 
 
 std::string
@@ -24,3 +34,128 @@ utils::slurp_file(std::string const& path)
 
   return std::string(content.get());
 }
+
+std::uint64_t
+utils::hash_fnv1a(void const* data, std::size_t size, std::uint64_t seed)
+{
+  auto const bytes = static_cast<unsigned char const*>(data);
+  auto hash = seed;
+  for (std::size_t i = 0u; i < size; ++i) {
+    hash ^= static_cast<std::uint64_t>(bytes[i]);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+#ifdef _WIN32
+utils::mapped_file::mapped_file() : _data(nullptr), _size(0u), _file(INVALID_HANDLE_VALUE), _mapping(nullptr)
+{
+}
+
+utils::mapped_file::mapped_file(std::string const& path) : mapped_file()
+{
+  _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (_file == INVALID_HANDLE_VALUE)
+    return;
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0) {
+    close();
+    return;
+  }
+  _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (_mapping == nullptr) {
+    close();
+    return;
+  }
+  _data = MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+  _size = _data != nullptr ? static_cast<std::size_t>(size.QuadPart) : 0u;
+}
+
+void
+utils::mapped_file::close()
+{
+  if (_data != nullptr)
+    UnmapViewOfFile(_data);
+  if (_mapping != nullptr)
+    CloseHandle(_mapping);
+  if (_file != INVALID_HANDLE_VALUE)
+    CloseHandle(_file);
+  _data = nullptr;
+  _size = 0u;
+  _mapping = nullptr;
+  _file = INVALID_HANDLE_VALUE;
+}
+
+utils::mapped_file::mapped_file(mapped_file&& other) : _data(other._data), _size(other._size), _file(other._file), _mapping(other._mapping)
+{
+  other._data = nullptr;
+  other._size = 0u;
+  other._file = INVALID_HANDLE_VALUE;
+  other._mapping = nullptr;
+}
+
+utils::mapped_file&
+utils::mapped_file::operator=(mapped_file&& other)
+{
+  if (this != &other) {
+    close();
+    std::swap(_data, other._data);
+    std::swap(_size, other._size);
+    std::swap(_file, other._file);
+    std::swap(_mapping, other._mapping);
+  }
+  return *this;
+}
+#else
+utils::mapped_file::mapped_file() : _data(nullptr), _size(0u)
+{
+}
+
+utils::mapped_file::mapped_file(std::string const& path) : mapped_file()
+{
+  auto const fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+  struct stat file_stats;
+  if (fstat(fd, &file_stats) == 0 && file_stats.st_size > 0) {
+    auto const mapping = mmap(nullptr, static_cast<std::size_t>(file_stats.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) {
+      _data = mapping;
+      _size = static_cast<std::size_t>(file_stats.st_size);
+    }
+  }
+  // The mapping keeps its own reference to the file.
+  ::close(fd);
+}
+
+void
+utils::mapped_file::close()
+{
+  if (_data != nullptr)
+    munmap(const_cast<void*>(_data), _size);
+  _data = nullptr;
+  _size = 0u;
+}
+
+utils::mapped_file::mapped_file(mapped_file&& other) : _data(other._data), _size(other._size)
+{
+  other._data = nullptr;
+  other._size = 0u;
+}
+
+utils::mapped_file&
+utils::mapped_file::operator=(mapped_file&& other)
+{
+  if (this != &other) {
+    close();
+    std::swap(_data, other._data);
+    std::swap(_size, other._size);
+  }
+  return *this;
+}
+#endif
+
+utils::mapped_file::~mapped_file()
+{
+  close();
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 
@@ -9,4 +11,43 @@ namespace utils
 
 std::string slurp_file(std::string const& path);
 
+//! \brief 64-bit FNV-1a hash of a memory range.
+//!
+//! @param [in] data start of the range to hash
+//! @param [in] size length of the range, in bytes
+//! @param [in] seed previous hash value, to chain several ranges
+//! @return the hash of the range
+std::uint64_t hash_fnv1a(void const* data, std::size_t size,
+                         std::uint64_t seed = 14695981039346656037ull);
+
+//! \brief Read-only memory mapping of a whole file.
+//!
+//! The mapping is released when the object is destroyed; pointers
+//! returned by `data()` must not outlive it.
+class mapped_file
+{
+public:
+	mapped_file();
+	explicit mapped_file(std::string const& path);
+	mapped_file(mapped_file&& other);
+	mapped_file& operator=(mapped_file&& other);
+	mapped_file(mapped_file const&) = delete;
+	mapped_file& operator=(mapped_file const&) = delete;
+	~mapped_file();
+
+	bool is_open() const { return _data != nullptr; }
+	std::uint8_t const* data() const { return static_cast<std::uint8_t const*>(_data); }
+	std::size_t size() const { return _size; }
+
+private:
+	void close();
+
+	void const* _data;
+	std::size_t _size;
+#ifdef _WIN32
+	void* _file;
+	void* _mapping;
+#endif
+};
+
 } // end of namespace
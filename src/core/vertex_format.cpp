@@ -0,0 +1,225 @@
+#include "vertex_format.hpp"
+#include "gl_state.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace local
+{
+	static uint32_t attribute_bit(bonobo::shader_bindings binding)
+	{
+		return 1u << static_cast<unsigned int>(binding);
+	}
+
+	static glm::vec3 normalize_or_zero(glm::vec3 const& v)
+	{
+		auto const length = glm::length(v);
+		return length > 0.0f ? v / length : glm::vec3(0.0f);
+	}
+
+	// Sizes of each attribute when interleaved and packed, in binding order.
+	static size_t const packed_sizes[] = {
+		3u * sizeof(float),    // vertices
+		sizeof(uint32_t),      // normals, GL_INT_2_10_10_10_REV
+		2u * sizeof(uint16_t), // texcoords, GL_HALF_FLOAT
+		sizeof(uint32_t),      // tangents, GL_INT_2_10_10_10_REV
+		3u * sizeof(float)     // binormals, only stored when they cannot be derived in the shaders
+	};
+}
+
+size_t
+bonobo::vertexSize(vertex_format format, uint32_t attributes)
+{
+	size_t size = 0u;
+	for (unsigned int binding = static_cast<unsigned int>(shader_bindings::vertices);
+	     binding <= static_cast<unsigned int>(shader_bindings::binormals); ++binding) {
+		if ((attributes & (1u << binding)) == 0u)
+			continue;
+		size += format == vertex_format::planar_float ? sizeof(glm::vec3) : local::packed_sizes[binding];
+	}
+	return size;
+}
+
+std::vector<uint8_t>
+bonobo::packVertices(vertex_format format, vertex_attributes const& in, uint32_t& attributes)
+{
+	assert(in.vertices != nullptr);
+
+	attributes = local::attribute_bit(shader_bindings::vertices);
+	if (in.normals != nullptr)
+		attributes |= local::attribute_bit(shader_bindings::normals);
+	if (in.texcoords != nullptr)
+		attributes |= local::attribute_bit(shader_bindings::texcoords);
+	if (in.tangents != nullptr)
+		attributes |= local::attribute_bit(shader_bindings::tangents);
+	// The binormal can only be rebuilt from the normal and the tangent.
+	if (in.binormals != nullptr && (format == vertex_format::planar_float || in.normals == nullptr || in.tangents == nullptr))
+		attributes |= local::attribute_bit(shader_bindings::binormals);
+
+	auto data = std::vector<uint8_t>(vertexSize(format, attributes) * in.vertices_nb);
+
+	if (format == vertex_format::planar_float) {
+		auto const attribute_size = in.vertices_nb * sizeof(glm::vec3);
+		size_t offset = 0u;
+		for (auto const attribute : { in.vertices, in.normals, in.texcoords, in.tangents, in.binormals }) {
+			if (attribute == nullptr)
+				continue;
+			std::memcpy(data.data() + offset, attribute, attribute_size);
+			offset += attribute_size;
+		}
+		return data;
+	}
+
+	auto const binormals_stored = (attributes & local::attribute_bit(shader_bindings::binormals)) != 0u;
+	auto output = data.data();
+	for (size_t i = 0u; i < in.vertices_nb; ++i) {
+		std::memcpy(output, &in.vertices[i], sizeof(glm::vec3));
+		output += sizeof(glm::vec3);
+
+		if (in.normals != nullptr) {
+			auto const normal = glm::packSnorm3x10_1x2(glm::vec4(local::normalize_or_zero(in.normals[i]), 0.0f));
+			std::memcpy(output, &normal, sizeof(normal));
+			output += sizeof(normal);
+		}
+
+		if (in.texcoords != nullptr) {
+			auto const texcoord = glm::packHalf2x16(glm::vec2(in.texcoords[i]));
+			std::memcpy(output, &texcoord, sizeof(texcoord));
+			output += sizeof(texcoord);
+		}
+
+		if (in.tangents != nullptr) {
+			// Store whether (tangent, binormal, normal) is left-handed,
+			// for the shaders to flip the binormal they rebuild.
+			auto handedness = 1.0f;
+			if (in.normals != nullptr && in.binormals != nullptr
+			 && glm::dot(glm::cross(in.normals[i], in.tangents[i]), in.binormals[i]) < 0.0f)
+				handedness = -1.0f;
+			auto const tangent = glm::packSnorm3x10_1x2(glm::vec4(local::normalize_or_zero(in.tangents[i]), handedness));
+			std::memcpy(output, &tangent, sizeof(tangent));
+			output += sizeof(tangent);
+		}
+
+		if (binormals_stored) {
+			std::memcpy(output, &in.binormals[i], sizeof(glm::vec3));
+			output += sizeof(glm::vec3);
+		}
+	}
+	assert(output == data.data() + data.size());
+
+	return data;
+}
+
+void
+bonobo::setVertexAttribPointers(vertex_format format, uint32_t attributes, size_t vertices_nb)
+{
+	if (format == vertex_format::planar_float) {
+		// Attributes are stored one after the other, in binding order.
+		auto const attribute_size = vertices_nb * sizeof(glm::vec3);
+		size_t offset = 0u;
+		for (unsigned int binding = static_cast<unsigned int>(shader_bindings::vertices);
+		     binding <= static_cast<unsigned int>(shader_bindings::binormals); ++binding) {
+			if ((attributes & (1u << binding)) == 0u) {
+				glDisableVertexAttribArray(binding);
+				continue;
+			}
+			glEnableVertexAttribArray(binding);
+			glVertexAttribPointer(binding, 3, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<GLvoid const*>(offset));
+			offset += attribute_size;
+		}
+		return;
+	}
+
+	auto const stride = static_cast<GLsizei>(vertexSize(format, attributes));
+	size_t offset = 0u;
+	for (unsigned int binding = static_cast<unsigned int>(shader_bindings::vertices);
+	     binding <= static_cast<unsigned int>(shader_bindings::binormals); ++binding) {
+		if ((attributes & (1u << binding)) == 0u) {
+			glDisableVertexAttribArray(binding);
+			continue;
+		}
+		glEnableVertexAttribArray(binding);
+		auto const pointer = reinterpret_cast<GLvoid const*>(offset);
+		switch (static_cast<shader_bindings>(binding)) {
+			case shader_bindings::normals:
+			case shader_bindings::tangents:
+				glVertexAttribPointer(binding, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, pointer);
+				offset += local::packed_sizes[binding];
+				break;
+			case shader_bindings::texcoords:
+				glVertexAttribPointer(binding, 2, GL_HALF_FLOAT, GL_FALSE, stride, pointer);
+				offset += local::packed_sizes[binding];
+				break;
+			default:
+				glVertexAttribPointer(binding, 3, GL_FLOAT, GL_FALSE, stride, pointer);
+				offset += local::packed_sizes[binding];
+				break;
+		}
+	}
+	assert(offset == static_cast<size_t>(stride));
+}
+
+void
+bonobo::uploadVertices(mesh_data& mesh, vertex_format format, vertex_attributes const& in)
+{
+	uint32_t attributes = 0u;
+	auto const data = packVertices(format, in, attributes);
+
+	glGenBuffers(1, &mesh.bo);
+	assert(mesh.bo != 0u);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.bo);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(data.size()), static_cast<GLvoid const*>(data.data()), GL_STATIC_DRAW);
+	setVertexAttribPointers(format, attributes, in.vertices_nb);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	// The VAO of the mesh was bound without going through gl_state.
+	gl_state::invalidate();
+
+	mesh.vertices_nb = in.vertices_nb;
+	mesh.format = format;
+	mesh.attributes = attributes;
+	computeBounds(in.vertices, in.vertices_nb, mesh.bounds, mesh.sphere);
+}
+
+size_t
+bonobo::indexSize(GLenum index_type)
+{
+	switch (index_type) {
+		case GL_UNSIGNED_BYTE:  return sizeof(GLubyte);
+		case GL_UNSIGNED_SHORT: return sizeof(GLushort);
+		default:                return sizeof(GLuint);
+	}
+}
+
+size_t
+bonobo::indexBufferLength(mesh_data const& mesh)
+{
+	auto length = mesh.indices_nb;
+	for (auto const& lod : mesh.lods)
+		length = std::max(length, lod.first_index + lod.indices_nb);
+	return length;
+}
+
+void
+bonobo::uploadIndices(mesh_data& mesh, GLuint const* indices, size_t indices_nb)
+{
+	glGenBuffers(1, &mesh.ibo);
+	assert(mesh.ibo != 0u);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ibo);
+
+	if (mesh.vertices_nb <= 0xffffu) {
+		auto short_indices = std::vector<GLushort>(indices_nb);
+		for (size_t i = 0u; i < indices_nb; ++i) {
+			assert(indices[i] < mesh.vertices_nb || indices[i] == primitive_restart_index);
+			short_indices[i] = static_cast<GLushort>(indices[i]);
+		}
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices_nb * sizeof(GLushort)), static_cast<GLvoid const*>(short_indices.data()), GL_STATIC_DRAW);
+		mesh.index_type = GL_UNSIGNED_SHORT;
+	} else {
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(indices_nb * sizeof(GLuint)), static_cast<GLvoid const*>(indices), GL_STATIC_DRAW);
+		mesh.index_type = GL_UNSIGNED_INT;
+	}
+	mesh.indices_nb = indices_nb;
+}
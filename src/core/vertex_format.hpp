@@ -0,0 +1,88 @@
+#pragma once
+
+#include "helpers.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bonobo
+{
+	//! \brief Per-vertex attributes of a mesh, as computed on the CPU.
+	//!
+	//! Every array holds `vertices_nb` elements; attributes a mesh does
+	//! not have are left as `nullptr`.
+	struct vertex_attributes {
+		size_t vertices_nb;
+		glm::vec3 const* vertices;
+		glm::vec3 const* normals;
+		glm::vec3 const* texcoords;
+		glm::vec3 const* tangents;
+		glm::vec3 const* binormals;
+	};
+
+	//! \brief Number of bytes used per vertex by a given format.
+	//!
+	//! @param [in] format layout of the attributes
+	//! @param [in] attributes bit i set if attribute
+	//!             `bonobo::shader_bindings(i)` is stored
+	size_t vertexSize(vertex_format format, uint32_t attributes);
+
+	//! \brief Lay out attributes as they should be uploaded to OpenGL.
+	//!
+	//! @param [in] format layout to use
+	//! @param [in] in attributes to convert
+	//! @param [out] attributes bit i set if attribute
+	//!              `bonobo::shader_bindings(i)` is stored in the result
+	//! @return the content of the Buffer Object
+	std::vector<uint8_t> packVertices(vertex_format format,
+	                                  vertex_attributes const& in,
+	                                  uint32_t& attributes);
+
+	//! \brief Enable and point the attributes of the currently bound
+	//!        Vertex Array Object into the currently bound GL_ARRAY_BUFFER.
+	//!
+	//! @param [in] format layout the buffer was filled with
+	//! @param [in] attributes value returned by `packVertices()`
+	//! @param [in] vertices_nb number of vertices in the buffer
+	void setVertexAttribPointers(vertex_format format, uint32_t attributes,
+	                             size_t vertices_nb);
+
+	//! \brief Pack attributes, upload them into a new Buffer Object and
+	//!        point the Vertex Array Object of a mesh at them.
+	//!
+	//! The VAO of `mesh` must be bound; `bo`, `vertices_nb`, `format`,
+	//! `attributes`, `bounds` and `sphere` are filled in.
+	//!
+	//! @param [in,out] mesh mesh to fill in
+	//! @param [in] format layout to use
+	//! @param [in] in attributes to upload
+	void uploadVertices(mesh_data& mesh, vertex_format format,
+	                    vertex_attributes const& in);
+
+	//! \brief Value of an index marking the end of a strip, see
+	//!        `gl_state::primitiveRestart()`.
+	constexpr GLuint primitive_restart_index = 0xffffffffu;
+
+	//! \brief Number of bytes taken by one index of a given type.
+	size_t indexSize(GLenum index_type);
+
+	//! \brief Number of indices a mesh keeps in its index buffer,
+	//!        counting those of its coarser levels of detail.
+	size_t indexBufferLength(mesh_data const& mesh);
+
+	//! \brief Upload indices into a new Buffer Object, attached to the
+	//!        Vertex Array Object of a mesh.
+	//!
+	//! Indices are stored on 16 bits when `mesh.vertices_nb` leaves
+	//! 0xffff free for `primitive_restart_index`, which is converted
+	//! accordingly; they are kept on 32 bits otherwise. The VAO of `mesh`
+	//! must be bound; `ibo`, `indices_nb` and `index_type` are filled in.
+	//!
+	//! @param [in,out] mesh mesh to fill in
+	//! @param [in] indices indices to upload
+	//! @param [in] indices_nb number of indices
+	void uploadIndices(mesh_data& mesh, GLuint const* indices, size_t indices_nb);
+}